@@ -0,0 +1,497 @@
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "archive.h"
+#include "files.h"
+#include "kernels.h"
+#include "parallel.h"
+#include "scanner.h"
+#include "stream.h"
+#include "strtab.h"
+#include "tools.h"
+
+/**
+ * @brief 重新分配内存，失败时打印错误信息并退出程序
+ */
+static void *reallocOrDie(void *memory, size_t size) {
+	void *result = realloc(memory, size > 0 ? size : 1);
+	if (result == NULL) {
+		fprintf(stderr, "内存不足，无法写入归档.\n");
+		exit(1);
+	}
+	return result;
+}
+
+/**
+ * @brief 在指定位置写入全部数据
+ * @return 成功返回 true，否则返回 false
+ */
+static bool writeAt(int fd, const void *data, size_t length, uint64_t offset) {
+	const char *p = data;
+	while (length > 0) {
+		ssize_t n = pwrite(fd, p, length, (off_t)offset);
+		if (n <= 0) {
+			return false;
+		}
+		p += n;
+		length -= (size_t)n;
+		offset += (uint64_t)n;
+	}
+	return true;
+}
+
+bool createArchive(ArchiveWriter *writer, const char *path) {
+	memset(writer, 0, sizeof(*writer));
+	size_t length = strlen(path) + 5;
+	writer->path = strdup(path);
+	writer->tmpPath = reallocOrDie(NULL, length);
+	snprintf(writer->tmpPath, length, "%s.tmp", path);
+	writer->fd = open(writer->tmpPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+	if (writer->fd < 0) {
+		fprintf(stderr, "无法创建归档 \"%s\".\n", path);
+		free(writer->path);
+		free(writer->tmpPath);
+		return false;
+	}
+	char header[ARCHIVE_HEADER] = ARCHIVE_MAGIC;
+	uint32_t version = ARCHIVE_VERSION;
+	memcpy(header + 4, &version, sizeof(version));
+	writer->failed = !writeAt(writer->fd, header, sizeof(header), 0);
+	writer->offset = ARCHIVE_HEADER;
+	pthread_mutex_init(&writer->mutex, NULL);
+	return true;
+}
+
+uint64_t reserveArchiveRegion(ArchiveWriter *writer, const char *path, uint64_t length, uint64_t stringsLength,
+                              uint64_t hash) {
+	size_t pathLength = strlen(path);
+	pthread_mutex_lock(&writer->mutex);
+	if (writer->count == writer->capacity) {
+		writer->capacity = writer->capacity > 0 ? writer->capacity * 2 : 1024;
+		writer->entries = reallocOrDie(writer->entries, writer->capacity * sizeof(ArchiveEntry));
+	}
+	if (writer->pathsLength + pathLength > writer->pathsCapacity) {
+		while (writer->pathsLength + pathLength > writer->pathsCapacity) {
+			writer->pathsCapacity = writer->pathsCapacity > 0 ? writer->pathsCapacity * 2 : 64 * 1024;
+		}
+		writer->paths = reallocOrDie(writer->paths, writer->pathsCapacity);
+	}
+	memcpy(writer->paths + writer->pathsLength, path, pathLength);
+	uint64_t offset = writer->offset;
+	writer->entries[writer->count++] = (ArchiveEntry){offset, length, stringsLength, hash,
+	                                                  (uint32_t)writer->pathsLength, (uint32_t)pathLength};
+	writer->pathsLength += pathLength;
+	writer->offset += length + stringsLength;
+	pthread_mutex_unlock(&writer->mutex);
+	return offset;
+}
+
+void writeArchiveRegion(ArchiveWriter *writer, uint64_t offset, const void *data, size_t length) {
+	if (!writeAt(writer->fd, data, length, offset)) {
+		pthread_mutex_lock(&writer->mutex);
+		writer->failed = true;
+		pthread_mutex_unlock(&writer->mutex);
+	}
+}
+
+void addArchiveEntry(ArchiveWriter *writer, const char *path, const void *data, size_t length, uint64_t hash) {
+	writeArchiveRegion(writer, reserveArchiveRegion(writer, path, length, 0, hash), data, length);
+}
+
+/**
+ * @brief 排序索引时使用的路径区，qsort 的比较函数无法携带上下文
+ */
+static const char *sortPaths;
+
+/**
+ * @brief 按路径的字节序比较两个索引项，较短的路径是较长路径的前缀时排在前面
+ */
+static int compareEntries(const void *a, const void *b) {
+	const ArchiveEntry *x = a, *y = b;
+	uint32_t length = x->pathLength < y->pathLength ? x->pathLength : y->pathLength;
+	int result = memcmp(sortPaths + x->pathOffset, sortPaths + y->pathOffset, length);
+	if (result != 0) {
+		return result;
+	}
+	return (x->pathLength > y->pathLength) - (x->pathLength < y->pathLength);
+}
+
+bool finishArchive(ArchiveWriter *writer) {
+	pthread_mutex_destroy(&writer->mutex);
+	sortPaths = writer->paths;
+	if (writer->count > 0) {
+		qsort(writer->entries, writer->count, sizeof(ArchiveEntry), compareEntries);
+	}
+	// 索引按 8 字节对齐，mmap 之后可以直接按结构体访问
+	static const char padding[8];
+	size_t paddingLength = (8 - writer->offset % 8) % 8;
+	ArchiveTrailer trailer;
+	memcpy(trailer.magic, ARCHIVE_MAGIC, sizeof(trailer.magic));
+	trailer.version = ARCHIVE_VERSION;
+	trailer.fileCount = writer->count;
+	trailer.indexOffset = writer->offset + paddingLength;
+	trailer.pathsLength = writer->pathsLength;
+	bool ok = !writer->failed && writeAt(writer->fd, padding, paddingLength, writer->offset);
+	uint64_t offset = trailer.indexOffset;
+	ok = ok && writeAt(writer->fd, writer->entries, writer->count * sizeof(ArchiveEntry), offset);
+	offset += writer->count * sizeof(ArchiveEntry);
+	ok = ok && writeAt(writer->fd, writer->paths, writer->pathsLength, offset);
+	offset += writer->pathsLength;
+	ok = ok && writeAt(writer->fd, &trailer, sizeof(trailer), offset);
+	ok = close(writer->fd) == 0 && ok;
+	ok = ok && rename(writer->tmpPath, writer->path) == 0;
+	if (!ok) {
+		fprintf(stderr, "无法写入归档 \"%s\".\n", writer->path);
+		unlink(writer->tmpPath);
+	}
+	free(writer->entries);
+	free(writer->paths);
+	free(writer->path);
+	free(writer->tmpPath);
+	return ok;
+}
+
+bool openArchive(ArchiveReader *reader, const char *path) {
+	memset(reader, 0, sizeof(*reader));
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < ARCHIVE_HEADER + sizeof(ArchiveTrailer)) {
+		close(fd);
+		return false;
+	}
+	void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		return false;
+	}
+	reader->data = data;
+	reader->size = (size_t)st.st_size;
+	ArchiveTrailer trailer;
+	memcpy(&trailer, reader->data + reader->size - sizeof(trailer), sizeof(trailer));
+	uint64_t indexEnd = reader->size - sizeof(trailer) - trailer.pathsLength;
+	bool ok = memcmp(reader->data, ARCHIVE_MAGIC, 4) == 0 && memcmp(trailer.magic, ARCHIVE_MAGIC, 4) == 0 &&
+	          trailer.version == ARCHIVE_VERSION && trailer.pathsLength <= reader->size - sizeof(trailer) &&
+	          trailer.indexOffset % 8 == 0 && trailer.indexOffset >= ARCHIVE_HEADER && trailer.indexOffset <= indexEnd &&
+	          trailer.fileCount == (indexEnd - trailer.indexOffset) / sizeof(ArchiveEntry) &&
+	          (indexEnd - trailer.indexOffset) % sizeof(ArchiveEntry) == 0;
+	if (ok) {
+		reader->entries = (const ArchiveEntry *)(reader->data + trailer.indexOffset);
+		reader->count = (size_t)trailer.fileCount;
+		reader->paths = (const char *)(reader->data + indexEnd);
+	}
+	// 逐项检查数据和路径都在各自的区域内，之后的访问不再需要检查边界
+	for (size_t i = 0; ok && i < reader->count; i++) {
+		const ArchiveEntry *entry = &reader->entries[i];
+		ok = entry->offset >= ARCHIVE_HEADER && entry->offset <= trailer.indexOffset &&
+		     entry->length <= trailer.indexOffset - entry->offset &&
+		     entry->stringsLength <= trailer.indexOffset - entry->offset - entry->length &&
+		     (uint64_t)entry->pathOffset + entry->pathLength <= trailer.pathsLength;
+	}
+	if (!ok) {
+		closeArchive(reader);
+	}
+	return ok;
+}
+
+void closeArchive(ArchiveReader *reader) {
+	if (reader->data != NULL) {
+		munmap((void *)reader->data, reader->size);
+	}
+	memset(reader, 0, sizeof(*reader));
+}
+
+const ArchiveEntry *findArchiveEntry(const ArchiveReader *reader, const char *path) {
+	size_t length = strlen(path), low = 0, high = reader->count;
+	while (low < high) {
+		size_t middle = low + (high - low) / 2;
+		const ArchiveEntry *entry = &reader->entries[middle];
+		size_t common = entry->pathLength < length ? entry->pathLength : length;
+		int result = memcmp(reader->paths + entry->pathOffset, path, common);
+		if (result == 0) {
+			result = (entry->pathLength > length) - (entry->pathLength < length);
+		}
+		if (result == 0) {
+			return entry;
+		}
+		if (result < 0) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief 字节缓冲区，用于编码字符串表
+ */
+typedef struct {
+	unsigned char *data; ///< 数据
+	size_t length;       ///< 已写入的字节数
+	size_t capacity;     ///< data 的容量
+} ByteBuffer;
+
+/**
+ * @brief 追加一个 LEB128 变长整数
+ */
+static void putVarint(ByteBuffer *buffer, uint64_t value) {
+	if (buffer->length + 10 > buffer->capacity) {
+		buffer->capacity = buffer->capacity < 4096 ? 4096 : buffer->capacity * 2;
+		buffer->data = reallocOrDie(buffer->data, buffer->capacity);
+	}
+	while (value >= 0x80) {
+		buffer->data[buffer->length++] = (unsigned char)(value | 0x80);
+		value >>= 7;
+	}
+	buffer->data[buffer->length++] = (unsigned char)value;
+}
+
+/**
+ * @brief 追加一段字节
+ */
+static void putBytes(ByteBuffer *buffer, const void *data, size_t length) {
+	if (buffer->length + length > buffer->capacity) {
+		while (buffer->length + length > buffer->capacity) {
+			buffer->capacity = buffer->capacity < 4096 ? 4096 : buffer->capacity * 2;
+		}
+		buffer->data = reallocOrDie(buffer->data, buffer->capacity);
+	}
+	memcpy(buffer->data + buffer->length, data, length);
+	buffer->length += length;
+}
+
+/**
+ * @brief 判断 Token 的文本是否由源码决定，这些 Token 的文本写入字符串表
+ */
+static bool hasText(uint32_t type) {
+	return type == TOKEN_IDENTIFIER || type == TOKEN_CHARACTER || type == TOKEN_STRING || type == TOKEN_NUMBER;
+}
+
+/**
+ * @brief 为一个文件编码字符串表
+ * @param source 源代码
+ * @param stream 该文件的 Token 流
+ * @param buffer 输出缓冲区，原有的内容会被清空
+ */
+static void encodeStrings(const char *source, const TokenStream *stream, ByteBuffer *buffer) {
+	StringTable table;
+	initStringTable(&table);
+	uint32_t *refs = NULL;
+	size_t refCount = 0, refCapacity = 0;
+	StreamReader reader;
+	StreamToken token;
+	openStreamReader(&reader, stream->data, stream->length);
+	while (nextStreamToken(&reader, &token)) {
+		if (!hasText(token.type)) {
+			continue;
+		}
+		if (refCount == refCapacity) {
+			refCapacity = refCapacity > 0 ? refCapacity * 2 : 1024;
+			refs = reallocOrDie(refs, refCapacity * sizeof(uint32_t));
+		}
+		refs[refCount++] = internString(&table, source + token.offset, token.length);
+	}
+	buffer->length = 0;
+	putVarint(buffer, table.count);
+	for (uint32_t id = 0; id < table.count; id++) {
+		size_t length;
+		const char *text = stringAt(&table, id, &length);
+		putVarint(buffer, length);
+		putBytes(buffer, text, length);
+	}
+	putVarint(buffer, refCount);
+	for (size_t i = 0; i < refCount; i++) {
+		putVarint(buffer, refs[i]);
+	}
+	free(refs);
+	freeStringTable(&table);
+}
+
+/**
+ * @brief 并行写入归档时的共享状态
+ */
+typedef struct {
+	const FileList *files; ///< 全部文件
+	ArchiveWriter *writer; ///< 写入器
+	bool strings;          ///< 是否写入字符串表
+	bool *skipped;         ///< 每个文件是否因无法读取而跳过
+} ArchiveJob;
+
+/**
+ * @brief 分析一个文件，预留区域后直接写入归档
+ * @param index 文件编号
+ * @param worker 工作线程编号
+ * @param context ArchiveJob
+ */
+static void archiveTask(size_t index, int worker, void *context) {
+	(void)worker;
+	ArchiveJob *job = context;
+	size_t length;
+	char *source = tryReadFile(job->files->paths[index], &length);
+	if (source == NULL) {
+		job->skipped[index] = true; // 错误信息已由 tryReadFile 输出
+		return;
+	}
+	TokenStream stream;
+	initTokenStream(&stream);
+	encodeTokenStream(source, length, &stream);
+	ByteBuffer strings = {NULL, 0, 0};
+	if (job->strings) {
+		encodeStrings(source, &stream, &strings);
+	}
+	uint64_t offset = reserveArchiveRegion(job->writer, job->files->paths[index], stream.length, strings.length,
+	                                       hashBytes(source, length));
+	writeArchiveRegion(job->writer, offset, stream.data, stream.length);
+	writeArchiveRegion(job->writer, offset + stream.length, strings.data, strings.length);
+	free(strings.data);
+	freeTokenStream(&stream);
+	releaseFile(source, length);
+}
+
+int buildArchive(const char *archivePath, bool strings, int count, const char *paths[]) {
+	FileList files;
+	collectFiles(&files, count, paths);
+	ArchiveWriter writer;
+	if (!createArchive(&writer, archivePath)) {
+		freeFileList(&files);
+		return 1;
+	}
+	ArchiveJob job = {&files, &writer, strings, reallocOrDie(NULL, (size_t)files.count + 1)};
+	memset(job.skipped, 0, (size_t)files.count + 1);
+	parallelFor((size_t)files.count, archiveTask, &job);
+	size_t skipped = 0;
+	for (int i = 0; i < files.count; i++) {
+		skipped += job.skipped[i];
+	}
+	uint64_t dataLength = writer.offset - ARCHIVE_HEADER;
+	bool ok = finishArchive(&writer);
+	if (ok) {
+		fprintf(stderr, "共 %zu 个文件，数据 %" PRIu64 " 字节.\n", (size_t)files.count - skipped, dataLength);
+		if (skipped > 0) {
+			fprintf(stderr, "跳过 %zu 个无法读取的文件.\n", skipped);
+		}
+	}
+	free(job.skipped);
+	freeFileList(&files);
+	return ok && skipped == 0 ? 0 : 1;
+}
+
+int listArchive(const char *archivePath, FILE *out) {
+	ArchiveReader reader;
+	if (!openArchive(&reader, archivePath)) {
+		fprintf(stderr, "无法读取归档 \"%s\".\n", archivePath);
+		return 1;
+	}
+	for (size_t i = 0; i < reader.count; i++) {
+		const ArchiveEntry *entry = &reader.entries[i];
+		fprintf(out, "%016" PRIx64 "\t%" PRIu64 "\t%" PRIu64 "\t%.*s\n", entry->hash, entry->length,
+		        entry->stringsLength, (int)entry->pathLength, reader.paths + entry->pathOffset);
+	}
+	closeArchive(&reader);
+	return 0;
+}
+
+/**
+ * @brief 读取字符串表中的一个 LEB128 变长整数
+ * @return 成功返回 true，数据不完整时返回 false
+ */
+static bool getVarint(const unsigned char **cursor, const unsigned char *end, uint64_t *value) {
+	uint64_t result = 0;
+	for (int shift = 0; shift < 64 && *cursor < end; shift += 7) {
+		unsigned char byte = *(*cursor)++;
+		result |= (uint64_t)(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0) {
+			*value = result;
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief 解码后的字符串表
+ */
+typedef struct {
+	const unsigned char **texts; ///< 每个字符串的内容，指向归档的映射
+	uint64_t *lengths;           ///< 每个字符串的字节数
+	uint64_t count;              ///< 字符串数量
+	const unsigned char *refs;   ///< 引用编号的起始位置
+	uint64_t refCount;           ///< 引用数量
+} DecodedStrings;
+
+/**
+ * @brief 解码一个文件的字符串表
+ * @return 成功返回 true，数据损坏时返回 false
+ */
+static bool decodeStrings(const unsigned char *data, uint64_t length, DecodedStrings *strings) {
+	const unsigned char *cursor = data, *end = data + length;
+	memset(strings, 0, sizeof(*strings));
+	if (!getVarint(&cursor, end, &strings->count) || strings->count > length) {
+		return false;
+	}
+	strings->texts = reallocOrDie(NULL, (size_t)strings->count * sizeof(*strings->texts));
+	strings->lengths = reallocOrDie(NULL, (size_t)strings->count * sizeof(*strings->lengths));
+	for (uint64_t id = 0; id < strings->count; id++) {
+		if (!getVarint(&cursor, end, &strings->lengths[id]) || strings->lengths[id] > (uint64_t)(end - cursor)) {
+			return false;
+		}
+		strings->texts[id] = cursor;
+		cursor += strings->lengths[id];
+	}
+	if (!getVarint(&cursor, end, &strings->refCount)) {
+		return false;
+	}
+	strings->refs = cursor;
+	return true;
+}
+
+int catArchive(const char *archivePath, const char *path, FILE *out) {
+	ArchiveReader reader;
+	if (!openArchive(&reader, archivePath)) {
+		fprintf(stderr, "无法读取归档 \"%s\".\n", archivePath);
+		return 1;
+	}
+	const ArchiveEntry *entry = findArchiveEntry(&reader, path);
+	if (entry == NULL) {
+		fprintf(stderr, "归档中没有文件 \"%s\".\n", path);
+		closeArchive(&reader);
+		return 1;
+	}
+	const unsigned char *data = reader.data + entry->offset;
+	const unsigned char *stringsEnd = data + entry->length + entry->stringsLength;
+	DecodedStrings strings = {NULL, NULL, 0, NULL, 0};
+	StreamReader stream;
+	bool ok = openStreamReader(&stream, data, (size_t)entry->length);
+	ok = ok && (entry->stringsLength == 0 || decodeStrings(data + entry->length, entry->stringsLength, &strings));
+	const unsigned char *ref = entry->stringsLength > 0 ? strings.refs : NULL;
+	StreamToken token;
+	while (ok && nextStreamToken(&stream, &token)) {
+		fprintf(out, "%u:%u %s %u", token.line, token.column, convert_to_str((Token){.type = token.type}),
+		        token.length);
+		uint64_t id;
+		if (ref != NULL && hasText(token.type)) {
+			ok = getVarint(&ref, stringsEnd, &id) && id < strings.count;
+			if (ok) {
+				fprintf(out, " '%.*s'", (int)strings.lengths[id], (const char *)strings.texts[id]);
+			}
+		}
+		fputc('\n', out);
+	}
+	ok = ok && stream.remaining == 0;
+	if (!ok) {
+		fprintf(stderr, "归档中 \"%s\" 的数据已损坏.\n", path);
+	}
+	free(strings.texts);
+	free(strings.lengths);
+	closeArchive(&reader);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,181 @@
+#pragma once
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @brief 语料归档的魔数
+ */
+#define ARCHIVE_MAGIC "TKAR"
+
+/**
+ * @brief 语料归档的格式版本
+ */
+#define ARCHIVE_VERSION 2
+
+/**
+ * @brief 语料归档文件头的字节数，之后紧接着各文件的数据
+ */
+#define ARCHIVE_HEADER 8
+
+/**
+ * @brief 归档索引中的一项
+ * @details 文件的数据区依次为二进制 Token 流和可选的字符串表，字符串表紧接在 Token 流之后。\n
+ * 字符串表由 LEB128 编码的整数组成：字符串数量，每个字符串的字节数和内容，
+ * 然后是引用数量和每个标识符、字符、字符串、数字 Token 依次引用的字符串编号。
+ */
+typedef struct {
+	uint64_t offset;        ///< 数据在归档中的起始位置
+	uint64_t length;        ///< Token 流的字节数
+	uint64_t stringsLength; ///< 字符串表的字节数，没有字符串表时为 0
+	uint64_t hash;          ///< 源文件内容的哈希值
+	uint32_t pathOffset;    ///< 路径在路径区中的偏移
+	uint32_t pathLength;    ///< 路径的字节数
+} ArchiveEntry;
+
+/**
+ * @brief 归档末尾的索引位置信息
+ */
+typedef struct {
+	char magic[4];        ///< 魔数 ARCHIVE_MAGIC
+	uint32_t version;     ///< 格式版本
+	uint64_t fileCount;   ///< 文件数量
+	uint64_t indexOffset; ///< 索引的起始位置，按 8 字节对齐，索引之后是路径区，路径区之后是本结构
+	uint64_t pathsLength; ///< 路径区的字节数
+} ArchiveTrailer;
+
+/**
+ * @brief 写入语料归档
+ * @details 归档由文件头、各文件的数据、索引、路径区和末尾的 ArchiveTrailer 组成。\n
+ * 索引放在末尾，写入数据时不需要事先知道文件数量，完成时按路径排序，读取时可以二分查找。\n
+ * 多个线程可以同时写入：各自预留一段区域后用 pwrite 写入数据，只有预留需要加锁。
+ * 先写入临时文件，完成后重命名。
+ */
+typedef struct {
+	int fd;                ///< 临时文件的描述符
+	char *path;            ///< 归档路径
+	char *tmpPath;         ///< 临时文件路径
+	uint64_t offset;       ///< 下一段区域的起始位置
+	ArchiveEntry *entries; ///< 已预留的文件
+	size_t count;          ///< 已预留的文件数量
+	size_t capacity;       ///< entries 的容量
+	char *paths;           ///< 路径区
+	size_t pathsLength;    ///< 路径区的字节数
+	size_t pathsCapacity;  ///< paths 的容量
+	bool failed;           ///< 是否发生过写入错误
+	pthread_mutex_t mutex; ///< 保护预留区域和错误标志
+} ArchiveWriter;
+
+/**
+ * @brief 通过 mmap 读取的语料归档
+ */
+typedef struct {
+	const unsigned char *data;   ///< 映射的归档内容
+	size_t size;                 ///< 归档的字节数
+	const ArchiveEntry *entries; ///< 按路径排序的索引
+	size_t count;                ///< 文件数量
+	const char *paths;           ///< 路径区
+} ArchiveReader;
+
+/**
+ * @brief 创建语料归档
+ * @param writer 写入器
+ * @param path 归档路径
+ * @return 成功返回 true，无法创建临时文件时返回 false
+ */
+bool createArchive(ArchiveWriter *writer, const char *path);
+
+/**
+ * @brief 为一个文件预留数据区域，可以在多个线程中同时调用
+ * @param writer 写入器
+ * @param path 文件路径
+ * @param length Token 流的字节数
+ * @param stringsLength 字符串表的字节数
+ * @param hash 源文件内容的哈希值
+ * @return 区域的起始位置
+ */
+uint64_t reserveArchiveRegion(ArchiveWriter *writer, const char *path, uint64_t length, uint64_t stringsLength,
+                              uint64_t hash);
+
+/**
+ * @brief 向已预留的区域写入数据，可以在多个线程中同时调用
+ * @details 写入失败时记录在写入器中，finishArchive 时放弃整个归档。
+ * @param writer 写入器
+ * @param offset 写入位置
+ * @param data 数据
+ * @param length 数据的字节数
+ */
+void writeArchiveRegion(ArchiveWriter *writer, uint64_t offset, const void *data, size_t length);
+
+/**
+ * @brief 向归档追加一个没有字符串表的文件
+ * @param writer 写入器
+ * @param path 文件路径
+ * @param data 数据，通常为二进制 Token 流
+ * @param length 数据的字节数
+ * @param hash 源文件内容的哈希值
+ */
+void addArchiveEntry(ArchiveWriter *writer, const char *path, const void *data, size_t length, uint64_t hash);
+
+/**
+ * @brief 写入索引并完成归档
+ * @details 成功时把临时文件重命名为归档路径，失败时删除临时文件。无论成功与否都释放写入器的资源。
+ * @param writer 写入器
+ * @return 成功返回 true，否则返回 false
+ */
+bool finishArchive(ArchiveWriter *writer);
+
+/**
+ * @brief 通过 mmap 打开语料归档并校验索引
+ * @param reader 读取器
+ * @param path 归档路径
+ * @return 成功返回 true，文件无法打开或格式无效时返回 false
+ */
+bool openArchive(ArchiveReader *reader, const char *path);
+
+/**
+ * @brief 解除归档的映射
+ * @param reader 读取器
+ */
+void closeArchive(ArchiveReader *reader);
+
+/**
+ * @brief 按路径二分查找归档中的文件
+ * @param reader 读取器
+ * @param path 文件路径，与写入时的路径完全一致
+ * @return 索引项，不存在时返回 NULL
+ */
+const ArchiveEntry *findArchiveEntry(const ArchiveReader *reader, const char *path);
+
+/**
+ * @brief 并行分析文件，写入语料归档
+ * @details 每个工作线程分析一个文件后预留区域并直接写入，数据的排列取决于完成的先后，索引按路径排序。\n
+ * 无法读取的文件报告后跳过，其余文件仍然写入归档。
+ * @param archivePath 归档路径
+ * @param strings 是否为每个文件写入字符串表
+ * @param count 路径数量
+ * @param paths 路径数组，目录会被递归展开
+ * @return 全部文件都写入成功返回 0，有文件被跳过或写入失败返回 1
+ */
+int buildArchive(const char *archivePath, bool strings, int count, const char *paths[]);
+
+/**
+ * @brief 列出归档中的文件
+ * @details 每个文件输出一行 "哈希\tToken 流字节数\t字符串表字节数\t路径"。
+ * @param archivePath 归档路径
+ * @param out 输出目标
+ * @return 成功返回 0，归档无效时返回 1
+ */
+int listArchive(const char *archivePath, FILE *out);
+
+/**
+ * @brief 输出归档中一个文件的 Token
+ * @details 每个 Token 输出一行 "行:列 类型 字节数"，有字符串表时再输出 Token 的文本。
+ * @param archivePath 归档路径
+ * @param path 文件路径
+ * @param out 输出目标
+ * @return 成功返回 0，归档无效、文件不存在或数据损坏时返回 1
+ */
+int catArchive(const char *archivePath, const char *path, FILE *out);
@@ -0,0 +1,267 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+
+#include "arena.h"
+
+/**
+ * @brief 最小的缓冲区级别，即 4 KiB
+ */
+#define MIN_CLASS_SHIFT 12
+
+/**
+ * @brief 缓冲区级别的数量，最大级别为 2^(12 + 40 - 1) 字节
+ */
+#define CLASS_COUNT 40
+
+/**
+ * @brief 每个级别最多保留的空闲缓冲区数量，限制缓冲池占用的内存
+ */
+#define POOL_KEEP 4
+
+/**
+ * @brief 从这个级别开始直接使用 mmap 申请，与 x86-64 的大页大小 2 MiB 相同
+ */
+#define HUGE_CLASS_SHIFT 21
+
+/**
+ * @brief 内存块头部占用的字节数，向上取整到 16 字节以保证分配结果对齐
+ */
+#define BLOCK_HEADER ((sizeof(ArenaBlock) + 15) & ~(size_t)15)
+
+struct ArenaBlock {
+	ArenaBlock *next; ///< 下一个内存块
+	size_t capacity;  ///< 内存块总大小，包括头部
+	size_t used;      ///< 已使用的字节数，包括头部
+};
+
+/**
+ * @brief 空闲缓冲区链表的节点，直接保存在空闲缓冲区的开头
+ */
+typedef struct FreeBuffer {
+	struct FreeBuffer *next;
+} FreeBuffer;
+
+/**
+ * @brief 缓冲池
+ * @details 每个线程一个，按级别保存空闲缓冲区
+ */
+typedef struct {
+	FreeBuffer *free[CLASS_COUNT]; ///< 每个级别的空闲缓冲区链表
+	int count[CLASS_COUNT];        ///< 每个级别的空闲缓冲区数量
+} BufferPool;
+
+static bool hugePages = false;
+static _Thread_local BufferPool pool;
+
+/**
+ * @brief 线程退出时释放缓冲池的 pthread 键
+ */
+static pthread_key_t cleanupKey;
+static pthread_once_t cleanupOnce = PTHREAD_ONCE_INIT;
+static _Thread_local bool cleanupRegistered = false;
+
+void enableHugePages(bool enabled) {
+	hugePages = enabled;
+}
+
+/**
+ * @brief 计算容纳 size 字节需要的缓冲区级别
+ * @param size 需要的字节数
+ * @return 缓冲区级别，级别 k 的容量为 2^(12 + k) 字节
+ */
+static int sizeClass(size_t size) {
+	int shift = MIN_CLASS_SHIFT;
+	while (((size_t)1 << shift) < size) {
+		shift++;
+	}
+	return shift - MIN_CLASS_SHIFT;
+}
+
+/**
+ * @brief 向系统申请一个指定级别的缓冲区
+ * @param sizeClassIndex 缓冲区级别
+ * @return 缓冲区
+ */
+static void *allocateClass(int sizeClassIndex) {
+	size_t capacity = (size_t)1 << (sizeClassIndex + MIN_CLASS_SHIFT);
+	void *buffer;
+	if (sizeClassIndex + MIN_CLASS_SHIFT < HUGE_CLASS_SHIFT) {
+		buffer = malloc(capacity);
+	} else {
+		buffer = MAP_FAILED;
+#ifdef MAP_HUGETLB
+		if (hugePages) {
+			// 显式大页需要系统预留，失败时退回普通映射
+			buffer = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		}
+#endif
+		if (buffer == MAP_FAILED) {
+			buffer = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#ifdef MADV_HUGEPAGE
+			if (buffer != MAP_FAILED && hugePages) {
+				madvise(buffer, capacity, MADV_HUGEPAGE);
+			}
+#endif
+		}
+		if (buffer == MAP_FAILED) {
+			buffer = NULL;
+		}
+	}
+	if (buffer == NULL) {
+		fprintf(stderr, "内存不足，无法申请 %zu 字节的缓冲区.\n", capacity);
+		exit(1);
+	}
+	return buffer;
+}
+
+/**
+ * @brief 把一个指定级别的缓冲区归还给系统
+ * @param buffer 缓冲区
+ * @param sizeClassIndex 缓冲区级别
+ */
+static void freeClass(void *buffer, int sizeClassIndex) {
+	if (sizeClassIndex + MIN_CLASS_SHIFT < HUGE_CLASS_SHIFT) {
+		free(buffer);
+	} else {
+		munmap(buffer, (size_t)1 << (sizeClassIndex + MIN_CLASS_SHIFT));
+	}
+}
+
+/**
+ * @brief 线程退出时释放该线程缓冲池中的全部空闲缓冲区
+ * @details 其他线程局部数据的清理函数可能在这之后又把缓冲区放回缓冲池，
+ * 此时会重新登记，pthread 会再调用一次本函数。
+ * @param value 登记时的值，未使用
+ */
+static void cleanupThread(void *value) {
+	(void)value;
+	cleanupRegistered = false;
+	for (int index = 0; index < CLASS_COUNT; index++) {
+		while (pool.free[index] != NULL) {
+			FreeBuffer *buffer = pool.free[index];
+			pool.free[index] = buffer->next;
+			freeClass(buffer, index);
+		}
+		pool.count[index] = 0;
+	}
+}
+
+/**
+ * @brief 创建线程退出时的清理键
+ */
+static void createCleanupKey(void) {
+	pthread_key_create(&cleanupKey, cleanupThread);
+}
+
+/**
+ * @brief 为当前线程登记退出时的清理，工作线程每次 parallelFor 都会重新创建
+ */
+static void registerCleanup(void) {
+	if (!cleanupRegistered) {
+		pthread_once(&cleanupOnce, createCleanupKey);
+		pthread_setspecific(cleanupKey, &pool);
+		cleanupRegistered = true;
+	}
+}
+
+void *acquireBuffer(size_t size, size_t *capacity) {
+	int index = sizeClass(size);
+	if (index >= CLASS_COUNT) {
+		fprintf(stderr, "缓冲区过大：%zu 字节.\n", size);
+		exit(1);
+	}
+	if (capacity != NULL) {
+		*capacity = (size_t)1 << (index + MIN_CLASS_SHIFT);
+	}
+	FreeBuffer *buffer = pool.free[index];
+	if (buffer != NULL) {
+		pool.free[index] = buffer->next;
+		pool.count[index]--;
+		return buffer;
+	}
+	return allocateClass(index);
+}
+
+void releaseBuffer(void *buffer, size_t size) {
+	if (buffer == NULL) {
+		return;
+	}
+	int index = sizeClass(size);
+	if (pool.count[index] < POOL_KEEP) {
+		registerCleanup();
+		FreeBuffer *node = buffer;
+		node->next = pool.free[index];
+		pool.free[index] = node;
+		pool.count[index]++;
+		return;
+	}
+	// 空闲缓冲区已经足够多，直接归还给系统
+	freeClass(buffer, index);
+}
+
+void initArena(Arena *arena, size_t blockSize) {
+	arena->head = NULL;
+	arena->current = NULL;
+	arena->blockSize = blockSize;
+}
+
+/**
+ * @brief 在 current 之后插入一个至少能容纳 size 字节的新内存块
+ * @param arena Arena
+ * @param size 需要的字节数，不包括头部
+ * @return 新的内存块
+ */
+static ArenaBlock *newBlock(Arena *arena, size_t size) {
+	size_t capacity;
+	size_t need = size + BLOCK_HEADER;
+	ArenaBlock *block = acquireBuffer(need > arena->blockSize ? need : arena->blockSize, &capacity);
+	block->capacity = capacity;
+	block->used = BLOCK_HEADER;
+	if (arena->current == NULL) {
+		block->next = arena->head;
+		arena->head = block;
+	} else {
+		block->next = arena->current->next;
+		arena->current->next = block;
+	}
+	arena->current = block;
+	return block;
+}
+
+void *arenaAlloc(Arena *arena, size_t size) {
+	size = (size + 15) & ~(size_t)15;
+	ArenaBlock *block = arena->current;
+	// 重置后的内存块依次复用，空间不够时跳到下一个
+	while (block != NULL && block->capacity - block->used < size) {
+		block = block->next;
+		if (block != NULL) {
+			arena->current = block;
+		}
+	}
+	if (block == NULL) {
+		block = newBlock(arena, size);
+	}
+	void *memory = (char *)block + block->used;
+	block->used += size;
+	return memory;
+}
+
+void resetArena(Arena *arena) {
+	for (ArenaBlock *block = arena->head; block != NULL; block = block->next) {
+		block->used = BLOCK_HEADER;
+	}
+	arena->current = arena->head;
+}
+
+void freeArena(Arena *arena) {
+	ArenaBlock *block = arena->head;
+	while (block != NULL) {
+		ArenaBlock *next = block->next;
+		releaseBuffer(block, block->capacity);
+		block = next;
+	}
+	initArena(arena, arena->blockSize);
+}
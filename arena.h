@@ -0,0 +1,74 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Arena 内存块
+ * @details 内存块的头部，后面紧跟可分配的空间，具体定义见 arena.c
+ */
+typedef struct ArenaBlock ArenaBlock;
+
+/**
+ * @brief Arena 分配器
+ * @details 顺序分配内存的分配器，不支持单独释放，只能整体重置。\n
+ * 重置时保留已经申请的内存块，下一轮分配时直接复用，避免反复向系统申请内存。
+ */
+typedef struct {
+	ArenaBlock *head;    ///< 第一个内存块
+	ArenaBlock *current; ///< 当前正在分配的内存块
+	size_t blockSize;    ///< 新内存块的默认大小
+} Arena;
+
+/**
+ * @brief 设置是否使用大页
+ * @details 开启后，不小于 2 MiB 的缓冲区会先尝试 MAP_HUGETLB 分配，
+ * 失败时退回普通映射并通过 madvise(MADV_HUGEPAGE) 建议内核使用透明大页。
+ * @param enabled 是否使用大页
+ */
+void enableHugePages(bool enabled);
+
+/**
+ * @brief 从当前线程的缓冲池取得一个缓冲区
+ * @details 缓冲区按 2 的幂次分级，从 4 KiB 开始。同级别有空闲缓冲区时直接复用，否则新申请。
+ * @param size 需要的字节数
+ * @param capacity 输出参数，返回缓冲区的实际容量，可以为 NULL
+ * @return 缓冲区，内容未初始化
+ * @note 使用完毕后调用 releaseBuffer 归还，申请失败时打印错误信息并退出程序。
+ */
+void *acquireBuffer(size_t size, size_t *capacity);
+
+/**
+ * @brief 把缓冲区归还到当前线程的缓冲池
+ * @param buffer acquireBuffer 返回的缓冲区，可以为 NULL
+ * @param size 申请时传入的字节数或返回的容量
+ */
+void releaseBuffer(void *buffer, size_t size);
+
+/**
+ * @brief 初始化 Arena
+ * @param arena 待初始化的 Arena
+ * @param blockSize 每个内存块的默认大小
+ */
+void initArena(Arena *arena, size_t blockSize);
+
+/**
+ * @brief 从 Arena 分配内存
+ * @details 返回的内存按 16 字节对齐，大于内存块默认大小的请求会单独申请一个内存块。
+ * @param arena Arena
+ * @param size 需要的字节数
+ * @return 分配到的内存，内容未初始化
+ */
+void *arenaAlloc(Arena *arena, size_t size);
+
+/**
+ * @brief 重置 Arena
+ * @details 之前分配的内存全部失效，但内存块不归还，下次分配时复用。
+ * @param arena Arena
+ */
+void resetArena(Arena *arena);
+
+/**
+ * @brief 释放 Arena 的全部内存块，归还到缓冲池
+ * @param arena Arena
+ */
+void freeArena(Arena *arena);
@@ -0,0 +1,72 @@
+#include <string.h>
+
+#include "arena.h"
+#include "batch.h"
+#include "kernels.h"
+
+void initTokenBuffer(TokenBuffer *buffer) {
+	buffer->tokens = NULL;
+	buffer->count = 0;
+	buffer->capacity = 0;
+}
+
+void freeTokenBuffer(TokenBuffer *buffer) {
+	releaseBuffer(buffer->tokens, buffer->capacity * sizeof(Token));
+	initTokenBuffer(buffer);
+}
+
+void reserveTokens(TokenBuffer *buffer, size_t capacity) {
+	if (capacity <= buffer->capacity) {
+		return;
+	}
+	size_t bytes;
+	Token *tokens = acquireBuffer(capacity * sizeof(Token), &bytes);
+	if (buffer->count > 0) {
+		memcpy(tokens, buffer->tokens, buffer->count * sizeof(Token));
+	}
+	releaseBuffer(buffer->tokens, buffer->capacity * sizeof(Token));
+	buffer->tokens = tokens;
+	buffer->capacity = bytes / sizeof(Token);
+}
+
+void scanAll(const char *source, size_t length, unsigned features, TokenBuffer *buffer) {
+	// 上界估算保证一次分配就足够，正常情况下 scanTokens 一次就能扫描完整个源码
+	reserveTokens(buffer, estimateTokenCount(source, length));
+	buffer->count = 0;
+	initScannerWithFeatures(source, features);
+	for (;;) {
+		buffer->count += scanTokens(buffer->tokens + buffer->count, buffer->capacity - buffer->count);
+		if (buffer->count > 0 && buffer->tokens[buffer->count - 1].type == TOKEN_EOF) {
+			break;
+		}
+		reserveTokens(buffer, buffer->capacity * 2); // 估算失准时的兜底，正常情况下不会执行
+	}
+}
+
+size_t reconstructSource(const TokenBuffer *buffer, const TriviaTable *trivia, const char *source, char *out) {
+	const char *cursor = source; // 当前还原到的源码位置，用于定位注释和错误 Token
+	char *p = out;
+	for (size_t i = 0; i < buffer->count && i < trivia->tokenCount; i++) {
+		size_t end = i + 1 < trivia->tokenCount ? trivia->firstRun[i + 1] : trivia->runCount;
+		for (size_t r = trivia->firstRun[i]; r < end; r++) {
+			size_t length = TRIVIA_LENGTH(trivia->runs[r]);
+			switch (TRIVIA_KIND(trivia->runs[r])) {
+				case TRIVIA_SPACE: memset(p, ' ', length); break;
+				case TRIVIA_TAB: memset(p, '\t', length); break;
+				case TRIVIA_NEWLINE: memset(p, '\n', length); break;
+				case TRIVIA_CARRIAGE_RETURN: memset(p, '\r', length); break;
+				case TRIVIA_COMMENT:
+				case TRIVIA_SKIPPED: memcpy(p, cursor, length); break;
+			}
+			p += length;
+			cursor += length;
+		}
+		const Token *token = &buffer->tokens[i];
+		if (token->type != TOKEN_ERROR && token->type != TOKEN_EOF) {
+			memcpy(p, token->start, (size_t)token->length);
+			p += token->length;
+			cursor += token->length;
+		}
+	}
+	return (size_t)(p - out);
+}
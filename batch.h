@@ -0,0 +1,59 @@
+#pragma once
+#include <stddef.h>
+
+#include "scanner.h"
+
+/**
+ * @brief Token 缓冲区
+ * @details 保存一次批量词法分析得到的全部 Token，最后一个 Token 总是 TOKEN_EOF
+ */
+typedef struct {
+	Token *tokens;   ///< Token 数组
+	size_t count;    ///< 已保存的 Token 数量
+	size_t capacity; ///< Token 数组的容量
+} TokenBuffer;
+
+/**
+ * @brief 初始化一个空的 Token 缓冲区
+ * @param buffer 待初始化的缓冲区
+ */
+void initTokenBuffer(TokenBuffer *buffer);
+
+/**
+ * @brief 释放 Token 缓冲区占用的内存，并重新初始化为空
+ * @param buffer 待释放的缓冲区
+ */
+void freeTokenBuffer(TokenBuffer *buffer);
+
+/**
+ * @brief 保证缓冲区至少能容纳 capacity 个 Token，原有的 Token 保持不变
+ * @details 缓冲区从当前线程的缓冲池取得，多个文件之间复用
+ * @param buffer Token 缓冲区
+ * @param capacity 需要的容量
+ */
+void reserveTokens(TokenBuffer *buffer, size_t capacity);
+
+/**
+ * @brief 批量词法分析整段源码
+ * @details 先用 estimateTokenCount 估算 Token 数量的上界，一次性分配好缓冲区，
+ * 然后连续调用 scanToken 把全部 Token 写入缓冲区，扫描过程中不需要再扩容。\n
+ * 缓冲区原有的内容会被清空，已分配的空间足够时直接复用。
+ * @param source 源代码字符串，必须以空字符结尾
+ * @param length 源代码的字节数
+ * @param features ScanFeature 的组合，决定使用哪一个特化的扫描循环
+ * @param buffer 保存结果的缓冲区
+ * @note 错误 Token 的 start 指向词法分析器内部的错误信息缓冲区，只有最后一个错误 Token 的信息是准确的。
+ */
+void scanAll(const char *source, size_t length, unsigned features, TokenBuffer *buffer);
+
+/**
+ * @brief 根据 Token 和 Trivia 表无损还原源码
+ * @details 空白按游程编码直接生成，注释和错误 Token 覆盖的字节从源码中复制，其余 Token 复制其字符序列。\n
+ * 要求 buffer 和 trivia 来自同一次启用了 SCAN_TRIVIA 的 scanAll。
+ * @param buffer scanAll 得到的 Token
+ * @param trivia 同一次扫描的 Trivia 表，即 scannerTrivia() 的返回值
+ * @param source 扫描时使用的源代码
+ * @param out 输出缓冲区，容量不小于源代码的字节数
+ * @return 写入 out 的字节数，等于源代码中第一个空字符之前的字节数
+ */
+size_t reconstructSource(const TokenBuffer *buffer, const TriviaTable *trivia, const char *source, char *out);
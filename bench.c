@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "batch.h"
+#include "bench.h"
+#include "kernels.h"
+#include "tools.h"
+#include "validate.h"
+
+/**
+ * @brief 每项测量重复的次数，取最短耗时以减少噪声
+ */
+#define BENCH_REPEAT 5
+
+/**
+ * @brief 读取单调时钟
+ * @return 当前时间，单位为秒
+ */
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief 计算吞吐量
+ * @param bytes 处理的字节数
+ * @param seconds 耗时，单位为秒
+ * @return 吞吐量，单位为 MB/s
+ */
+static double throughput(size_t bytes, double seconds) {
+	return seconds > 0 ? (double)bytes / seconds / 1e6 : 0;
+}
+
+void runBenchmark(int count, const char *paths[]) {
+	TokenBuffer buffer;
+	initTokenBuffer(&buffer);
+	size_t totalBytes = 0, totalTokens = 0, totalEstimate = 0;
+	double totalEstimateTime = 0, totalValidateTime = 0, totalScanTime = 0;
+	printf("%-32s %12s %12s %8s %12s %12s %12s\n",
+	       "文件", "Token", "估算", "比值", "估算 MB/s", "校验 MB/s", "分析 MB/s");
+	for (int i = 0; i < count; i++) {
+		size_t length;
+		char *source = readFile(paths[i], &length);
+		double estimateTime = 1e30, validateTime = 1e30, scanTime = 1e30;
+		size_t estimate = 0;
+		for (int r = 0; r < BENCH_REPEAT; r++) {
+			double t0 = now();
+			estimate = estimateTokenCount(source, length);
+			double t1 = now();
+			validateSource(source, length, NULL);
+			double t2 = now();
+			scanAll(source, length, SCAN_DEFAULT, &buffer);
+			double t3 = now();
+			if (t1 - t0 < estimateTime) estimateTime = t1 - t0;
+			if (t2 - t1 < validateTime) validateTime = t2 - t1;
+			if (t3 - t2 < scanTime) scanTime = t3 - t2;
+		}
+		printf("%-32s %12zu %12zu %8.2f %12.1f %12.1f %12.1f\n", paths[i], buffer.count, estimate,
+		       (double)estimate / (double)buffer.count, throughput(length, estimateTime),
+		       throughput(length, validateTime), throughput(length, scanTime));
+		totalBytes += length;
+		totalTokens += buffer.count;
+		totalEstimate += estimate;
+		totalEstimateTime += estimateTime;
+		totalValidateTime += validateTime;
+		totalScanTime += scanTime;
+		releaseFile(source, length);
+	}
+	if (count > 0) {
+		printf("%-32s %12zu %12zu %8.2f %12.1f %12.1f %12.1f\n", "总计", totalTokens, totalEstimate,
+		       (double)totalEstimate / (double)totalTokens, throughput(totalBytes, totalEstimateTime),
+		       throughput(totalBytes, totalValidateTime), throughput(totalBytes, totalScanTime));
+	}
+	freeTokenBuffer(&buffer);
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+/**
+ * @brief 对文件运行词法分析基准测试
+ * @details 对每个文件分别测量 Token 数量估算、只校验模式和批量词法分析的耗时与吞吐量，
+ * 并报告估算的 Token 数量与实际数量的比值，最后打印所有文件的汇总。
+ * @param count 文件数量
+ * @param paths 文件路径数组
+ */
+void runBenchmark(int count, const char *paths[]);
@@ -0,0 +1,381 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "chunk.h"
+#include "kernels.h"
+#include "parallel.h"
+
+/**
+ * @brief 块的最小字节数，小于此大小时不切分
+ */
+#define CHUNK_MIN (8 * 1024)
+
+/**
+ * @brief 块的最大字节数，达到后在下一个行尾强制切分
+ */
+#define CHUNK_MAX (64 * 1024)
+
+/**
+ * @brief 行尾哈希值与此掩码按位与为 0 时切分，每 128 个行尾约切分一次
+ */
+#define CHUNK_MASK 127
+
+/**
+ * @brief 决定切分位置的窗口大小，即行尾之前参与计算哈希值的字节数
+ */
+#define CHUNK_WINDOW 16
+
+/**
+ * @brief 扫描块时每批生成的 Token 数量
+ */
+#define CHUNK_BATCH 512
+
+/**
+ * @brief 缓存的 Token，位置相对块的开头
+ */
+typedef struct {
+	uint32_t offset; ///< 在块内的字节偏移
+	uint32_t line;   ///< 在块内的行号，从 0 开始
+	uint32_t column; ///< 所在行的第几个字节，从 1 开始
+	uint32_t length; ///< 字节数，错误 Token 为其在源码中对应的字节数
+	uint32_t type;   ///< TokenType
+} ChunkToken;
+
+/**
+ * @brief 一个缓存的块
+ */
+struct ChunkEntry {
+	uint64_t hash;          ///< 块内容的哈希值
+	size_t length;          ///< 块的字节数
+	ChunkToken *tokens;     ///< 块内的 Token，不包括 TOKEN_EOF
+	size_t tokenCount;      ///< Token 数量
+	unsigned long lastUsed; ///< 最近一次用到该块的 lexChunked 的轮次
+	const char *source;     ///< 块的内容，只在加入缓存的那一次 lexChunked 中有效，用于扫描
+};
+
+/**
+ * @brief 源码中的一个块
+ */
+typedef struct {
+	ChunkEntry *entry; ///< 块的缓存
+	size_t offset;     ///< 块在源码中的起始位置
+	size_t line;       ///< 块的第一行的行号，从 1 开始
+} ChunkRef;
+
+/**
+ * @brief 一次分块词法分析的切分结果
+ */
+typedef struct {
+	ChunkRef *refs;         ///< 按位置排列的块
+	size_t refCount;        ///< 块的数量
+	size_t refCapacity;     ///< refs 的容量
+	ChunkEntry **missing;   ///< 缓存中没有、需要扫描的块
+	size_t missingCount;    ///< 需要扫描的块的数量
+	size_t missingCapacity; ///< missing 的容量
+	ChunkStats stats;       ///< 统计
+} ChunkPlan;
+
+/**
+ * @brief 申请内存，失败时打印错误信息并退出程序
+ */
+static void *allocateOrDie(size_t size) {
+	void *result = malloc(size > 0 ? size : 1);
+	if (result == NULL) {
+		fprintf(stderr, "内存不足，无法分块词法分析.\n");
+		exit(1);
+	}
+	return result;
+}
+
+void initChunkCache(ChunkCache *cache, size_t budget) {
+	cache->slotCount = 1024;
+	cache->slots = calloc(cache->slotCount, sizeof(ChunkEntry *));
+	if (cache->slots == NULL) {
+		fprintf(stderr, "内存不足，无法分块词法分析.\n");
+		exit(1);
+	}
+	cache->entryCount = 0;
+	cache->bytes = 0;
+	cache->budget = budget;
+	cache->generation = 0;
+}
+
+void freeChunkCache(ChunkCache *cache) {
+	for (size_t i = 0; i < cache->slotCount; i++) {
+		if (cache->slots[i] != NULL) {
+			free(cache->slots[i]->tokens);
+			free(cache->slots[i]);
+		}
+	}
+	free(cache->slots);
+	cache->slots = NULL;
+	cache->slotCount = 0;
+	cache->entryCount = 0;
+	cache->bytes = 0;
+}
+
+/**
+ * @brief 把块放入哈希表中的空槽
+ */
+static void placeEntry(ChunkEntry **slots, size_t slotCount, ChunkEntry *entry) {
+	size_t slot = (size_t)entry->hash & (slotCount - 1);
+	while (slots[slot] != NULL) {
+		slot = (slot + 1) & (slotCount - 1);
+	}
+	slots[slot] = entry;
+}
+
+/**
+ * @brief 重建哈希表，同时去掉已经淘汰的块
+ * @param cache 块缓存
+ * @param slotCount 新的槽数量，必须是 2 的幂且大于保留的块数量的两倍
+ */
+static void rebuildTable(ChunkCache *cache, size_t slotCount) {
+	ChunkEntry **slots = calloc(slotCount, sizeof(ChunkEntry *));
+	if (slots == NULL) {
+		fprintf(stderr, "内存不足，无法分块词法分析.\n");
+		exit(1);
+	}
+	for (size_t i = 0; i < cache->slotCount; i++) {
+		ChunkEntry *entry = cache->slots[i];
+		if (entry == NULL) {
+			continue;
+		}
+		if (entry->tokens != NULL || entry->source != NULL) {
+			placeEntry(slots, slotCount, entry);
+		} else {
+			free(entry); // evictEntries 淘汰的块
+		}
+	}
+	free(cache->slots);
+	cache->slots = slots;
+	cache->slotCount = slotCount;
+}
+
+/**
+ * @brief 按最近一次使用的轮次比较两个块，用于 qsort
+ */
+static int compareLastUsed(const void *a, const void *b) {
+	unsigned long x = (*(ChunkEntry *const *)a)->lastUsed, y = (*(ChunkEntry *const *)b)->lastUsed;
+	return x < y ? -1 : x > y;
+}
+
+/**
+ * @brief 从最久没有用到的块开始淘汰，直到占用的字节数不超过上限的一半
+ * @details 一次淘汰到一半，使排序的代价分摊到之后多次 lexChunked 中；本轮用到的块总是保留
+ * @param cache 块缓存
+ */
+static void evictEntries(ChunkCache *cache) {
+	ChunkEntry **entries = allocateOrDie(cache->entryCount * sizeof(ChunkEntry *));
+	size_t count = 0;
+	for (size_t i = 0; i < cache->slotCount; i++) {
+		if (cache->slots[i] != NULL) {
+			entries[count++] = cache->slots[i];
+		}
+	}
+	qsort(entries, count, sizeof(ChunkEntry *), compareLastUsed);
+	for (size_t i = 0; i < count && cache->bytes > cache->budget / 2; i++) {
+		if (entries[i]->lastUsed == cache->generation) {
+			break;
+		}
+		cache->bytes -= entries[i]->tokenCount * sizeof(ChunkToken);
+		cache->entryCount--;
+		free(entries[i]->tokens);
+		entries[i]->tokens = NULL;
+	}
+	free(entries);
+	rebuildTable(cache, cache->slotCount);
+}
+
+/**
+ * @brief 查找块，找不到时加入一个还没有扫描的块
+ * @param cache 块缓存
+ * @param source 块的内容
+ * @param length 块的字节数
+ * @param added 输出参数，是否新加入了块
+ * @return 块的缓存
+ * @note 只比较 64 位哈希值和长度，不同内容的块哈希值相同的概率可以忽略
+ */
+static ChunkEntry *findEntry(ChunkCache *cache, const char *source, size_t length, bool *added) {
+	uint64_t hash = hashBytes(source, length) ^ (uint64_t)length * 0x9E3779B97F4A7C15ULL;
+	size_t slot = (size_t)hash & (cache->slotCount - 1);
+	for (ChunkEntry *entry; (entry = cache->slots[slot]) != NULL; slot = (slot + 1) & (cache->slotCount - 1)) {
+		if (entry->hash == hash && entry->length == length) {
+			entry->lastUsed = cache->generation;
+			*added = false;
+			return entry;
+		}
+	}
+	ChunkEntry *entry = allocateOrDie(sizeof(ChunkEntry));
+	*entry = (ChunkEntry){hash, length, NULL, 0, cache->generation, source};
+	cache->slots[slot] = entry;
+	cache->entryCount++;
+	if (cache->entryCount * 2 > cache->slotCount) {
+		rebuildTable(cache, cache->slotCount * 2);
+	}
+	*added = true;
+	return entry;
+}
+
+/**
+ * @brief 计算行尾之前 CHUNK_WINDOW 个字节的哈希值
+ * @details 相当于窗口为 CHUNK_WINDOW 的滚动哈希，只在行尾取值。切分位置只取决于附近的内容，
+ * 插入或删除内容后，修改处之后的切分位置保持不变
+ * @param source 源代码
+ * @param end 行尾换行符的位置
+ * @return 哈希值
+ */
+static uint64_t windowHash(const char *source, size_t end) {
+	unsigned char window[CHUNK_WINDOW] = {0};
+	size_t length = end < CHUNK_WINDOW ? end : CHUNK_WINDOW;
+	memcpy(window + CHUNK_WINDOW - length, source + end - length, length);
+	uint64_t low, high;
+	memcpy(&low, window, sizeof(low));
+	memcpy(&high, window + sizeof(low), sizeof(high));
+	uint64_t hash = (low ^ 0x9E3779B97F4A7C15ULL) * 0xBF58476D1CE4E5B9ULL ^ high;
+	hash *= 0x94D049BB133111EBULL;
+	return hash ^ (hash >> 31);
+}
+
+/**
+ * @brief 扫描一个块，把 Token 保存到块的缓存中
+ * @details 块的内容复制到以空字符结尾的缓冲区后扫描，借助 Trivia 表定位每个 Token（包括错误 Token）在块内的位置
+ */
+static void scanChunkTask(size_t index, int worker, void *context) {
+	(void)worker;
+	ChunkEntry *entry = ((ChunkEntry **)context)[index];
+	size_t copyCapacity;
+	char *copy = acquireBuffer(entry->length + 1, &copyCapacity);
+	memcpy(copy, entry->source, entry->length);
+	copy[entry->length] = '\0';
+	entry->tokens = allocateOrDie(estimateTokenCount(copy, entry->length) * sizeof(ChunkToken));
+	Token tokens[CHUNK_BATCH];
+	initScannerWithFeatures(copy, SCAN_LINES | SCAN_COLUMNS | SCAN_KEYWORDS | SCAN_TRIVIA);
+	const TriviaTable *trivia = scannerTrivia();
+	size_t cursor = 0; // 上一个 Token 的结尾
+	for (size_t scanned = 0;;) {
+		size_t count = scanTokens(tokens, CHUNK_BATCH);
+		bool done = count > 0 && tokens[count - 1].type == TOKEN_EOF;
+		for (size_t i = 0; i < count && tokens[i].type != TOKEN_EOF; i++, scanned++) {
+			// 第 scanned 个 Token 的 Trivia 在返回时已经全部记录
+			size_t end = scanned + 1 < trivia->tokenCount ? trivia->firstRun[scanned + 1] : trivia->runCount;
+			size_t skipped = 0;
+			for (size_t r = trivia->firstRun[scanned]; r < end; r++) {
+				if (TRIVIA_KIND(trivia->runs[r]) == TRIVIA_SKIPPED) {
+					skipped += TRIVIA_LENGTH(trivia->runs[r]);
+				} else {
+					cursor += TRIVIA_LENGTH(trivia->runs[r]);
+				}
+			}
+			size_t length = tokens[i].type == TOKEN_ERROR ? skipped : (size_t)tokens[i].length;
+			entry->tokens[entry->tokenCount++] = (ChunkToken){(uint32_t)cursor, (uint32_t)tokens[i].line - 1,
+			                                                  (uint32_t)tokens[i].column, (uint32_t)length,
+			                                                  (uint32_t)tokens[i].type};
+			cursor += length;
+		}
+		if (done) {
+			break;
+		}
+	}
+	releaseBuffer(copy, copyCapacity);
+	ChunkToken *shrunk = realloc(entry->tokens, (entry->tokenCount > 0 ? entry->tokenCount : 1) * sizeof(ChunkToken));
+	if (shrunk != NULL) {
+		entry->tokens = shrunk;
+	}
+}
+
+/**
+ * @brief 记录源码中的一个块，缓存中没有时加入待扫描的列表
+ */
+static void addChunk(ChunkCache *cache, ChunkPlan *plan, const char *source, size_t start, size_t end, size_t line) {
+	bool added;
+	ChunkEntry *entry = findEntry(cache, source + start, end - start, &added);
+	if (added) {
+		if (plan->missingCount == plan->missingCapacity) {
+			plan->missingCapacity = plan->missingCapacity > 0 ? plan->missingCapacity * 2 : 16;
+			plan->missing = realloc(plan->missing, plan->missingCapacity * sizeof(ChunkEntry *));
+		}
+		if (plan->missing == NULL) {
+			fprintf(stderr, "内存不足，无法分块词法分析.\n");
+			exit(1);
+		}
+		plan->missing[plan->missingCount++] = entry;
+		plan->stats.scannedBytes += end - start;
+	} else {
+		plan->stats.reused++;
+	}
+	if (plan->refCount == plan->refCapacity) {
+		plan->refCapacity = plan->refCapacity > 0 ? plan->refCapacity * 2 : 64;
+		plan->refs = realloc(plan->refs, plan->refCapacity * sizeof(ChunkRef));
+		if (plan->refs == NULL) {
+			fprintf(stderr, "内存不足，无法分块词法分析.\n");
+			exit(1);
+		}
+	}
+	plan->refs[plan->refCount++] = (ChunkRef){entry, start, line};
+	plan->stats.chunks++;
+}
+
+ChunkStats lexChunked(ChunkCache *cache, const char *source, size_t length, TokenBuffer *buffer) {
+	const char *nul = memchr(source, '\0', length);
+	if (nul != NULL) {
+		length = (size_t)(nul - source);
+	}
+	cache->generation++;
+	ChunkPlan plan = {NULL, 0, 0, NULL, 0, 0, {0, 0, 0}};
+	// 沿行尾切分，同时统计每个块的行数
+	size_t start = 0, line = 1;
+	while (start < length) {
+		size_t end = length, lines = 0;
+		for (const char *newline = memchr(source + start, '\n', length - start); newline != NULL;
+		     newline = memchr(newline + 1, '\n', length - (size_t)(newline + 1 - source))) {
+			size_t position = (size_t)(newline - source), size = position + 1 - start;
+			lines++;
+			if (size >= CHUNK_MIN && (size >= CHUNK_MAX || (windowHash(source, position) & CHUNK_MASK) == 0)) {
+				end = position + 1;
+				break;
+			}
+		}
+		addChunk(cache, &plan, source, start, end, line);
+		line += lines;
+		start = end;
+	}
+	parallelFor(plan.missingCount, scanChunkTask, plan.missing);
+	for (size_t i = 0; i < plan.missingCount; i++) {
+		plan.missing[i]->source = NULL;
+		cache->bytes += plan.missing[i]->tokenCount * sizeof(ChunkToken);
+	}
+	size_t total = 1;
+	for (size_t i = 0; i < plan.refCount; i++) {
+		total += plan.refs[i].entry->tokenCount;
+	}
+	// 按块的起始位置和行号平移缓存的 Token
+	reserveTokens(buffer, total);
+	Token *out = buffer->tokens;
+	for (size_t i = 0; i < plan.refCount; i++) {
+		const ChunkEntry *entry = plan.refs[i].entry;
+		const char *base = source + plan.refs[i].offset;
+		int firstLine = (int)plan.refs[i].line;
+		for (size_t t = 0; t < entry->tokenCount; t++) {
+			const ChunkToken *token = &entry->tokens[t];
+			*out++ = (Token){(TokenType)token->type, base + token->offset, (int)token->length,
+			                 firstLine + (int)token->line, (int)token->column};
+		}
+	}
+	// TOKEN_EOF 位于最后一行的末尾
+	const char *lastLine = source + length;
+	while (lastLine > source && lastLine[-1] != '\n') {
+		lastLine--;
+	}
+	*out++ = (Token){TOKEN_EOF, source + length, 0, (int)line, (int)(source + length - lastLine) + 1};
+	buffer->count = (size_t)(out - buffer->tokens);
+	if (cache->bytes > cache->budget) {
+		evictEntries(cache);
+	}
+	free(plan.refs);
+	free(plan.missing);
+	return plan.stats;
+}
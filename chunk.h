@@ -0,0 +1,59 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "batch.h"
+
+typedef struct ChunkEntry ChunkEntry;
+
+/**
+ * @brief 块缓存
+ * @details 把源码按内容切分成块，以块内容的哈希值为键缓存每个块的 Token 序列。\n
+ * 块的边界由边界附近的内容决定，修改只影响所在的块，其余的块在修改前后内容相同，可以直接复用。
+ */
+typedef struct {
+	ChunkEntry **slots;       ///< 开放寻址的哈希表，空槽为 NULL
+	size_t slotCount;         ///< 槽的数量，总是 2 的幂
+	size_t entryCount;        ///< 已缓存的块数量
+	size_t bytes;             ///< 已缓存的 Token 占用的字节数
+	size_t budget;            ///< bytes 的上限，超过时从最久没有用到的块开始淘汰
+	unsigned long generation; ///< lexChunked 的调用次数，用于判断块最近是否被用到
+} ChunkCache;
+
+/**
+ * @brief 一次分块词法分析的统计
+ */
+typedef struct {
+	size_t chunks;       ///< 源码被切分成的块数
+	size_t reused;       ///< 直接复用缓存的块数
+	size_t scannedBytes; ///< 重新扫描的字节数
+} ChunkStats;
+
+/**
+ * @brief 初始化一个空的块缓存
+ * @param cache 块缓存
+ * @param budget 缓存的 Token 占用字节数的上限
+ */
+void initChunkCache(ChunkCache *cache, size_t budget);
+
+/**
+ * @brief 释放块缓存中的全部块
+ * @param cache 块缓存
+ */
+void freeChunkCache(ChunkCache *cache);
+
+/**
+ * @brief 分块词法分析整段源码，复用内容没有变化的块
+ * @details 在行尾切分：块不小于 CHUNK_MIN 字节后，行尾之前 16 个字节的哈希值满足条件时切分，
+ * 达到 CHUNK_MAX 字节后在下一个行尾强制切分。Token 不会跨行，行首总是安全的切分位置。\n
+ * 缓存中没有的块并行扫描后加入缓存，其余的块只需要按块的起始位置和行号平移 Token，
+ * 因此内容相近的大文件再次分析时，扫描的代价只与修改的大小有关。\n
+ * 结果与以 SCAN_LINES | SCAN_COLUMNS | SCAN_KEYWORDS 调用 scanAll 相同，
+ * 只是错误 Token 的 start 和 length 为其在源码中对应的字节，而不是错误信息。
+ * @param cache 块缓存
+ * @param source 源代码，只分析第一个空字符之前的部分
+ * @param length 源代码的字节数
+ * @param buffer 保存结果的缓冲区，最后一个 Token 为 TOKEN_EOF
+ * @return 本次分析的统计
+ */
+ChunkStats lexChunked(ChunkCache *cache, const char *source, size_t length, TokenBuffer *buffer);
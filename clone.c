@@ -0,0 +1,335 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "clone.h"
+#include "kernels.h"
+#include "parallel.h"
+#include "scanner.h"
+#include "tools.h"
+
+/**
+ * @brief 每批扫描的 Token 数量
+ */
+#define CLONE_BATCH 1024
+
+/**
+ * @brief 滚动哈希的基数
+ */
+#define ROLLING_BASE 0x100000001b3ULL
+
+/**
+ * @brief 指纹分桶时使用的哈希高位数量，共 2^8 个桶
+ */
+#define BUCKET_BITS 8
+
+/**
+ * @brief 同一哈希值出现次数超过这个值时视为常见代码（如样板代码），不再两两配对
+ */
+#define MAX_GROUP 64
+
+/**
+ * @brief 滚动哈希窗口的最大长度
+ */
+#define MAX_GRAM 256
+
+/**
+ * @brief 一个指纹
+ */
+typedef struct {
+	uint64_t hash; ///< k 个 Token 的滚动哈希值
+	uint32_t file; ///< 所在的文件编号
+	uint32_t line; ///< 第一个 Token 所在的行
+} Fingerprint;
+
+/**
+ * @brief 一组指纹
+ */
+typedef struct {
+	Fingerprint *items; ///< 指纹数组
+	size_t count;       ///< 指纹数量
+	size_t capacity;    ///< 数组的容量
+} FingerprintList;
+
+/**
+ * @brief 两个文件中的一处相同代码
+ */
+typedef struct {
+	uint32_t fileA; ///< 编号较小的文件
+	uint32_t lineA; ///< 在 fileA 中的行号
+	uint32_t fileB; ///< 编号较大的文件，同一文件内的克隆时与 fileA 相同
+	uint32_t lineB; ///< 在 fileB 中的行号
+} ClonePair;
+
+/**
+ * @brief 一组相同代码
+ */
+typedef struct {
+	ClonePair *items; ///< 数组
+	size_t count;     ///< 数量
+	size_t capacity;  ///< 数组的容量
+} PairList;
+
+/**
+ * @brief 并行检测时的共享状态
+ */
+typedef struct {
+	const FileList *files;       ///< 文件列表
+	const CloneOptions *options; ///< 检测参数
+	uint64_t basePower;          ///< ROLLING_BASE 的 k 次方，用于移出窗口最早的 Token
+	FingerprintList *perFile;    ///< 每个文件的指纹
+	FingerprintList *buckets;    ///< 分桶后的指纹
+	PairList *pairs;             ///< 每个桶找到的相同代码
+} CloneJob;
+
+/**
+ * @brief 申请内存，失败时打印错误信息并退出程序
+ */
+static void *reallocOrDie(void *memory, size_t size) {
+	void *result = realloc(memory, size);
+	if (result == NULL && size > 0) {
+		fprintf(stderr, "内存不足，无法检测代码克隆.\n");
+		exit(1);
+	}
+	return result;
+}
+
+/**
+ * @brief 追加一个指纹
+ */
+static void addFingerprint(FingerprintList *list, uint64_t hash, uint32_t file, uint32_t line) {
+	if (list->count == list->capacity) {
+		list->capacity = list->capacity < 256 ? 256 : list->capacity * 2;
+		list->items = reallocOrDie(list->items, list->capacity * sizeof(Fingerprint));
+	}
+	list->items[list->count++] = (Fingerprint){hash, file, line};
+}
+
+/**
+ * @brief 计算规范化后的 Token 值
+ * @param token Token
+ * @param abstract 是否把标识符和字面量抽象为其类型
+ * @return Token 值
+ */
+static uint64_t tokenValue(const Token *token, bool abstract) {
+	bool named = token->type == TOKEN_IDENTIFIER || token->type == TOKEN_NUMBER ||
+	             token->type == TOKEN_STRING || token->type == TOKEN_CHARACTER;
+	if (named && !abstract) {
+		return hashBytes(token->start, (size_t)token->length) ^ (uint64_t)token->type;
+	}
+	return ((uint64_t)token->type + 1) * 0x9e3779b97f4a7c15ULL;
+}
+
+/**
+ * @brief 计算一个文件的指纹
+ * @details 滚动哈希和 winnowing 都在扫描过程中完成，不保存整个 Token 流
+ * @param index 文件编号
+ * @param worker 工作线程编号
+ * @param context CloneJob
+ */
+static void fingerprintTask(size_t index, int worker, void *context) {
+	(void)worker;
+	CloneJob *job = context;
+	const CloneOptions *options = job->options;
+	FingerprintList *list = &job->perFile[index];
+	size_t length;
+	char *source = tryReadFile(job->files->paths[index], &length);
+	if (source == NULL) {
+		return; // 错误信息已由 tryReadFile 输出，跳过该文件
+	}
+	if (looksBinary(source, length)) {
+		releaseFile(source, length);
+		return;
+	}
+	int k = options->gramLength, w = options->window;
+	uint64_t values[MAX_GRAM];  // 最近 k 个 Token 的值，环形数组
+	uint32_t lines[MAX_GRAM];   // 最近 k 个 Token 的行号，环形数组
+	uint64_t hashes[MAX_GRAM];  // 最近 w 个滚动哈希，环形数组
+	uint32_t starts[MAX_GRAM];  // 最近 w 个滚动哈希的起始行号
+	uint64_t rolling = 0;
+	size_t tokenCount = 0, gramCount = 0;
+	size_t selected = SIZE_MAX; // 上一次选中的滚动哈希的序号
+	Token tokens[CLONE_BATCH];
+	initScannerWithFeatures(source, SCAN_LINES | SCAN_KEYWORDS);
+	for (bool done = false; !done;) {
+		size_t count = scanTokens(tokens, CLONE_BATCH);
+		for (size_t i = 0; i < count; i++) {
+			if (tokens[i].type == TOKEN_EOF) {
+				done = true;
+				break;
+			}
+			if (tokens[i].type == TOKEN_ERROR) {
+				continue; // 预处理指令等无法识别的内容不参与比较
+			}
+			uint64_t value = tokenValue(&tokens[i], options->abstract);
+			size_t slot = tokenCount % (size_t)k;
+			rolling = rolling * ROLLING_BASE + value;
+			if (tokenCount >= (size_t)k) {
+				rolling -= values[slot] * job->basePower; // 移出窗口中最早的 Token
+			}
+			values[slot] = value;
+			lines[slot] = (uint32_t)tokens[i].line;
+			tokenCount++;
+			if (tokenCount < (size_t)k) {
+				continue;
+			}
+			// 第一个 Token 即环形数组中的下一个位置
+			hashes[gramCount % (size_t)w] = rolling;
+			starts[gramCount % (size_t)w] = lines[tokenCount % (size_t)k];
+			gramCount++;
+			if (gramCount < (size_t)w) {
+				continue;
+			}
+			// winnowing：选出窗口中最小的哈希，相同时取最右边的一个，与上次选中的相同则不重复记录
+			size_t best = gramCount - 1;
+			for (size_t g = gramCount - (size_t)w; g < gramCount; g++) {
+				if (hashes[g % (size_t)w] <= hashes[best % (size_t)w]) {
+					best = g;
+				}
+			}
+			if (best != selected) {
+				selected = best;
+				addFingerprint(list, hashes[best % (size_t)w], (uint32_t)index, starts[best % (size_t)w]);
+			}
+		}
+	}
+	releaseFile(source, length);
+}
+
+/**
+ * @brief 按哈希值比较两个指纹，哈希相同时按文件和行号排序以保证结果稳定
+ */
+static int compareFingerprints(const void *a, const void *b) {
+	const Fingerprint *x = a, *y = b;
+	if (x->hash != y->hash) {
+		return x->hash < y->hash ? -1 : 1;
+	}
+	if (x->file != y->file) {
+		return x->file < y->file ? -1 : 1;
+	}
+	return x->line < y->line ? -1 : x->line > y->line;
+}
+
+/**
+ * @brief 在一个桶中找出哈希相同的指纹对
+ * @param index 桶编号
+ * @param worker 工作线程编号
+ * @param context CloneJob
+ */
+static void bucketTask(size_t index, int worker, void *context) {
+	(void)worker;
+	CloneJob *job = context;
+	FingerprintList *bucket = &job->buckets[index];
+	PairList *pairs = &job->pairs[index];
+	qsort(bucket->items, bucket->count, sizeof(Fingerprint), compareFingerprints);
+	for (size_t start = 0; start < bucket->count;) {
+		size_t end = start + 1;
+		while (end < bucket->count && bucket->items[end].hash == bucket->items[start].hash) {
+			end++;
+		}
+		if (end - start <= MAX_GROUP) {
+			for (size_t i = start; i < end; i++) {
+				for (size_t j = i + 1; j < end; j++) {
+					const Fingerprint *a = &bucket->items[i], *b = &bucket->items[j];
+					if (a->file == b->file && a->line == b->line) {
+						continue;
+					}
+					if (pairs->count == pairs->capacity) {
+						pairs->capacity = pairs->capacity < 256 ? 256 : pairs->capacity * 2;
+						pairs->items = reallocOrDie(pairs->items, pairs->capacity * sizeof(ClonePair));
+					}
+					pairs->items[pairs->count++] = (ClonePair){a->file, a->line, b->file, b->line};
+				}
+			}
+		}
+		start = end;
+	}
+}
+
+/**
+ * @brief 按文件对比较两处相同代码，文件对相同时按行号排序
+ */
+static int comparePairs(const void *a, const void *b) {
+	const ClonePair *x = a, *y = b;
+	if (x->fileA != y->fileA) {
+		return x->fileA < y->fileA ? -1 : 1;
+	}
+	if (x->fileB != y->fileB) {
+		return x->fileB < y->fileB ? -1 : 1;
+	}
+	if (x->lineA != y->lineA) {
+		return x->lineA < y->lineA ? -1 : 1;
+	}
+	return x->lineB < y->lineB ? -1 : x->lineB > y->lineB;
+}
+
+size_t detectClones(const FileList *files, const CloneOptions *options, FILE *out) {
+	size_t fileCount = (size_t)files->count;
+	size_t bucketCount = (size_t)1 << BUCKET_BITS;
+	CloneJob job;
+	job.files = files;
+	job.options = options;
+	job.basePower = 1;
+	for (int i = 0; i < options->gramLength; i++) {
+		job.basePower *= ROLLING_BASE;
+	}
+	job.perFile = reallocOrDie(NULL, (fileCount + 1) * sizeof(FingerprintList));
+	job.buckets = reallocOrDie(NULL, bucketCount * sizeof(FingerprintList));
+	job.pairs = reallocOrDie(NULL, bucketCount * sizeof(PairList));
+	memset(job.perFile, 0, (fileCount + 1) * sizeof(FingerprintList));
+	memset(job.buckets, 0, bucketCount * sizeof(FingerprintList));
+	memset(job.pairs, 0, bucketCount * sizeof(PairList));
+	parallelFor(fileCount, fingerprintTask, &job);
+
+	// 按哈希值的高位分桶，先统计每个桶的大小，一次分配好空间
+	for (size_t f = 0; f < fileCount; f++) {
+		for (size_t i = 0; i < job.perFile[f].count; i++) {
+			job.buckets[job.perFile[f].items[i].hash >> (64 - BUCKET_BITS)].capacity++;
+		}
+	}
+	for (size_t b = 0; b < bucketCount; b++) {
+		job.buckets[b].items = reallocOrDie(NULL, (job.buckets[b].capacity + 1) * sizeof(Fingerprint));
+	}
+	for (size_t f = 0; f < fileCount; f++) {
+		for (size_t i = 0; i < job.perFile[f].count; i++) {
+			const Fingerprint *print = &job.perFile[f].items[i];
+			FingerprintList *bucket = &job.buckets[print->hash >> (64 - BUCKET_BITS)];
+			bucket->items[bucket->count++] = *print;
+		}
+		free(job.perFile[f].items);
+	}
+	parallelFor(bucketCount, bucketTask, &job);
+
+	// 合并各桶的结果，按文件对汇总
+	PairList all = {NULL, 0, 0};
+	for (size_t b = 0; b < bucketCount; b++) {
+		all.items = reallocOrDie(all.items, (all.count + job.pairs[b].count + 1) * sizeof(ClonePair));
+		if (job.pairs[b].count > 0) {
+			memcpy(all.items + all.count, job.pairs[b].items, job.pairs[b].count * sizeof(ClonePair));
+		}
+		all.count += job.pairs[b].count;
+		free(job.pairs[b].items);
+		free(job.buckets[b].items);
+	}
+	qsort(all.items, all.count, sizeof(ClonePair), comparePairs);
+	size_t reported = 0;
+	for (size_t start = 0; start < all.count;) {
+		size_t end = start + 1;
+		while (end < all.count && all.items[end].fileA == all.items[start].fileA &&
+		       all.items[end].fileB == all.items[start].fileB) {
+			end++;
+		}
+		if (end - start >= (size_t)options->minShared) {
+			const ClonePair *first = &all.items[start];
+			fprintf(out, "%s:%u  %s:%u  共同指纹 %zu 个\n", files->paths[first->fileA], first->lineA,
+			        files->paths[first->fileB], first->lineB, end - start);
+			reported++;
+		}
+		start = end;
+	}
+	free(all.items);
+	free(job.perFile);
+	free(job.buckets);
+	free(job.pairs);
+	return reported;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "files.h"
+
+/**
+ * @brief 代码克隆检测的参数
+ */
+typedef struct {
+	int gramLength; ///< 每个指纹覆盖的 Token 数量 k
+	int window;     ///< 筛选窗口的大小 w，每 w 个连续的指纹中至少保留一个
+	int minShared;  ///< 报告一对克隆所需的最少共同指纹数量
+	bool abstract;  ///< 是否把标识符和字面量抽象为其类型，以便发现改名后的克隆
+} CloneOptions;
+
+/**
+ * @brief 在一组文件中检测代码克隆
+ * @details 先把 Token 流规范化（可选地把标识符和字面量替换为其类型），对每 k 个连续 Token 计算滚动哈希，
+ * 再用 winnowing 算法在每 w 个连续哈希中选出最小值作为文件的指纹，各文件并行处理。\n
+ * 所有指纹按哈希值的高位分到多个桶中，各桶并行排序并找出哈希相同的指纹对，最后按文件对汇总，
+ * 输出共同指纹不少于 minShared 个的文件对及其第一处相同代码的行号。
+ * @param files 文件列表
+ * @param options 检测参数
+ * @param out 输出目标
+ * @return 报告的克隆对数量
+ */
+size_t detectClones(const FileList *files, const CloneOptions *options, FILE *out);
@@ -0,0 +1,468 @@
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "batch.h"
+#include "chunk.h"
+#include "decompress.h"
+
+/**
+ * @brief 每个解压缓冲区的字节数
+ */
+#define DECOMPRESS_BUFFER ((size_t)4 << 20)
+
+/**
+ * @brief 每次从输入读取的压缩数据的字节数
+ */
+#define DECOMPRESS_INPUT ((size_t)256 << 10)
+
+/**
+ * @brief 分块缓存的 Token 占用内存的上限
+ */
+#define DECOMPRESS_CACHE_BUDGET ((size_t)64 << 20)
+
+/**
+ * @brief 单行的最大字节数，更长的行作为错误跳过，不会无限地积累在内存中
+ */
+#define DECOMPRESS_LINE_MAX DECOMPRESS_BUFFER
+
+/**
+ * @brief 输入的压缩格式
+ */
+typedef enum {
+	FORMAT_PLAIN, ///< 未压缩
+	FORMAT_GZIP,  ///< gzip，可以由多个成员拼接而成
+	FORMAT_ZSTD,  ///< zstd，可以由多个帧拼接而成
+} CompressionFormat;
+
+/**
+ * @brief 解压线程与分析线程之间交替使用的缓冲区
+ */
+typedef struct {
+	char *data;    ///< 解压后的数据，多留一个字节用于写入空字符
+	size_t length; ///< 数据的字节数，为 0 表示输入已经结束
+	bool full;     ///< 是否已经写满，等待分析线程取走
+} DecompressSlot;
+
+/**
+ * @brief 一个文件的流式解压状态
+ */
+typedef struct {
+	int fd;                   ///< 输入的文件描述符
+	CompressionFormat format; ///< 压缩格式
+	unsigned char *input;     ///< 压缩数据的读取缓冲区
+	size_t inputLength;       ///< 读取缓冲区中还没有交给解压器的字节数
+	bool eof;                 ///< 输入是否已经读完
+	bool ended;               ///< 最后一个 gzip 成员或 zstd 帧是否完整
+	bool failed;              ///< 是否发生了读取或解压错误
+	uint64_t compressed;      ///< 已经读取的压缩数据的字节数
+	z_stream zlib;            ///< gzip 解压器
+#ifdef HAVE_ZSTD
+	ZSTD_DStream *zstd;       ///< zstd 解压器
+#endif
+	DecompressSlot slots[2];  ///< 交替使用的缓冲区
+	pthread_mutex_t mutex;    ///< 保护 slots 的 full 和 length
+	pthread_cond_t changed;   ///< 缓冲区被写满或取走时通知
+} Decompressor;
+
+/**
+ * @brief 一个文件的分析结果
+ */
+typedef struct {
+	uint64_t bytes;       ///< 解压后的字节数
+	uint64_t lines;       ///< 已经分析的行数
+	uint64_t tokens;      ///< Token 数量，不包括 TOKEN_EOF
+	uint64_t errors;      ///< 错误 Token 数量
+	char *carry;          ///< 上一个缓冲区末尾不完整的行
+	size_t carryLength;   ///< carry 的字节数
+	size_t carryCapacity; ///< carry 的容量
+	bool skipping;        ///< 是否正在跳过一个过长的行，直到下一个行尾
+	const char *path;     ///< 文件路径，用于报告过长的行
+} LexProgress;
+
+/**
+ * @brief 重新分配内存，失败时打印错误信息并退出程序
+ */
+static void *reallocOrDie(void *memory, size_t size) {
+	void *result = realloc(memory, size > 0 ? size : 1);
+	if (result == NULL) {
+		fprintf(stderr, "内存不足，无法解压.\n");
+		exit(1);
+	}
+	return result;
+}
+
+/**
+ * @brief 把读取缓冲区补满，或者读到输入结尾
+ */
+static void readInput(Decompressor *d) {
+	while (!d->eof && d->inputLength < DECOMPRESS_INPUT) {
+		ssize_t n = read(d->fd, d->input + d->inputLength, DECOMPRESS_INPUT - d->inputLength);
+		if (n < 0) {
+			d->failed = true;
+		}
+		if (n <= 0) {
+			d->eof = true;
+			break;
+		}
+		d->inputLength += (size_t)n;
+		d->compressed += (uint64_t)n;
+	}
+}
+
+/**
+ * @brief 把 gzip 数据解压到 out
+ * @return 写入的字节数，输入结束或出错时可能少于 capacity
+ */
+static size_t inflateInto(Decompressor *d, char *out, size_t capacity) {
+	z_stream *zs = &d->zlib;
+	zs->next_out = (Bytef *)out;
+	zs->avail_out = (uInt)capacity;
+	while (zs->avail_out > 0 && !d->failed) {
+		if (zs->avail_in == 0) {
+			d->inputLength = 0;
+			readInput(d);
+			zs->next_in = d->input;
+			zs->avail_in = (uInt)d->inputLength;
+			if (d->inputLength == 0) {
+				d->failed = !d->ended;
+				break;
+			}
+		}
+		int status = inflate(zs, Z_NO_FLUSH);
+		if (status == Z_STREAM_END) {
+			// 多个 gzip 成员拼接时，后面的成员接着解压
+			d->ended = true;
+			inflateReset(zs);
+		} else if (status == Z_OK || status == Z_BUF_ERROR) {
+			d->ended = d->ended && zs->total_in == 0;
+		} else {
+			d->failed = true;
+		}
+	}
+	return capacity - zs->avail_out;
+}
+
+#ifdef HAVE_ZSTD
+/**
+ * @brief 把 zstd 数据解压到 out
+ * @return 写入的字节数，输入结束或出错时可能少于 capacity
+ */
+static size_t zstdInto(Decompressor *d, char *out, size_t capacity) {
+	ZSTD_outBuffer output = {out, capacity, 0};
+	ZSTD_inBuffer input = {d->input, d->inputLength, 0};
+	while (output.pos < output.size && !d->failed) {
+		if (input.pos == input.size) {
+			d->inputLength = 0;
+			readInput(d);
+			input = (ZSTD_inBuffer){d->input, d->inputLength, 0};
+			if (d->inputLength == 0) {
+				d->failed = !d->ended;
+				break;
+			}
+		}
+		size_t status = ZSTD_decompressStream(d->zstd, &output, &input);
+		if (ZSTD_isError(status)) {
+			d->failed = true;
+		} else {
+			d->ended = status == 0;
+		}
+	}
+	// 没有用完的输入移到读取缓冲区的开头，下次继续
+	d->inputLength = input.size - input.pos;
+	memmove(d->input, (const unsigned char *)input.src + input.pos, d->inputLength);
+	return output.pos;
+}
+#endif
+
+/**
+ * @brief 把未压缩的输入直接读到 out
+ * @return 写入的字节数，输入结束时可能少于 capacity
+ */
+static size_t copyInto(Decompressor *d, char *out, size_t capacity) {
+	size_t length = d->inputLength < capacity ? d->inputLength : capacity;
+	memcpy(out, d->input, length);
+	memmove(d->input, d->input + length, d->inputLength - length);
+	d->inputLength -= length;
+	while (length < capacity && !d->eof) {
+		ssize_t n = read(d->fd, out + length, capacity - length);
+		if (n < 0) {
+			d->failed = true;
+		}
+		if (n <= 0) {
+			d->eof = true;
+			break;
+		}
+		length += (size_t)n;
+		d->compressed += (uint64_t)n;
+	}
+	return length;
+}
+
+/**
+ * @brief 解压线程：交替写满两个缓冲区，输入结束时交出一个空的缓冲区
+ * @param arg Decompressor
+ */
+static void *decompressMain(void *arg) {
+	Decompressor *d = arg;
+	for (int index = 0;; index ^= 1) {
+		DecompressSlot *slot = &d->slots[index];
+		pthread_mutex_lock(&d->mutex);
+		while (slot->full) {
+			pthread_cond_wait(&d->changed, &d->mutex);
+		}
+		pthread_mutex_unlock(&d->mutex);
+		size_t length = 0;
+		if (!d->failed) {
+			switch (d->format) {
+				case FORMAT_GZIP: length = inflateInto(d, slot->data, DECOMPRESS_BUFFER); break;
+#ifdef HAVE_ZSTD
+				case FORMAT_ZSTD: length = zstdInto(d, slot->data, DECOMPRESS_BUFFER); break;
+#endif
+				default: length = copyInto(d, slot->data, DECOMPRESS_BUFFER); break;
+			}
+		}
+		pthread_mutex_lock(&d->mutex);
+		slot->length = length;
+		slot->full = true;
+		pthread_cond_broadcast(&d->changed);
+		pthread_mutex_unlock(&d->mutex);
+		if (length == 0) {
+			return NULL;
+		}
+	}
+}
+
+/**
+ * @brief 分块分析一段以行尾结束的源码，累加到结果中
+ * @param cache 块缓存
+ * @param tokens Token 缓冲区
+ * @param source 源码，必须以空字符结尾
+ * @param length 源码的字节数
+ * @param progress 分析结果
+ */
+static void lexSegment(ChunkCache *cache, TokenBuffer *tokens, const char *source, size_t length,
+                       LexProgress *progress) {
+	if (length == 0) {
+		return;
+	}
+	lexChunked(cache, source, length, tokens);
+	progress->tokens += tokens->count - 1;
+	for (size_t i = 0; i + 1 < tokens->count; i++) {
+		progress->errors += tokens->tokens[i].type == TOKEN_ERROR;
+	}
+	for (const char *p = source; (p = memchr(p, '\n', length - (size_t)(p - source))) != NULL; p++) {
+		progress->lines++;
+	}
+}
+
+/**
+ * @brief 把一段数据追加到不完整的行之后
+ * @details 行超过 DECOMPRESS_LINE_MAX 时报告为错误，丢弃已经积累的部分并进入跳过状态。
+ */
+static void appendCarry(LexProgress *progress, const char *data, size_t length) {
+	if (progress->carryLength + length > DECOMPRESS_LINE_MAX) {
+		fprintf(stderr, "%s:%" PRIu64 ": 行超过 %zu 字节，已跳过.\n", progress->path, progress->lines + 1,
+		        DECOMPRESS_LINE_MAX);
+		progress->errors++;
+		progress->carryLength = 0;
+		progress->skipping = true;
+		return;
+	}
+	if (progress->carryLength + length + 1 > progress->carryCapacity) {
+		progress->carryCapacity = (progress->carryLength + length + 1) * 2;
+		progress->carry = reallocOrDie(progress->carry, progress->carryCapacity);
+	}
+	memcpy(progress->carry + progress->carryLength, data, length);
+	progress->carryLength += length;
+	progress->carry[progress->carryLength] = '\0';
+}
+
+/**
+ * @brief 分析一个解压后的缓冲区
+ * @details Token 不会跨行，所以只分析到最后一个行尾：上一个缓冲区留下的不完整的行与本缓冲区的第一行拼接后单独分析，
+ * 中间的完整行直接在缓冲区中分析，最后一个行尾之后的部分留给下一个缓冲区。\n
+ * 不完整的行超过 DECOMPRESS_LINE_MAX 时跳到下一个行尾，没有换行的输入也只占用有限的内存。
+ * @param cache 块缓存
+ * @param tokens Token 缓冲区
+ * @param data 缓冲区的数据，data[length] 可以写入
+ * @param length 数据的字节数
+ * @param progress 分析结果
+ */
+static void lexSlot(ChunkCache *cache, TokenBuffer *tokens, char *data, size_t length, LexProgress *progress) {
+	progress->bytes += length;
+	char *end = data + length;
+	if (progress->skipping) {
+		char *newline = memchr(data, '\n', length);
+		if (newline == NULL) {
+			return;
+		}
+		progress->skipping = false;
+		progress->lines++;
+		data = newline + 1;
+		length = (size_t)(end - data);
+		if (length == 0) {
+			return;
+		}
+	}
+	char *first = memchr(data, '\n', length);
+	if (first == NULL) {
+		appendCarry(progress, data, length);
+		return;
+	}
+	appendCarry(progress, data, (size_t)(first - data) + 1);
+	if (progress->skipping) {
+		// 第一行连同之前积累的部分过长，已经报告，这一行到此结束
+		progress->skipping = false;
+		progress->lines++;
+	} else {
+		lexSegment(cache, tokens, progress->carry, progress->carryLength, progress);
+	}
+	progress->carryLength = 0;
+	char *last = data + length - 1;
+	while (*last != '\n') {
+		last--;
+	}
+	size_t restLength = length - (size_t)(last + 1 - data);
+	appendCarry(progress, last + 1, restLength);
+	*(last + 1) = '\0';
+	lexSegment(cache, tokens, first + 1, (size_t)(last - first), progress);
+}
+
+/**
+ * @brief 按魔数识别压缩格式
+ */
+static CompressionFormat detectFormat(const unsigned char *data, size_t length) {
+	if (length >= 2 && data[0] == 0x1f && data[1] == 0x8b) {
+		return FORMAT_GZIP;
+	}
+	if (length >= 4 && data[0] == 0x28 && data[1] == 0xb5 && data[2] == 0x2f && data[3] == 0xfd) {
+		return FORMAT_ZSTD;
+	}
+	return FORMAT_PLAIN;
+}
+
+/**
+ * @brief 流式解压并分析一个文件
+ * @param path 文件路径，"-" 表示标准输入
+ * @param cache 块缓存
+ * @param tokens Token 缓冲区
+ * @return 成功返回 true，否则返回 false
+ */
+static bool lexCompressedFile(const char *path, ChunkCache *cache, TokenBuffer *tokens) {
+	static const char *formatNames[] = {"plain", "gzip", "zstd"};
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	Decompressor d;
+	memset(&d, 0, sizeof(d));
+	d.fd = strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY | O_CLOEXEC);
+	if (d.fd < 0) {
+		fprintf(stderr, "无法打开文件 \"%s\".\n", path);
+		return false;
+	}
+	d.input = reallocOrDie(NULL, DECOMPRESS_INPUT);
+	readInput(&d);
+	d.format = detectFormat(d.input, d.inputLength);
+	bool ok = true;
+	if (d.format == FORMAT_GZIP) {
+		// 15 + 32：自动识别 gzip 和 zlib 头
+		ok = inflateInit2(&d.zlib, 15 + 32) == Z_OK;
+		d.zlib.next_in = d.input;
+		d.zlib.avail_in = (uInt)d.inputLength;
+	} else if (d.format == FORMAT_ZSTD) {
+#ifdef HAVE_ZSTD
+		d.zstd = ZSTD_createDStream();
+		ok = d.zstd != NULL && !ZSTD_isError(ZSTD_initDStream(d.zstd));
+#else
+		fprintf(stderr, "\"%s\" 是 zstd 格式，但编译时没有启用 zstd 支持.\n", path);
+		ok = false;
+#endif
+	}
+	pthread_t thread;
+	if (ok) {
+		d.slots[0].data = reallocOrDie(NULL, DECOMPRESS_BUFFER + 1);
+		d.slots[1].data = reallocOrDie(NULL, DECOMPRESS_BUFFER + 1);
+		pthread_mutex_init(&d.mutex, NULL);
+		pthread_cond_init(&d.changed, NULL);
+		ok = pthread_create(&thread, NULL, decompressMain, &d) == 0;
+	}
+	LexProgress progress;
+	memset(&progress, 0, sizeof(progress));
+	progress.path = path;
+	if (ok) {
+		for (int index = 0;; index ^= 1) {
+			DecompressSlot *slot = &d.slots[index];
+			pthread_mutex_lock(&d.mutex);
+			while (!slot->full) {
+				pthread_cond_wait(&d.changed, &d.mutex);
+			}
+			pthread_mutex_unlock(&d.mutex);
+			if (slot->length == 0) {
+				break;
+			}
+			lexSlot(cache, tokens, slot->data, slot->length, &progress);
+			pthread_mutex_lock(&d.mutex);
+			slot->full = false;
+			pthread_cond_broadcast(&d.changed);
+			pthread_mutex_unlock(&d.mutex);
+		}
+		pthread_join(thread, NULL);
+		// 没有以换行结尾的最后一行
+		lexSegment(cache, tokens, progress.carry, progress.carryLength, &progress);
+		progress.lines += progress.carryLength > 0 || progress.skipping;
+		pthread_mutex_destroy(&d.mutex);
+		pthread_cond_destroy(&d.changed);
+		ok = !d.failed;
+		if (!ok) {
+			fprintf(stderr, "\"%s\" 读取失败或压缩数据已损坏.\n", path);
+		}
+	}
+	if (d.format == FORMAT_GZIP) {
+		inflateEnd(&d.zlib);
+	}
+#ifdef HAVE_ZSTD
+	ZSTD_freeDStream(d.zstd);
+#endif
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double elapsed = (double)(end.tv_sec - start.tv_sec) * 1e3 + (double)(end.tv_nsec - start.tv_nsec) / 1e6;
+	if (ok) {
+		printf("%s: %s，%" PRIu64 " -> %" PRIu64 " 字节，%" PRIu64 " 行，%" PRIu64 " 个 Token，%" PRIu64
+		       " 个错误，耗时 %.3f ms\n",
+		       path, formatNames[d.format], d.compressed, progress.bytes, progress.lines, progress.tokens,
+		       progress.errors, elapsed);
+	}
+	free(progress.carry);
+	free(d.slots[0].data);
+	free(d.slots[1].data);
+	free(d.input);
+	if (d.fd != STDIN_FILENO) {
+		close(d.fd);
+	}
+	return ok;
+}
+
+int lexCompressed(int count, const char *paths[]) {
+	ChunkCache cache;
+	initChunkCache(&cache, DECOMPRESS_CACHE_BUDGET);
+	TokenBuffer tokens;
+	initTokenBuffer(&tokens);
+	bool ok = true;
+	for (int i = 0; i < count; i++) {
+		ok = lexCompressedFile(paths[i], &cache, &tokens) && ok;
+	}
+	freeTokenBuffer(&tokens);
+	freeChunkCache(&cache);
+	return ok ? 0 : 1;
+}
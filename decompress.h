@@ -0,0 +1,14 @@
+#pragma once
+
+/**
+ * @brief 流式解压并分块分析压缩的源文件
+ * @details 按文件开头的魔数识别 gzip、zstd 和未压缩的输入，zstd 需要在编译时定义 HAVE_ZSTD。\n
+ * 一个线程解压到两个交替使用的缓冲区，当前线程同时对另一个缓冲区做分块词法分析，
+ * 每个缓冲区只分析到最后一个行尾，剩余的不完整的行留到下一个缓冲区，不会保存整个解压后的文件。
+ * 超过 4 MiB 的行记为错误并跳到下一个行尾。\n
+ * 每个文件输出一行，包括格式、压缩和解压后的字节数、行数、Token 数量、错误数量和耗时。
+ * @param count 路径数量
+ * @param paths 路径数组，"-" 表示标准输入
+ * @return 全部文件都成功解压时返回 0，否则返回 1
+ */
+int lexCompressed(int count, const char *paths[]);
@@ -0,0 +1,266 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "batch.h"
+#include "diff.h"
+#include "kernels.h"
+
+/**
+ * @brief 参与比较的 Token
+ */
+typedef struct {
+	uint64_t hash;    ///< 由类型和字符序列决定的哈希值，比较时只看这个值
+	const char *text; ///< 在源码中的字符序列，错误 Token 也指向源码而不是错误信息
+	uint32_t length;  ///< 字符序列的长度
+	uint32_t line;    ///< 所在的行
+} DiffToken;
+
+/**
+ * @brief 一个文件的 Token 序列
+ */
+typedef struct {
+	DiffToken *tokens; ///< Token 数组，不包括 TOKEN_EOF
+	size_t count;      ///< Token 数量
+	bool *changed;     ///< 每个 Token 是否被删除（旧文件）或插入（新文件）
+} DiffSide;
+
+/**
+ * @brief 差分算法的工作状态
+ */
+typedef struct {
+	const DiffToken *a; ///< 旧文件的 Token
+	const DiffToken *b; ///< 新文件的 Token
+	bool *deleted;      ///< 旧文件中被删除的 Token
+	bool *inserted;     ///< 新文件中被插入的 Token
+	long *forward;      ///< 正向搜索在每条对角线上到达的最远位置
+	long *backward;     ///< 反向搜索在每条对角线上到达的最远位置
+	long offset;        ///< 对角线编号到数组下标的偏移
+} DiffContext;
+
+/**
+ * @brief 申请内存，失败时打印错误信息并退出程序
+ */
+static void *allocateOrDie(size_t size) {
+	void *result = calloc(size > 0 ? size : 1, 1);
+	if (result == NULL) {
+		fprintf(stderr, "内存不足，无法比较文件.\n");
+		exit(1);
+	}
+	return result;
+}
+
+/**
+ * @brief 扫描源码并计算每个 Token 的哈希值
+ * @details 借助 Trivia 表定位每个 Token 在源码中的位置，使错误 Token 也能按其源码参与比较
+ * @param source 源码
+ * @param length 源码的字节数
+ * @param buffer 复用的 Token 缓冲区
+ * @param side 输出的 Token 序列
+ */
+static void hashTokens(const char *source, size_t length, TokenBuffer *buffer, DiffSide *side) {
+	scanAll(source, length, SCAN_LINES | SCAN_TRIVIA, buffer);
+	const TriviaTable *trivia = scannerTrivia();
+	side->tokens = allocateOrDie(buffer->count * sizeof(DiffToken));
+	side->changed = allocateOrDie(buffer->count * sizeof(bool));
+	side->count = 0;
+	const char *cursor = source;
+	for (size_t i = 0; i < buffer->count && i < trivia->tokenCount; i++) {
+		size_t end = i + 1 < trivia->tokenCount ? trivia->firstRun[i + 1] : trivia->runCount;
+		size_t skipped = 0;
+		for (size_t r = trivia->firstRun[i]; r < end; r++) {
+			if (TRIVIA_KIND(trivia->runs[r]) == TRIVIA_SKIPPED) {
+				skipped += TRIVIA_LENGTH(trivia->runs[r]);
+			} else {
+				cursor += TRIVIA_LENGTH(trivia->runs[r]);
+			}
+		}
+		const Token *token = &buffer->tokens[i];
+		if (token->type == TOKEN_EOF) {
+			break;
+		}
+		DiffToken *out = &side->tokens[side->count++];
+		out->text = cursor;
+		out->length = (uint32_t)(token->type == TOKEN_ERROR ? skipped : (size_t)token->length);
+		out->line = (uint32_t)token->line;
+		out->hash = hashBytes(out->text, out->length) * 31 + (uint64_t)token->type;
+		cursor += out->length;
+	}
+}
+
+/**
+ * @brief 在两段 Token 序列之间寻找中间蛇形
+ * @details Myers 算法的线性空间版本：从两端同时搜索，两条路径在同一条对角线上相遇时，
+ * 把相遇处的一段对角线作为分割点，两侧分别递归求解
+ * @param context 工作状态
+ * @param a0 旧序列的起点
+ * @param a1 旧序列的终点（不包含）
+ * @param b0 新序列的起点
+ * @param b1 新序列的终点（不包含）
+ * @param split 输出的分割点：分割前的旧、新位置和分割后的旧、新位置
+ */
+static void middleSnake(DiffContext *context, long a0, long a1, long b0, long b1, long split[4]) {
+	const DiffToken *a = context->a, *b = context->b;
+	long n = a1 - a0, m = b1 - b0, delta = n - m;
+	long limit = (n + m + 1) / 2;
+	bool odd = (delta & 1) != 0;
+	long *forward = context->forward + context->offset, *backward = context->backward + context->offset;
+	forward[1] = 0;
+	backward[1] = 0;
+	for (long d = 0; d <= limit; d++) {
+		for (long k = -d; k <= d; k += 2) {
+			long x = (k == -d || (k != d && forward[k - 1] < forward[k + 1])) ? forward[k + 1] : forward[k - 1] + 1;
+			long y = x - k, startX = x, startY = y;
+			while (x < n && y < m && a[a0 + x].hash == b[b0 + y].hash) {
+				x++;
+				y++;
+			}
+			forward[k] = x;
+			long reverse = delta - k;
+			if (odd && reverse >= -(d - 1) && reverse <= d - 1 && x + backward[reverse] >= n) {
+				split[0] = a0 + startX;
+				split[1] = b0 + startY;
+				split[2] = a0 + x;
+				split[3] = b0 + y;
+				return;
+			}
+		}
+		for (long k = -d; k <= d; k += 2) {
+			long x = (k == -d || (k != d && backward[k - 1] < backward[k + 1])) ? backward[k + 1] : backward[k - 1] + 1;
+			long y = x - k, startX = x, startY = y;
+			while (x < n && y < m && a[a1 - 1 - x].hash == b[b1 - 1 - y].hash) {
+				x++;
+				y++;
+			}
+			backward[k] = x;
+			long reverse = delta - k;
+			if (!odd && reverse >= -d && reverse <= d && x + forward[reverse] >= n) {
+				split[0] = a1 - x;
+				split[1] = b1 - y;
+				split[2] = a1 - startX;
+				split[3] = b1 - startY;
+				return;
+			}
+		}
+	}
+	// 路径总能在 limit 步之内相遇，这里只是为了让编译器确认 split 总被赋值
+	split[0] = split[2] = a0;
+	split[1] = split[3] = b0;
+}
+
+/**
+ * @brief 递归比较两段 Token 序列，标记被删除和插入的 Token
+ * @param context 工作状态
+ * @param a0 旧序列的起点
+ * @param a1 旧序列的终点（不包含）
+ * @param b0 新序列的起点
+ * @param b1 新序列的终点（不包含）
+ */
+static void diffRange(DiffContext *context, long a0, long a1, long b0, long b1) {
+	const DiffToken *a = context->a, *b = context->b;
+	// 先去掉相同的前缀和后缀，大多数修改只涉及很小的范围
+	while (a0 < a1 && b0 < b1 && a[a0].hash == b[b0].hash) {
+		a0++;
+		b0++;
+	}
+	while (a0 < a1 && b0 < b1 && a[a1 - 1].hash == b[b1 - 1].hash) {
+		a1--;
+		b1--;
+	}
+	if (a0 == a1 || b0 == b1) {
+		for (long i = a0; i < a1; i++) {
+			context->deleted[i] = true;
+		}
+		for (long j = b0; j < b1; j++) {
+			context->inserted[j] = true;
+		}
+		return;
+	}
+	long split[4];
+	middleSnake(context, a0, a1, b0, b1, split);
+	diffRange(context, a0, split[0], b0, split[1]);
+	diffRange(context, split[2], a1, split[3], b1);
+}
+
+/**
+ * @brief 按源码行输出一组被删除或插入的 Token
+ * @param tokens Token 数组
+ * @param begin 第一个 Token
+ * @param end 最后一个 Token 之后
+ * @param mark 行首的标记，- 或 +
+ * @param out 输出目标
+ */
+static void printTokens(const DiffToken *tokens, size_t begin, size_t end, char mark, FILE *out) {
+	for (size_t i = begin; i < end; i++) {
+		if (i == begin || tokens[i].line != tokens[i - 1].line) {
+			if (i != begin) {
+				fputc('\n', out);
+			}
+			fprintf(out, "%c%5u | ", mark, tokens[i].line);
+		} else {
+			fputc(' ', out);
+		}
+		fwrite(tokens[i].text, 1, tokens[i].length, out);
+	}
+	if (end > begin) {
+		fputc('\n', out);
+	}
+}
+
+/**
+ * @brief 取得差异块的起始行号，没有 Token 时取前一个 Token 所在的行
+ */
+static uint32_t hunkLine(const DiffSide *side, size_t begin) {
+	if (begin < side->count) {
+		return side->tokens[begin].line;
+	}
+	return side->count > 0 ? side->tokens[side->count - 1].line : 1;
+}
+
+size_t diffSources(const char *pathA, const char *sourceA, size_t lengthA, const char *pathB, const char *sourceB,
+                   size_t lengthB, FILE *out) {
+	TokenBuffer buffer;
+	initTokenBuffer(&buffer);
+	DiffSide oldSide, newSide;
+	hashTokens(sourceA, lengthA, &buffer, &oldSide);
+	hashTokens(sourceB, lengthB, &buffer, &newSide);
+	freeTokenBuffer(&buffer);
+
+	long limit = (long)(oldSide.count + newSide.count) / 2 + 2;
+	DiffContext context = {oldSide.tokens, newSide.tokens, oldSide.changed, newSide.changed,
+	                       allocateOrDie((size_t)(2 * limit + 1) * sizeof(long)),
+	                       allocateOrDie((size_t)(2 * limit + 1) * sizeof(long)), limit};
+	diffRange(&context, 0, (long)oldSide.count, 0, (long)newSide.count);
+	free(context.forward);
+	free(context.backward);
+
+	size_t hunks = 0;
+	size_t i = 0, j = 0;
+	while (i < oldSide.count || j < newSide.count) {
+		if (i < oldSide.count && j < newSide.count && !oldSide.changed[i] && !newSide.changed[j]) {
+			i++;
+			j++;
+			continue;
+		}
+		size_t oldBegin = i, newBegin = j;
+		while (i < oldSide.count && oldSide.changed[i]) {
+			i++;
+		}
+		while (j < newSide.count && newSide.changed[j]) {
+			j++;
+		}
+		if (hunks++ == 0) {
+			fprintf(out, "--- %s\n+++ %s\n", pathA, pathB);
+		}
+		fprintf(out, "@@ -%u,%zu +%u,%zu @@\n", hunkLine(&oldSide, oldBegin), i - oldBegin, hunkLine(&newSide, newBegin),
+		        j - newBegin);
+		printTokens(oldSide.tokens, oldBegin, i, '-', out);
+		printTokens(newSide.tokens, newBegin, j, '+', out);
+	}
+	free(oldSide.tokens);
+	free(oldSide.changed);
+	free(newSide.tokens);
+	free(newSide.changed);
+	return hunks;
+}
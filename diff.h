@@ -0,0 +1,22 @@
+#pragma once
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * @brief 比较两段源码的 Token 序列
+ * @details 两段源码各扫描一次，同时为每个 Token 计算由类型和字符序列决定的哈希值，
+ * 之后只在两个整数数组上运行线性空间的 Myers 差分算法，因此空白、换行和注释的变化不会产生差异。\n
+ * 每处差异输出为一个块，块头为 "@@ -行号,Token 数 +行号,Token 数 @@"，
+ * 之后按源码行输出被删除（-）和插入（+）的 Token，Token 之间以一个空格分隔。
+ * @param pathA 旧文件的路径，用于输出
+ * @param sourceA 旧文件的内容，必须以空字符结尾
+ * @param lengthA 旧文件的字节数
+ * @param pathB 新文件的路径，用于输出
+ * @param sourceB 新文件的内容，必须以空字符结尾
+ * @param lengthB 新文件的字节数
+ * @param out 输出目标
+ * @return 差异块的数量，两者的 Token 序列相同时为 0
+ * @note 会使用当前线程的词法分析器，调用后之前的扫描状态失效
+ */
+size_t diffSources(const char *pathA, const char *sourceA, size_t lengthA, const char *pathB, const char *sourceB,
+                   size_t lengthB, FILE *out);
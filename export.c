@@ -0,0 +1,368 @@
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "export.h"
+#include "files.h"
+#include "kernels.h"
+#include "parallel.h"
+#include "scanner.h"
+#include "strtab.h"
+#include "tools.h"
+
+/**
+ * @brief 每批扫描的 Token 数量
+ */
+#define EXPORT_BATCH 1024
+
+/**
+ * @brief 固定编号的数量，即 TokenType 的数量
+ */
+#define TYPE_IDS ((uint32_t)TOKEN_EOF + 1)
+
+/**
+ * @brief 文件内编号的标记位，带有此标记的编号是文件字符串表中的编号，否则是 TokenType
+ */
+#define LOCAL_NAME 0x80000000u
+
+/**
+ * @brief .npy 文件头的长度，按 NumPy 的建议对齐到 64 字节
+ */
+#define NPY_HEADER 128
+
+/**
+ * @brief 一个文件的扫描结果
+ */
+typedef struct {
+	StringTable names; ///< 文件中出现的标识符和字面量
+	uint64_t *counts;  ///< 每个字符串的出现次数，下标为文件内的编号
+	uint32_t *ids;     ///< Token 序列，TokenType 或带有 LOCAL_NAME 标记的文件内编号
+	size_t count;      ///< Token 数量，包括结尾的 TOKEN_EOF
+	size_t capacity;   ///< ids 的容量
+	uint32_t *remap;   ///< 文件内编号到全局编号的映射，合并后填写
+} ExportFile;
+
+/**
+ * @brief 并行导出时的共享状态
+ */
+typedef struct {
+	const FileList *files; ///< 文件列表
+	ExportFile *results;   ///< 每个文件的扫描结果
+	const uint32_t *final; ///< 全局编号到输出编号的映射
+	uint64_t *offsets;     ///< 每个文件的第一个 Token 在输出数组中的位置
+	int fd;                ///< 输出的 tokens.npy 文件
+	size_t width;          ///< 输出编号的字节数，2 或 4
+	bool failed;           ///< 是否有写入失败
+} ExportJob;
+
+/**
+ * @brief 申请内存，失败时打印错误信息并退出程序
+ */
+static void *reallocOrDie(void *memory, size_t size) {
+	void *result = realloc(memory, size);
+	if (result == NULL && size > 0) {
+		fprintf(stderr, "内存不足，无法导出 Token.\n");
+		exit(1);
+	}
+	return result;
+}
+
+/**
+ * @brief 根据字符序列的第一个字符判断字面量的类型，用于词表外的标识符和字面量
+ */
+static uint32_t nameType(const char *text) {
+	switch (text[0]) {
+		case '"': return TOKEN_STRING;
+		case '\'': return TOKEN_CHARACTER;
+		default: return (text[0] >= '0' && text[0] <= '9') || text[0] == '.' ? TOKEN_NUMBER : TOKEN_IDENTIFIER;
+	}
+}
+
+/**
+ * @brief 扫描一个文件，记录 Token 序列并统计标识符和字面量的出现次数
+ * @param index 文件编号
+ * @param worker 工作线程编号
+ * @param context ExportJob
+ */
+static void scanTask(size_t index, int worker, void *context) {
+	(void)worker;
+	ExportJob *job = context;
+	ExportFile *result = &job->results[index];
+	size_t length;
+	char *source = tryReadFile(job->files->paths[index], &length);
+	// 无法读取的文件与二进制文件一样只输出 TOKEN_EOF，保持文件列表与 offsets 一一对应
+	bool skipped = source == NULL || looksBinary(source, length);
+	Token tokens[EXPORT_BATCH];
+	initScannerWithFeatures(skipped ? "" : source, SCAN_KEYWORDS);
+	uint32_t countCapacity = 0;
+	for (bool done = false; !done;) {
+		size_t count = scanTokens(tokens, EXPORT_BATCH);
+		if (result->count + count > result->capacity) {
+			result->capacity = result->capacity < 4096 ? 4096 : result->capacity * 2;
+			while (result->capacity < result->count + count) {
+				result->capacity *= 2;
+			}
+			result->ids = reallocOrDie(result->ids, result->capacity * sizeof(uint32_t));
+		}
+		for (size_t i = 0; i < count; i++) {
+			const Token *token = &tokens[i];
+			uint32_t id = (uint32_t)token->type;
+			if (token->type == TOKEN_IDENTIFIER || token->type == TOKEN_NUMBER || token->type == TOKEN_STRING ||
+			    token->type == TOKEN_CHARACTER) {
+				uint32_t known = result->names.count;
+				id = internString(&result->names, token->start, (size_t)token->length);
+				if (result->names.count > known) {
+					if (id == countCapacity) {
+						countCapacity = countCapacity < 256 ? 256 : countCapacity * 2;
+						result->counts = reallocOrDie(result->counts, countCapacity * sizeof(uint64_t));
+					}
+					result->counts[id] = 0;
+				}
+				result->counts[id]++;
+				id |= LOCAL_NAME;
+			}
+			result->ids[result->count++] = id;
+			done = token->type == TOKEN_EOF;
+		}
+	}
+	if (source != NULL) {
+		releaseFile(source, length);
+	}
+}
+
+/**
+ * @brief 把一个文件的 Token 序列转换为输出编号，写入 tokens.npy 中的对应位置
+ * @param index 文件编号
+ * @param worker 工作线程编号
+ * @param context ExportJob
+ */
+static void writeTask(size_t index, int worker, void *context) {
+	(void)worker;
+	ExportJob *job = context;
+	ExportFile *result = &job->results[index];
+	void *data = reallocOrDie(NULL, result->count * job->width + 1);
+	for (size_t i = 0; i < result->count; i++) {
+		uint32_t id = result->ids[i];
+		if (id & LOCAL_NAME) {
+			id = job->final[result->remap[id & ~LOCAL_NAME]];
+		}
+		if (job->width == 2) {
+			((uint16_t *)data)[i] = (uint16_t)id;
+		} else {
+			((uint32_t *)data)[i] = id;
+		}
+	}
+	size_t bytes = result->count * job->width;
+	off_t position = (off_t)(NPY_HEADER + job->offsets[index] * job->width);
+	for (size_t written = 0; written < bytes;) {
+		ssize_t n = pwrite(job->fd, (char *)data + written, bytes - written, position + (off_t)written);
+		if (n <= 0) {
+			job->failed = true;
+			break;
+		}
+		written += (size_t)n;
+	}
+	free(data);
+	free(result->ids);
+	free(result->remap);
+}
+
+/**
+ * @brief 生成 .npy 文件头
+ * @details 格式版本 1.0：魔数、版本号、两字节的头部长度，之后是描述数组的 Python 字典字面量，用空格补齐并以换行结尾
+ * @param header 输出缓冲区，长度为 NPY_HEADER
+ * @param descr 元素类型，如 "<u2"
+ * @param count 元素数量
+ */
+static void npyHeader(char header[NPY_HEADER], const char *descr, uint64_t count) {
+	memset(header, ' ', NPY_HEADER);
+	memcpy(header, "\x93NUMPY\x01\x00", 8);
+	header[8] = (char)((NPY_HEADER - 10) & 0xff);
+	header[9] = (char)((NPY_HEADER - 10) >> 8);
+	int n = snprintf(header + 10, NPY_HEADER - 10, "{'descr': '%s', 'fortran_order': False, 'shape': (%llu,), }",
+	                 descr, (unsigned long long)count);
+	header[10 + n] = ' '; // 覆盖 snprintf 写入的空字符
+	header[NPY_HEADER - 1] = '\n';
+}
+
+/**
+ * @brief 拼接输出文件的路径
+ */
+static char *outputPath(const char *prefix, const char *suffix) {
+	size_t length = strlen(prefix) + strlen(suffix) + 1;
+	char *path = reallocOrDie(NULL, length);
+	snprintf(path, length, "%s%s", prefix, suffix);
+	return path;
+}
+
+/**
+ * @brief 排序时使用的全局字符串表和出现次数
+ */
+static const StringTable *sortNames;
+static const uint64_t *sortCounts;
+
+/**
+ * @brief 按出现次数从高到低比较两个全局编号，次数相同时按字符序列排序，使词表与线程的执行顺序无关
+ */
+static int compareFrequency(const void *a, const void *b) {
+	uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+	if (sortCounts[x] != sortCounts[y]) {
+		return sortCounts[x] > sortCounts[y] ? -1 : 1;
+	}
+	size_t lengthX, lengthY;
+	const char *textX = stringAt(sortNames, x, &lengthX);
+	const char *textY = stringAt(sortNames, y, &lengthY);
+	int order = memcmp(textX, textY, lengthX < lengthY ? lengthX : lengthY);
+	return order != 0 ? order : (lengthX > lengthY) - (lengthX < lengthY);
+}
+
+int exportTokens(const ExportOptions *options, int count, const char *paths[]) {
+	FileList files;
+	collectFiles(&files, count, paths);
+	size_t fileCount = (size_t)files.count;
+	ExportFile *results = reallocOrDie(NULL, (fileCount + 1) * sizeof(ExportFile));
+	memset(results, 0, (fileCount + 1) * sizeof(ExportFile));
+	for (size_t i = 0; i < fileCount; i++) {
+		initStringTable(&results[i].names);
+	}
+	ExportJob job = {&files, results, NULL, NULL, -1, 0, false};
+	parallelFor(fileCount, scanTask, &job);
+
+	// 合并各文件的字符串表，累加出现次数
+	StringTable names;
+	initStringTable(&names);
+	uint64_t *counts = NULL;
+	size_t countCapacity = 0;
+	for (size_t i = 0; i < fileCount; i++) {
+		ExportFile *result = &results[i];
+		result->remap = reallocOrDie(NULL, ((size_t)result->names.count + 1) * sizeof(uint32_t));
+		for (uint32_t id = 0; id < result->names.count; id++) {
+			size_t length;
+			const char *text = stringAt(&result->names, id, &length);
+			uint32_t known = names.count;
+			uint32_t global = internString(&names, text, length);
+			if (names.count > known) {
+				if (global == countCapacity) {
+					countCapacity = countCapacity < 1024 ? 1024 : countCapacity * 2;
+					counts = reallocOrDie(counts, countCapacity * sizeof(uint64_t));
+				}
+				counts[global] = 0;
+			}
+			counts[global] += result->counts[id];
+			result->remap[id] = global;
+		}
+	}
+
+	// 按出现次数选出词表，其余的字符串使用其类型的编号
+	uint32_t *order = reallocOrDie(NULL, ((size_t)names.count + 1) * sizeof(uint32_t));
+	uint32_t *final = reallocOrDie(NULL, ((size_t)names.count + 1) * sizeof(uint32_t));
+	for (uint32_t id = 0; id < names.count; id++) {
+		order[id] = id;
+	}
+	sortNames = &names;
+	sortCounts = counts;
+	qsort(order, names.count, sizeof(uint32_t), compareFrequency);
+	uint32_t vocabulary = 0;
+	for (uint32_t rank = 0; rank < names.count; rank++) {
+		uint32_t id = order[rank];
+		if (vocabulary < options->vocabularyMax && counts[id] >= options->minFrequency) {
+			final[id] = TYPE_IDS + vocabulary++;
+		} else {
+			size_t length;
+			final[id] = nameType(stringAt(&names, id, &length));
+		}
+	}
+
+	// 计算每个文件在输出数组中的位置，再并行写入
+	uint64_t *offsets = reallocOrDie(NULL, (fileCount + 1) * sizeof(uint64_t));
+	offsets[0] = 0;
+	for (size_t i = 0; i < fileCount; i++) {
+		offsets[i + 1] = offsets[i] + results[i].count;
+		freeStringTable(&results[i].names);
+		free(results[i].counts);
+	}
+	job.final = final;
+	job.offsets = offsets;
+	job.width = TYPE_IDS + vocabulary <= 65536 ? 2 : 4;
+	char header[NPY_HEADER];
+	char *tokensPath = outputPath(options->prefix, ".tokens.npy");
+	job.fd = open(tokensPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	bool ok = job.fd >= 0;
+	if (ok) {
+		npyHeader(header, job.width == 2 ? "<u2" : "<u4", offsets[fileCount]);
+		ok = pwrite(job.fd, header, NPY_HEADER, 0) == NPY_HEADER;
+	}
+	if (ok) {
+		parallelFor(fileCount, writeTask, &job);
+		ok = !job.failed;
+	} else {
+		for (size_t i = 0; i < fileCount; i++) {
+			free(results[i].ids);
+			free(results[i].remap);
+		}
+	}
+	if (job.fd >= 0) {
+		ok = close(job.fd) == 0 && ok;
+	}
+
+	char *offsetsPath = outputPath(options->prefix, ".offsets.npy");
+	FILE *file = fopen(offsetsPath, "wb");
+	if (file != NULL) {
+		npyHeader(header, "<u8", fileCount + 1);
+		fwrite(header, 1, NPY_HEADER, file);
+		fwrite(offsets, sizeof(uint64_t), fileCount + 1, file);
+		ok = fclose(file) == 0 && ok;
+	} else {
+		ok = false;
+	}
+
+	char *vocabPath = outputPath(options->prefix, ".vocab.txt");
+	file = fopen(vocabPath, "w");
+	if (file != NULL) {
+		for (uint32_t type = 0; type < TYPE_IDS; type++) {
+			Token token = {(TokenType)type, NULL, 0, 0, 0};
+			fprintf(file, "%s\n", convert_to_str(token));
+		}
+		for (uint32_t rank = 0; rank < vocabulary; rank++) {
+			size_t length;
+			const char *text = stringAt(&names, order[rank], &length);
+			fprintf(file, "%.*s\n", (int)length, text);
+		}
+		ok = fclose(file) == 0 && ok;
+	} else {
+		ok = false;
+	}
+
+	char *filesPath = outputPath(options->prefix, ".files.txt");
+	file = fopen(filesPath, "w");
+	if (file != NULL) {
+		for (size_t i = 0; i < fileCount; i++) {
+			fprintf(file, "%s\n", files.paths[i]);
+		}
+		ok = fclose(file) == 0 && ok;
+	} else {
+		ok = false;
+	}
+
+	if (ok) {
+		fprintf(stderr, "导出 %zu 个文件，共 %llu 个 Token，词表 %u 个 (另有 %u 个类型编号)，编号宽度 %zu 字节.\n", fileCount,
+		        (unsigned long long)offsets[fileCount], vocabulary, TYPE_IDS, job.width);
+	} else {
+		fprintf(stderr, "无法写入导出文件 \"%s.*\".\n", options->prefix);
+	}
+	free(tokensPath);
+	free(offsetsPath);
+	free(vocabPath);
+	free(filesPath);
+	free(offsets);
+	free(order);
+	free(final);
+	free(counts);
+	freeStringTable(&names);
+	free(results);
+	freeFileList(&files);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <stdint.h>
+
+/**
+ * @brief 导出 Token 编号的参数
+ */
+typedef struct {
+	const char *prefix;     ///< 输出文件的前缀
+	uint32_t vocabularyMax; ///< 词表中标识符和字面量的最大数量
+	uint32_t minFrequency;  ///< 进入词表所需的最少出现次数
+} ExportOptions;
+
+/**
+ * @brief 把一组文件的 Token 导出为整数编号数组，供机器学习训练使用
+ * @details 编号 0 到 TOKEN_EOF 固定为各个 TokenType，之后是按出现次数从高到低排列的标识符和字面量，
+ * 不在词表中的标识符和字面量使用其类型的编号。每个文件以一个 TOKEN_EOF 结尾，
+ * 二进制文件和无法读取的文件只有这一个 TOKEN_EOF。\n
+ * 各文件并行扫描并统计频率，合并后确定词表，再并行把每个文件的编号写入输出文件中的对应位置。\n
+ * 输出以下文件：\n
+ * 前缀.tokens.npy：一维的 Token 编号数组，编号总数不超过 65536 时为 uint16，否则为 uint32；\n
+ * 前缀.offsets.npy：一维的 uint64 数组，第 i 个文件的 Token 为 tokens[offsets[i]:offsets[i + 1]]；\n
+ * 前缀.vocab.txt：词表，第 i 行为编号 i 对应的 Token 类型名称或字符序列；\n
+ * 前缀.files.txt：文件列表，第 i 行为第 i 个文件的路径。
+ * @param options 导出参数
+ * @param count 路径数量
+ * @param paths 路径数组，目录会被递归展开
+ * @return 成功返回 0，写入失败返回 1
+ */
+int exportTokens(const ExportOptions *options, int count, const char *paths[]);
@@ -0,0 +1,170 @@
+#include <dirent.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "files.h"
+
+/**
+ * @brief 已经加入列表的文件，按设备号和 inode 编号识别
+ * @details 同一个文件通过不同的参数或路径出现多次时只加入一次，改写文件的模式不会重复改写。
+ */
+typedef struct {
+	dev_t *devices;  ///< 开放寻址的哈希表，保存设备号
+	ino_t *inodes;   ///< 与 devices 对应的 inode 编号，0 表示空槽
+	size_t count;    ///< 已有的文件数量
+	size_t capacity; ///< 槽的数量，总是 2 的幂
+} FileSet;
+
+/**
+ * @brief 把一个路径加入文件列表
+ * @param list 文件列表
+ * @param path 文件路径，会被复制
+ */
+static void addFile(FileList *list, const char *path) {
+	if (list->count == list->capacity) {
+		list->capacity = list->capacity < 64 ? 64 : list->capacity * 2;
+		list->paths = realloc(list->paths, (size_t)list->capacity * sizeof(char *));
+		if (list->paths == NULL) {
+			fprintf(stderr, "内存不足，无法保存文件列表.\n");
+			exit(1);
+		}
+	}
+	list->paths[list->count++] = strdup(path);
+}
+
+/**
+ * @brief 计算文件在哈希表中的起始槽
+ */
+static size_t fileSlot(dev_t device, ino_t inode, size_t capacity) {
+	uint64_t hash = ((uint64_t)inode ^ ((uint64_t)device << 32)) * 0x9e3779b97f4a7c15ull;
+	return (size_t)(hash >> 32) & (capacity - 1);
+}
+
+/**
+ * @brief 记录一个文件
+ * @param set 文件集合
+ * @param st 文件的 stat 结果
+ * @return 文件第一次出现时返回 true，已经记录过时返回 false
+ */
+static bool insertFile(FileSet *set, const struct stat *st) {
+	if ((set->count + 1) * 2 > set->capacity) {
+		FileSet grown = {NULL, NULL, set->count, set->capacity < 256 ? 256 : set->capacity * 2};
+		grown.devices = calloc(grown.capacity, sizeof(dev_t));
+		grown.inodes = calloc(grown.capacity, sizeof(ino_t));
+		if (grown.devices == NULL || grown.inodes == NULL) {
+			fprintf(stderr, "内存不足，无法保存文件列表.\n");
+			exit(1);
+		}
+		for (size_t i = 0; i < set->capacity; i++) {
+			if (set->inodes[i] != 0) {
+				size_t slot = fileSlot(set->devices[i], set->inodes[i], grown.capacity);
+				while (grown.inodes[slot] != 0) {
+					slot = (slot + 1) & (grown.capacity - 1);
+				}
+				grown.devices[slot] = set->devices[i];
+				grown.inodes[slot] = set->inodes[i];
+			}
+		}
+		free(set->devices);
+		free(set->inodes);
+		*set = grown;
+	}
+	size_t slot = fileSlot(st->st_dev, st->st_ino, set->capacity);
+	for (; set->inodes[slot] != 0; slot = (slot + 1) & (set->capacity - 1)) {
+		if (set->devices[slot] == st->st_dev && set->inodes[slot] == st->st_ino) {
+			return false;
+		}
+	}
+	set->devices[slot] = st->st_dev;
+	set->inodes[slot] = st->st_ino;
+	set->count++;
+	return true;
+}
+
+bool isSourceName(const char *name) {
+	size_t length = strlen(name);
+	return length > 2 && name[length - 2] == '.' && (name[length - 1] == 'c' || name[length - 1] == 'h');
+}
+
+/**
+ * @brief 比较两个字符串指针，用于 qsort
+ */
+static int comparePaths(const void *a, const void *b) {
+	return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/**
+ * @brief 递归遍历目录，把其中的源文件加入列表
+ * @param list 文件列表
+ * @param seen 已经加入列表的文件
+ * @param directory 目录路径
+ */
+static void walkDirectory(FileList *list, FileSet *seen, const char *directory) {
+	DIR *dir = opendir(directory);
+	if (dir == NULL) {
+		fprintf(stderr, "无法打开目录 \"%s\".\n", directory);
+		return;
+	}
+	// 先收集目录中的全部条目，排序后再处理，保证结果与文件系统的遍历顺序无关
+	FileList entries = {NULL, 0, 0};
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL) {
+		if (entry->d_name[0] == '.') {
+			continue; // 跳过 . 和 .. 以及隐藏文件
+		}
+		size_t length = strlen(directory) + strlen(entry->d_name) + 2;
+		char *path = malloc(length);
+		snprintf(path, length, "%s/%s", directory, entry->d_name);
+		addFile(&entries, path);
+		free(path);
+	}
+	closedir(dir);
+	if (entries.count > 0) {
+		qsort(entries.paths, (size_t)entries.count, sizeof(char *), comparePaths);
+	}
+	for (int i = 0; i < entries.count; i++) {
+		struct stat st;
+		if (lstat(entries.paths[i], &st) != 0) {
+			continue;
+		}
+		if (S_ISDIR(st.st_mode)) {
+			walkDirectory(list, seen, entries.paths[i]);
+		} else if (S_ISREG(st.st_mode) && isSourceName(entries.paths[i]) && insertFile(seen, &st)) {
+			addFile(list, entries.paths[i]);
+		}
+	}
+	freeFileList(&entries);
+}
+
+void collectFiles(FileList *list, int count, const char *paths[]) {
+	list->paths = NULL;
+	list->count = 0;
+	list->capacity = 0;
+	FileSet seen = {NULL, NULL, 0, 0};
+	for (int i = 0; i < count; i++) {
+		struct stat st;
+		if (stat(paths[i], &st) != 0) {
+			fprintf(stderr, "无法访问 \"%s\".\n", paths[i]);
+		} else if (S_ISDIR(st.st_mode)) {
+			walkDirectory(list, &seen, paths[i]);
+		} else if (insertFile(&seen, &st)) {
+			addFile(list, paths[i]);
+		}
+	}
+	free(seen.devices);
+	free(seen.inodes);
+}
+
+void freeFileList(FileList *list) {
+	for (int i = 0; i < list->count; i++) {
+		free(list->paths[i]);
+	}
+	free(list->paths);
+	list->paths = NULL;
+	list->count = 0;
+	list->capacity = 0;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <stdbool.h>
+
+/**
+ * @brief 文件列表
+ * @details 保存命令行参数展开后的全部源文件路径
+ */
+typedef struct {
+	char **paths; ///< 文件路径数组，每个路径单独分配
+	int count;    ///< 文件数量
+	int capacity; ///< 数组的容量
+} FileList;
+
+/**
+ * @brief 判断文件名是否为 C 源文件或头文件
+ * @param name 文件名或路径
+ * @return 扩展名为 .c 或 .h 时返回 true，否则返回 false
+ */
+bool isSourceName(const char *name);
+
+/**
+ * @brief 展开命令行参数中的路径
+ * @details 普通文件直接加入列表；目录会被递归遍历，其中扩展名为 .c 或 .h 的文件按路径名排序后加入列表。\n
+ * 同一个文件（设备号和 inode 编号相同）只加入一次，以第一次出现的路径为准。无法访问的路径打印错误信息后跳过。
+ * @param list 输出的文件列表，由调用者调用 freeFileList 释放
+ * @param count 路径数量
+ * @param paths 路径数组
+ */
+void collectFiles(FileList *list, int count, const char *paths[]);
+
+/**
+ * @brief 释放文件列表
+ * @param list 文件列表
+ */
+void freeFileList(FileList *list);
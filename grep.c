@@ -0,0 +1,220 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "grep.h"
+
+/**
+ * @brief 每批扫描的 Token 数量
+ */
+#define GREP_BATCH 1024
+
+/**
+ * @brief 自动机状态对应的匹配起点
+ */
+typedef struct {
+	size_t ordinal; ///< 起点 Token 的序号，用于比较先后
+	int line;       ///< 起点 Token 所在的行
+	const char *at; ///< 起点 Token 的字符序列
+} MatchStart;
+
+/**
+ * @brief 判断标识符 Token 的字符序列是否为指定的占位符
+ * @param token 标识符 Token
+ * @param name 占位符名称
+ * @return 相同返回 true，否则返回 false
+ */
+static bool isPlaceholder(const Token *token, const char *name) {
+	return (size_t)token->length == strlen(name) && memcmp(token->start, name, (size_t)token->length) == 0;
+}
+
+bool compilePattern(const char *text, TokenPattern *pattern, const char **error) {
+	pattern->count = 0;
+	pattern->text = strdup(text);
+	initScannerWithFeatures(pattern->text, SCAN_KEYWORDS);
+	for (;;) {
+		Token token = scanToken();
+		if (token.type == TOKEN_EOF) {
+			break;
+		}
+		if (token.type == TOKEN_ERROR) {
+			*error = "模式中存在词法错误";
+			freePattern(pattern);
+			return false;
+		}
+		if (pattern->count == PATTERN_MAX_OPS) {
+			*error = "模式过长";
+			freePattern(pattern);
+			return false;
+		}
+		PatternOp *op = &pattern->ops[pattern->count];
+		op->kind = PATTERN_TYPE;
+		op->type = token.type;
+		op->text = token.start;
+		op->length = token.length;
+		if (token.type == TOKEN_IDENTIFIER) {
+			if (isPlaceholder(&token, "IDENT")) {
+				op->type = TOKEN_IDENTIFIER;
+			} else if (isPlaceholder(&token, "NUMBER")) {
+				op->type = TOKEN_NUMBER;
+			} else if (isPlaceholder(&token, "STRING")) {
+				op->type = TOKEN_STRING;
+			} else if (isPlaceholder(&token, "CHAR")) {
+				op->type = TOKEN_CHARACTER;
+			} else if (isPlaceholder(&token, "ANY")) {
+				op->kind = PATTERN_ANY;
+			} else {
+				op->kind = PATTERN_LEXEME;
+			}
+		} else if (token.type == TOKEN_DOT && pattern->count >= 2 &&
+		           pattern->ops[pattern->count - 1].kind == PATTERN_TYPE &&
+		           pattern->ops[pattern->count - 1].type == TOKEN_DOT &&
+		           pattern->ops[pattern->count - 2].kind == PATTERN_TYPE &&
+		           pattern->ops[pattern->count - 2].type == TOKEN_DOT &&
+		           pattern->ops[pattern->count - 2].text + 2 == token.start) {
+			// 三个紧挨着的点合并为 ... 占位符
+			pattern->count -= 2;
+			pattern->ops[pattern->count].kind = PATTERN_GAP;
+		}
+		pattern->count++;
+	}
+	if (pattern->count == 0) {
+		*error = "模式为空";
+		freePattern(pattern);
+		return false;
+	}
+	return true;
+}
+
+void freePattern(TokenPattern *pattern) {
+	free(pattern->text);
+	pattern->text = NULL;
+	pattern->count = 0;
+}
+
+/**
+ * @brief 判断模式元素能否匹配一个 Token
+ * @param op 模式元素，不能是 PATTERN_GAP
+ * @param token Token
+ * @return 能匹配返回 true，否则返回 false
+ */
+static bool opMatches(const PatternOp *op, const Token *token) {
+	switch (op->kind) {
+		case PATTERN_TYPE: return token->type == op->type;
+		case PATTERN_LEXEME:
+			return token->type == TOKEN_IDENTIFIER && token->length == op->length &&
+					memcmp(token->start, op->text, (size_t)op->length) == 0;
+		case PATTERN_ANY: return true;
+		default: return false;
+	}
+}
+
+/**
+ * @brief 判断 Token 是否为语句边界
+ * @details ... 不会跨越语句边界，避免一个匹配从文件开头一直延伸到很远的地方
+ * @param type Token 的类型
+ * @return 分号和大括号返回 true，否则返回 false
+ */
+static bool isStatementBoundary(TokenType type) {
+	return type == TOKEN_SEMICOLON || type == TOKEN_LEFT_BRACE || type == TOKEN_RIGHT_BRACE;
+}
+
+/**
+ * @brief 激活一个状态，同一状态有多个起点时保留最早的一个
+ * @param set 状态集合
+ * @param starts 每个状态的起点
+ * @param state 要激活的状态
+ * @param start 起点
+ */
+static void activate(uint64_t *set, MatchStart *starts, int state, const MatchStart *start) {
+	uint64_t bit = (uint64_t)1 << state;
+	if (!(*set & bit) || start->ordinal < starts[state].ordinal) {
+		starts[state] = *start;
+	}
+	*set |= bit;
+}
+
+/**
+ * @brief 计算 ... 占位符的空转移闭包
+ * @details ... 可以匹配零个 Token，处于它之前的状态同时也处于它之后的状态
+ * @param pattern 模式
+ * @param set 状态集合
+ * @param starts 每个状态的起点
+ */
+static void closeGaps(const TokenPattern *pattern, uint64_t *set, MatchStart *starts) {
+	for (int i = 0; i < pattern->count; i++) {
+		if (pattern->ops[i].kind == PATTERN_GAP && (*set & ((uint64_t)1 << i))) {
+			activate(set, starts, i + 1, &starts[i]);
+		}
+	}
+}
+
+/**
+ * @brief 输出一个匹配
+ * @param out 输出目标
+ * @param path 文件路径
+ * @param source 源代码
+ * @param length 源代码的字节数
+ * @param start 匹配的起点
+ */
+static void printMatch(FILE *out, const char *path, const char *source, size_t length, const MatchStart *start) {
+	if (start->at < source || start->at >= source + length) {
+		fprintf(out, "%s:%d:\n", path, start->line); // 错误 Token 不指向源码，无法输出所在行
+		return;
+	}
+	const char *lineStart = start->at;
+	while (lineStart > source && lineStart[-1] != '\n') {
+		lineStart--;
+	}
+	const char *lineEnd = memchr(start->at, '\n', (size_t)(source + length - start->at));
+	if (lineEnd == NULL) {
+		lineEnd = source + length;
+	}
+	fprintf(out, "%s:%d:%.*s\n", path, start->line, (int)(lineEnd - lineStart), lineStart);
+}
+
+size_t grepSource(const TokenPattern *pattern, const char *source, size_t length, const char *path, FILE *out) {
+	size_t matches = 0;
+	size_t ordinal = 0;
+	uint64_t active = 0;
+	uint64_t accept = (uint64_t)1 << pattern->count;
+	MatchStart starts[PATTERN_MAX_OPS + 1];     // active 中每个状态的起点
+	MatchStart nextStarts[PATTERN_MAX_OPS + 1]; // next 中每个状态的起点
+	Token tokens[GREP_BATCH];
+	initScannerWithFeatures(source, SCAN_LINES | SCAN_KEYWORDS);
+	for (;;) {
+		size_t count = scanTokens(tokens, GREP_BATCH);
+		for (size_t i = 0; i < count; i++, ordinal++) {
+			const Token *token = &tokens[i];
+			if (token->type == TOKEN_EOF) {
+				return matches;
+			}
+			// 每个 Token 都可能是新匹配的起点
+			MatchStart here = {ordinal, token->line, token->start};
+			activate(&active, starts, 0, &here);
+			closeGaps(pattern, &active, starts);
+			uint64_t next = 0;
+			for (uint64_t rest = active & (accept - 1); rest != 0; rest &= rest - 1) {
+				int state = __builtin_ctzll(rest);
+				const PatternOp *op = &pattern->ops[state];
+				if (op->kind == PATTERN_GAP) {
+					if (!isStatementBoundary(token->type)) {
+						activate(&next, nextStarts, state, &starts[state]); // ... 吞掉当前 Token，停留在原状态
+					}
+				} else if (opMatches(op, token)) {
+					activate(&next, nextStarts, state + 1, &starts[state]);
+				}
+			}
+			closeGaps(pattern, &next, nextStarts);
+			if (next & accept) {
+				printMatch(out, path, source, length, &nextStarts[pattern->count]);
+				matches++;
+				next = 0; // 匹配之间不重叠
+			}
+			for (uint64_t rest = next; rest != 0; rest &= rest - 1) {
+				int state = __builtin_ctzll(rest);
+				starts[state] = nextStarts[state]; // 只复制处于活动状态的起点
+			}
+			active = next;
+		}
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "scanner.h"
+
+/**
+ * @brief 模式最多包含的元素数量
+ * @details 匹配时用一个 64 位整数表示自动机的状态集合，最后一位留给接受状态
+ */
+#define PATTERN_MAX_OPS 63
+
+/**
+ * @brief 模式元素的种类
+ */
+typedef enum {
+	PATTERN_TYPE,   ///< 匹配指定类型的 Token，如关键字、运算符，或 IDENT、NUMBER、STRING、CHAR 占位符
+	PATTERN_LEXEME, ///< 匹配字符序列完全相同的标识符
+	PATTERN_ANY,    ///< ANY 占位符，匹配任意一个 Token
+	PATTERN_GAP,    ///< ... 占位符，匹配任意多个（包括零个）Token，但不跨越分号和大括号
+} PatternOpKind;
+
+/**
+ * @brief 模式元素
+ */
+typedef struct {
+	PatternOpKind kind; ///< 元素的种类
+	TokenType type;     ///< PATTERN_TYPE 时要匹配的 Token 类型
+	const char *text;   ///< PATTERN_LEXEME 时要匹配的字符序列，指向 TokenPattern.text
+	int length;         ///< PATTERN_LEXEME 时字符序列的长度
+} PatternOp;
+
+/**
+ * @brief 编译后的 Token 模式
+ * @details 模式本身用词法分析器分析，每个 Token 对应一个元素，匹配时在 Token 流上模拟非确定有限自动机
+ */
+typedef struct {
+	PatternOp ops[PATTERN_MAX_OPS]; ///< 模式元素
+	int count;                      ///< 模式元素的数量
+	char *text;                     ///< 模式字符串的副本，PATTERN_LEXEME 元素指向其中
+} TokenPattern;
+
+/**
+ * @brief 编译 Token 模式
+ * @details 模式按 C 的 Token 书写，以空白分隔，例如 "IDENT ( ... ) ;" 或 "sizeof ( IDENT * )"。\n
+ * IDENT、NUMBER、STRING、CHAR 匹配对应类型的任意 Token，ANY 匹配任意一个 Token，
+ * ... 匹配同一语句内任意多个 Token（不包含分号和大括号），其余 Token 按类型匹配，标识符还要求字符序列相同。
+ * @param text 模式字符串
+ * @param pattern 输出的模式，由调用者调用 freePattern 释放
+ * @param error 输出参数，编译失败时指向错误信息
+ * @return 编译成功返回 true，否则返回 false
+ * @note 会使用当前线程的词法分析器，调用后之前的扫描状态失效
+ */
+bool compilePattern(const char *text, TokenPattern *pattern, const char **error);
+
+/**
+ * @brief 释放 Token 模式
+ * @param pattern 模式
+ */
+void freePattern(TokenPattern *pattern);
+
+/**
+ * @brief 在源码中查找模式
+ * @details 每个匹配输出一行 "路径:行号:所在行的源码"，匹配之间不重叠
+ * @param pattern 编译后的模式
+ * @param source 源代码，必须以空字符结尾
+ * @param length 源代码的字节数
+ * @param path 输出时使用的文件路径
+ * @param out 输出目标
+ * @return 匹配的数量
+ */
+size_t grepSource(const TokenPattern *pattern, const char *source, size_t length, const char *path, FILE *out);
@@ -0,0 +1,139 @@
+#include "highlight.h"
+#include "kernels.h"
+#include "scanner.h"
+
+/**
+ * @brief 每批扫描的 Token 数量
+ */
+#define HIGHLIGHT_BATCH 1024
+
+/**
+ * @brief 高亮的类别
+ */
+typedef enum {
+	STYLE_NONE,    ///< 不着色，如标识符和运算符
+	STYLE_KEYWORD, ///< 关键字
+	STYLE_NUMBER,  ///< 数字
+	STYLE_STRING,  ///< 字符串和字符
+	STYLE_COMMENT, ///< 注释
+	STYLE_ERROR,   ///< 词法错误
+} Style;
+
+/**
+ * @brief 每个类别的 ANSI 转义序列，下标为 Style
+ */
+static const char *const ansiStyles[] = {"", "\x1b[1;34m", "\x1b[36m", "\x1b[32m", "\x1b[90m", "\x1b[1;31m"};
+
+/**
+ * @brief 每个类别的 HTML 开始标签，下标为 Style
+ */
+static const char *const htmlStyles[] = {
+	"", "<span class=\"kw\">", "<span class=\"num\">", "<span class=\"str\">",
+	"<span class=\"com\">", "<span class=\"err\">",
+};
+
+/**
+ * @brief 确定 Token 的高亮类别
+ * @param type Token 的类型
+ * @return 高亮类别
+ */
+static Style styleOf(TokenType type) {
+	if (type >= TOKEN_SIGNED && type <= TOKEN_TYPEDEF) {
+		return STYLE_KEYWORD;
+	}
+	switch (type) {
+		case TOKEN_NUMBER: return STYLE_NUMBER;
+		case TOKEN_STRING:
+		case TOKEN_CHARACTER: return STYLE_STRING;
+		case TOKEN_ERROR: return STYLE_ERROR;
+		default: return STYLE_NONE;
+	}
+}
+
+/**
+ * @brief 写出一段文本，HTML 格式时转义特殊字符
+ * @details 用 findHtmlSpecial 跳过不需要转义的部分，整段复制到输出
+ * @param out 输出缓冲区
+ * @param format 输出格式
+ * @param text 文本
+ * @param length 文本的字节数
+ */
+static void writeText(Output *out, HighlightFormat format, const char *text, size_t length) {
+	if (format != HIGHLIGHT_HTML) {
+		writeOutput(out, text, length);
+		return;
+	}
+	while (length > 0) {
+		size_t plain = findHtmlSpecial(text, length);
+		writeOutput(out, text, plain);
+		if (plain == length) {
+			return;
+		}
+		switch (text[plain]) {
+			case '<': writeString(out, "&lt;"); break;
+			case '>': writeString(out, "&gt;"); break;
+			case '&': writeString(out, "&amp;"); break;
+			default: writeString(out, "&quot;"); break;
+		}
+		text += plain + 1;
+		length -= plain + 1;
+	}
+}
+
+/**
+ * @brief 以指定类别写出一段文本
+ * @param out 输出缓冲区
+ * @param format 输出格式
+ * @param style 高亮类别
+ * @param text 文本
+ * @param length 文本的字节数
+ */
+static void writeStyled(Output *out, HighlightFormat format, Style style, const char *text, size_t length) {
+	if (style == STYLE_NONE) {
+		writeText(out, format, text, length);
+		return;
+	}
+	writeString(out, format == HIGHLIGHT_HTML ? htmlStyles[style] : ansiStyles[style]);
+	writeText(out, format, text, length);
+	writeString(out, format == HIGHLIGHT_HTML ? "</span>" : "\x1b[0m");
+}
+
+void highlightSource(const char *source, size_t length, HighlightFormat format, Output *out) {
+	if (format == HIGHLIGHT_HTML) {
+		writeString(out, "<pre class=\"c\">");
+	}
+	initScannerWithFeatures(source, SCAN_KEYWORDS | SCAN_TRIVIA);
+	const TriviaTable *trivia = scannerTrivia();
+	const char *cursor = source; // 当前输出到的源码位置
+	size_t index = 0;            // 当前 Token 在 Trivia 表中的下标
+	Token tokens[HIGHLIGHT_BATCH];
+	for (;;) {
+		size_t count = scanTokens(tokens, HIGHLIGHT_BATCH);
+		for (size_t i = 0; i < count; i++, index++) {
+			// 先写出前置 Trivia，空白原样输出，注释和错误按类别着色
+			size_t end = index + 1 < trivia->tokenCount ? trivia->firstRun[index + 1] : trivia->runCount;
+			for (size_t r = trivia->firstRun[index]; r < end; r++) {
+				size_t runLength = TRIVIA_LENGTH(trivia->runs[r]);
+				switch (TRIVIA_KIND(trivia->runs[r])) {
+					case TRIVIA_COMMENT: writeStyled(out, format, STYLE_COMMENT, cursor, runLength); break;
+					case TRIVIA_SKIPPED: writeStyled(out, format, STYLE_ERROR, cursor, runLength); break;
+					default: writeOutput(out, cursor, runLength); break;
+				}
+				cursor += runLength;
+			}
+			const Token *token = &tokens[i];
+			if (token->type == TOKEN_EOF) {
+				// 扫描器在空字符处结束，之后的内容不着色，原样写出
+				writeText(out, format, cursor, (size_t)(source + length - cursor));
+				if (format == HIGHLIGHT_HTML) {
+					writeString(out, "</pre>\n");
+				}
+				return;
+			}
+			if (token->type != TOKEN_ERROR) {
+				writeStyled(out, format, styleOf(token->type), token->start, (size_t)token->length);
+				cursor += token->length;
+			}
+		}
+	}
+}
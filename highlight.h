@@ -0,0 +1,24 @@
+#pragma once
+#include <stddef.h>
+
+#include "output.h"
+
+/**
+ * @brief 语法高亮的输出格式
+ */
+typedef enum {
+	HIGHLIGHT_ANSI, ///< 使用 ANSI 转义序列着色，适合终端
+	HIGHLIGHT_HTML, ///< 输出带 span 标签的 HTML 片段，源码中的特殊字符会被转义
+} HighlightFormat;
+
+/**
+ * @brief 输出语法高亮后的源码
+ * @details 以启用 SCAN_KEYWORDS 和 SCAN_TRIVIA 的方式扫描源码，按 Token 类型着色，
+ * 空白和注释从 Trivia 表中还原，因此输出的文本与源码完全一致。扫描器遇到空字符即结束，
+ * 从该空字符到 length 的内容不着色，原样写出。
+ * @param source 源代码，必须以空字符结尾
+ * @param length 源代码的字节数
+ * @param format 输出格式
+ * @param out 输出缓冲区
+ */
+void highlightSource(const char *source, size_t length, HighlightFormat format, Output *out);
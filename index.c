@@ -0,0 +1,740 @@
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "files.h"
+#include "index.h"
+#include "kernels.h"
+#include "parallel.h"
+#include "scanner.h"
+#include "strtab.h"
+#include "tools.h"
+
+/**
+ * @brief 索引文件的魔数，同时用作格式版本号
+ */
+#define INDEX_MAGIC "LEXIDX2"
+
+/**
+ * @brief 每批扫描的 Token 数量
+ */
+#define INDEX_BATCH 1024
+
+/**
+ * @brief 索引文件头
+ * @details 索引文件依次由文件头、文件表、标识符表、字符串区和倒排列表区组成，各部分的位置记录在文件头中。\n
+ * 所有整数按本机字节序保存，各部分按 8 字节对齐，mmap 后可以直接按结构体访问。
+ */
+typedef struct {
+	char magic[8];           ///< 魔数 INDEX_MAGIC
+	uint32_t fileCount;      ///< 文件数量
+	uint32_t termCount;      ///< 标识符数量
+	uint64_t filesOffset;    ///< 文件表的位置
+	uint64_t termsOffset;    ///< 标识符表的位置
+	uint64_t stringsOffset;  ///< 字符串区的位置，保存文件路径和标识符名称
+	uint64_t postingsOffset; ///< 倒排列表区的位置
+	uint64_t totalSize;      ///< 索引文件的总字节数
+	int64_t written;         ///< 开始检查文件之前的时间，单位为纳秒
+} IndexHeader;
+
+/**
+ * @brief 文件表的一项
+ */
+typedef struct {
+	uint64_t pathOffset; ///< 路径在字符串区中的位置
+	uint32_t pathLength; ///< 路径的长度
+	uint32_t reserved;   ///< 保留，用于对齐
+	int64_t mtime;       ///< 建立索引时文件的修改时间，单位为纳秒
+	int64_t ctime;       ///< 建立索引时文件的状态改变时间，单位为纳秒
+	uint64_t inode;      ///< 建立索引时文件的 inode 编号
+	uint64_t size;       ///< 建立索引时文件的字节数
+} IndexFile;
+
+/**
+ * @brief 标识符表的一项，整个表按名称排序
+ */
+typedef struct {
+	uint64_t nameOffset;     ///< 名称在字符串区中的位置
+	uint32_t nameLength;     ///< 名称的长度
+	uint32_t count;          ///< 出现的次数
+	uint64_t postingsOffset; ///< 倒排列表在倒排列表区中的位置
+	uint64_t postingsLength; ///< 倒排列表的字节数
+} IndexTerm;
+
+/**
+ * @brief 一次出现
+ * @details 倒排列表按 (file, offset) 排序后编码：每项依次为文件编号的差值、偏移和行号。\n
+ * 文件编号差值为 0 时，偏移和行号保存与上一项的差值，否则保存原值，所有数都用 LEB128 变长编码。
+ */
+typedef struct {
+	uint32_t file;   ///< 文件编号
+	uint32_t offset; ///< 标识符相对文件开头的字节偏移
+	uint32_t line;   ///< 标识符所在的行
+} Posting;
+
+/**
+ * @brief 一个标识符的全部出现位置
+ */
+typedef struct {
+	Posting *items;  ///< 出现位置数组
+	size_t count;    ///< 出现次数
+	size_t capacity; ///< 数组的容量
+} PostingList;
+
+/**
+ * @brief 单个文件中标识符的一次出现，名称用文件内部的编号表示
+ */
+typedef struct {
+	uint32_t name;   ///< 名称在该文件的字符串驻留表中的编号
+	uint32_t offset; ///< 字节偏移
+	uint32_t line;   ///< 行号
+} Occurrence;
+
+/**
+ * @brief 单个文件的分析结果
+ */
+typedef struct {
+	StringTable names; ///< 文件中出现的标识符名称
+	Occurrence *items; ///< 出现位置数组
+	size_t count;      ///< 出现次数
+	size_t capacity;   ///< 数组的容量
+	int64_t mtime;     ///< 文件的修改时间
+	int64_t ctime;     ///< 文件的状态改变时间
+	uint64_t inode;    ///< 文件的 inode 编号
+	uint64_t size;     ///< 文件的字节数
+	uint32_t reuse;    ///< 可以复用的旧文件编号，UINT32_MAX 表示需要重新分析
+} FileResult;
+
+/**
+ * @brief 映射到内存中的索引文件
+ */
+typedef struct {
+	const unsigned char *data;     ///< 文件内容
+	size_t size;                   ///< 文件的字节数
+	const IndexHeader *header;     ///< 文件头
+	const IndexFile *files;        ///< 文件表
+	const IndexTerm *terms;        ///< 标识符表
+	const char *strings;           ///< 字符串区
+	const unsigned char *postings; ///< 倒排列表区
+} MappedIndex;
+
+/**
+ * @brief 申请内存，失败时打印错误信息并退出程序
+ * @param memory 原内存，可以为 NULL
+ * @param size 需要的字节数
+ * @return 新内存
+ */
+static void *reallocOrDie(void *memory, size_t size) {
+	void *result = realloc(memory, size);
+	if (result == NULL && size > 0) {
+		fprintf(stderr, "内存不足，无法建立索引.\n");
+		exit(1);
+	}
+	return result;
+}
+
+/**
+ * @brief 映射索引文件并检查其结构
+ * @param path 索引文件路径
+ * @param index 输出的索引
+ * @return 文件存在且结构有效时返回 true，否则返回 false
+ */
+static bool mapIndex(const char *path, MappedIndex *index) {
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(IndexHeader)) {
+		close(fd);
+		return false;
+	}
+	void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		return false;
+	}
+	index->data = data;
+	index->size = (size_t)st.st_size;
+	index->header = data;
+	const IndexHeader *h = index->header;
+	// 先确认各部分的位置按顺序排列且不越界，比较时避免整数溢出
+	bool ok = memcmp(h->magic, INDEX_MAGIC, sizeof(h->magic)) == 0 && h->totalSize == index->size &&
+	          h->filesOffset >= sizeof(IndexHeader) && h->filesOffset % 8 == 0 && h->termsOffset % 8 == 0 &&
+	          h->filesOffset <= h->termsOffset &&
+	          (uint64_t)h->fileCount <= (h->termsOffset - h->filesOffset) / sizeof(IndexFile) &&
+	          h->termsOffset <= h->stringsOffset &&
+	          (uint64_t)h->termCount <= (h->stringsOffset - h->termsOffset) / sizeof(IndexTerm) &&
+	          h->stringsOffset <= h->postingsOffset && h->postingsOffset <= h->totalSize;
+	if (ok) {
+		index->files = (const IndexFile *)(index->data + h->filesOffset);
+		index->terms = (const IndexTerm *)(index->data + h->termsOffset);
+		index->strings = (const char *)(index->data + h->stringsOffset);
+		index->postings = index->data + h->postingsOffset;
+	}
+	// 逐项检查路径、名称和倒排列表都在各自的区域内，之后的访问不再需要检查这些边界
+	uint64_t stringsLength = ok ? h->postingsOffset - h->stringsOffset : 0;
+	uint64_t postingsLength = ok ? h->totalSize - h->postingsOffset : 0;
+	for (uint32_t i = 0; ok && i < h->fileCount; i++) {
+		const IndexFile *file = &index->files[i];
+		ok = file->pathOffset <= stringsLength && file->pathLength <= stringsLength - file->pathOffset;
+	}
+	for (uint32_t i = 0; ok && i < h->termCount; i++) {
+		const IndexTerm *term = &index->terms[i];
+		// 每个出现位置至少编码为 3 个字节
+		ok = term->nameOffset <= stringsLength && term->nameLength <= stringsLength - term->nameOffset &&
+		     term->postingsOffset <= postingsLength && term->postingsLength <= postingsLength - term->postingsOffset &&
+		     (uint64_t)term->count <= term->postingsLength / 3;
+	}
+	if (!ok) {
+		munmap(data, index->size);
+	}
+	return ok;
+}
+
+/**
+ * @brief 解除索引文件的映射
+ * @param index 索引
+ */
+static void unmapIndex(MappedIndex *index) {
+	munmap((void *)index->data, index->size);
+}
+
+/**
+ * @brief 读取一个 LEB128 变长编码的整数
+ * @param p 输入输出参数，读取后指向下一个整数
+ * @param end 可读区域的末尾
+ * @param value 输出参数，读取到的整数
+ * @return 成功返回 true，编码越过 end 或超过 64 位时返回 false
+ */
+static bool readVarint(const unsigned char **p, const unsigned char *end, uint64_t *value) {
+	*value = 0;
+	for (int shift = 0; shift < 64 && *p < end; shift += 7) {
+		unsigned char byte = *(*p)++;
+		*value |= (uint64_t)(byte & 0x7f) << shift;
+		if (!(byte & 0x80)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief 解码一个标识符的倒排列表
+ * @details 解码不会越过该项记录的倒排列表字节数，文件编号超出文件表时视为损坏。
+ * @param index 索引
+ * @param term 标识符表中的一项
+ * @param visit 每个出现位置调用一次的回调函数
+ * @param context 传给回调函数的上下文
+ * @return 倒排列表完整时返回 true，损坏时返回 false，此前的出现位置已经交给回调函数
+ */
+static bool decodePostings(const MappedIndex *index, const IndexTerm *term,
+                           void (*visit)(const Posting *posting, void *context), void *context) {
+	const unsigned char *p = index->postings + term->postingsOffset;
+	const unsigned char *end = p + term->postingsLength;
+	Posting posting = {0, 0, 0};
+	for (uint32_t i = 0; i < term->count; i++) {
+		uint64_t fileDelta, offset, line;
+		if (!readVarint(&p, end, &fileDelta) || !readVarint(&p, end, &offset) || !readVarint(&p, end, &line) ||
+		    fileDelta >= (uint64_t)index->header->fileCount - posting.file) {
+			return false;
+		}
+		if (fileDelta != 0 || i == 0) {
+			posting.file += (uint32_t)fileDelta;
+			posting.offset = (uint32_t)offset;
+			posting.line = (uint32_t)line;
+		} else {
+			posting.offset += (uint32_t)offset;
+			posting.line += (uint32_t)line;
+		}
+		visit(&posting, context);
+	}
+	return true;
+}
+
+/**
+ * @brief 读取文件的修改时间、状态改变时间、inode 编号和大小
+ * @param path 文件路径
+ * @param result 输出参数，填入其中的元数据字段
+ * @return 成功返回 true，否则返回 false
+ */
+static bool statFile(const char *path, FileResult *result) {
+	struct stat st;
+	if (stat(path, &st) != 0) {
+		return false;
+	}
+	result->mtime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+	result->ctime = (int64_t)st.st_ctim.tv_sec * 1000000000 + st.st_ctim.tv_nsec;
+	result->inode = (uint64_t)st.st_ino;
+	result->size = (uint64_t)st.st_size;
+	return true;
+}
+
+/**
+ * @brief 读取文件系统时间戳使用的粗粒度实时时钟
+ * @details 内核用粗粒度时钟给文件打时间戳，它可能比 CLOCK_REALTIME 落后一个时钟周期，
+ * 用同一个时钟才能保证之后修改的文件的时间戳不早于返回值。
+ * @return 当前时间，单位为纳秒
+ */
+static int64_t fileClock(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @brief 并行建立索引时的共享状态
+ */
+typedef struct {
+	const FileList *files; ///< 全部文件
+	FileResult *results;   ///< 每个文件的分析结果
+} IndexJob;
+
+/**
+ * @brief 分析一个文件，收集其中全部标识符的出现位置
+ * @param index 文件编号
+ * @param worker 工作线程编号
+ * @param context IndexJob
+ */
+static void indexTask(size_t index, int worker, void *context) {
+	(void)worker;
+	IndexJob *job = context;
+	FileResult *result = &job->results[index];
+	if (result->reuse != UINT32_MAX) {
+		return;
+	}
+	size_t length;
+	char *source = tryReadFile(job->files->paths[index], &length);
+	if (source == NULL) {
+		// stat 之后被删除或无法读取，清除 inode 编号，下次建立索引时一定重新分析
+		result->inode = 0;
+		return;
+	}
+	if (!looksBinary(source, length)) {
+		Token tokens[INDEX_BATCH];
+		initScannerWithFeatures(source, SCAN_LINES | SCAN_KEYWORDS);
+		for (bool done = false; !done;) {
+			size_t count = scanTokens(tokens, INDEX_BATCH);
+			for (size_t i = 0; i < count; i++) {
+				if (tokens[i].type == TOKEN_EOF) {
+					done = true;
+				}
+				if (tokens[i].type != TOKEN_IDENTIFIER) {
+					continue;
+				}
+				if (result->count == result->capacity) {
+					result->capacity = result->capacity < 256 ? 256 : result->capacity * 2;
+					result->items = reallocOrDie(result->items, result->capacity * sizeof(Occurrence));
+				}
+				Occurrence *occurrence = &result->items[result->count++];
+				occurrence->name = internString(&result->names, tokens[i].start, (size_t)tokens[i].length);
+				occurrence->offset = (uint32_t)(tokens[i].start - source);
+				occurrence->line = (uint32_t)tokens[i].line;
+			}
+		}
+	}
+	releaseFile(source, length);
+}
+
+/**
+ * @brief 向倒排列表追加一个出现位置
+ * @param list 倒排列表
+ * @param file 文件编号
+ * @param offset 字节偏移
+ * @param line 行号
+ */
+static void addPosting(PostingList *list, uint32_t file, uint32_t offset, uint32_t line) {
+	if (list->count == list->capacity) {
+		list->capacity = list->capacity < 8 ? 8 : list->capacity * 2;
+		list->items = reallocOrDie(list->items, list->capacity * sizeof(Posting));
+	}
+	Posting *posting = &list->items[list->count++];
+	posting->file = file;
+	posting->offset = offset;
+	posting->line = line;
+}
+
+/**
+ * @brief 全部标识符及其倒排列表
+ */
+typedef struct {
+	StringTable names;  ///< 标识符名称，编号即 lists 的下标
+	PostingList *lists; ///< 每个标识符的倒排列表
+	size_t capacity;    ///< lists 的容量
+} TermSet;
+
+/**
+ * @brief 取得标识符的倒排列表，不存在时新建
+ * @param terms 标识符集合
+ * @param name 名称
+ * @param length 名称的长度
+ * @return 倒排列表
+ */
+static PostingList *termList(TermSet *terms, const char *name, size_t length) {
+	uint32_t id = internString(&terms->names, name, length);
+	if (id >= terms->capacity) {
+		size_t capacity = terms->capacity < 1024 ? 1024 : terms->capacity * 2;
+		terms->lists = reallocOrDie(terms->lists, capacity * sizeof(PostingList));
+		memset(terms->lists + terms->capacity, 0, (capacity - terms->capacity) * sizeof(PostingList));
+		terms->capacity = capacity;
+	}
+	return &terms->lists[id];
+}
+
+/**
+ * @brief 复用旧索引时的上下文
+ */
+typedef struct {
+	PostingList *list; ///< 新的倒排列表
+	uint32_t *fileMap; ///< 旧文件编号到新文件编号的映射，UINT32_MAX 表示不复用
+} ReuseContext;
+
+/**
+ * @brief 把旧索引中仍然有效的出现位置加入新的倒排列表
+ * @param posting 旧索引中的出现位置
+ * @param context ReuseContext
+ */
+static void reusePosting(const Posting *posting, void *context) {
+	ReuseContext *reuse = context;
+	uint32_t file = reuse->fileMap[posting->file];
+	if (file != UINT32_MAX) {
+		addPosting(reuse->list, file, posting->offset, posting->line);
+	}
+}
+
+/**
+ * @brief 比较两个出现位置，按文件编号和偏移排序
+ */
+static int comparePostings(const void *a, const void *b) {
+	const Posting *x = a, *y = b;
+	if (x->file != y->file) {
+		return x->file < y->file ? -1 : 1;
+	}
+	return x->offset < y->offset ? -1 : x->offset > y->offset;
+}
+
+/**
+ * @brief 按名称比较两个字符串，先比较公共前缀，再比较长度
+ */
+static int compareNames(const char *a, size_t aLength, const char *b, size_t bLength) {
+	int result = memcmp(a, b, aLength < bLength ? aLength : bLength);
+	if (result != 0) {
+		return result;
+	}
+	return aLength < bLength ? -1 : aLength > bLength;
+}
+
+/**
+ * @brief 排序标识符编号时使用的名称表，qsort 不支持传入上下文
+ */
+static const StringTable *sortNames;
+
+/**
+ * @brief 按名称比较两个标识符编号
+ */
+static int compareTermIds(const void *a, const void *b) {
+	size_t aLength, bLength;
+	const char *x = stringAt(sortNames, *(const uint32_t *)a, &aLength);
+	const char *y = stringAt(sortNames, *(const uint32_t *)b, &bLength);
+	return compareNames(x, aLength, y, bLength);
+}
+
+/**
+ * @brief 可增长的字节缓冲区，用于拼接字符串区和倒排列表区
+ */
+typedef struct {
+	unsigned char *data; ///< 数据
+	size_t length;       ///< 已使用的字节数
+	size_t capacity;     ///< 容量
+} Bytes;
+
+/**
+ * @brief 向字节缓冲区追加数据
+ */
+static void appendBytes(Bytes *bytes, const void *data, size_t length) {
+	if (bytes->length + length > bytes->capacity) {
+		while (bytes->length + length > bytes->capacity) {
+			bytes->capacity = bytes->capacity < 4096 ? 4096 : bytes->capacity * 2;
+		}
+		bytes->data = reallocOrDie(bytes->data, bytes->capacity);
+	}
+	memcpy(bytes->data + bytes->length, data, length);
+	bytes->length += length;
+}
+
+/**
+ * @brief 以 LEB128 变长编码向字节缓冲区追加一个整数
+ */
+static void appendVarint(Bytes *bytes, uint64_t value) {
+	unsigned char buffer[10];
+	size_t length = 0;
+	do {
+		unsigned char byte = value & 0x7f;
+		value >>= 7;
+		buffer[length++] = byte | (value != 0 ? 0x80 : 0);
+	} while (value != 0);
+	appendBytes(bytes, buffer, length);
+}
+
+/**
+ * @brief 向字节缓冲区追加零字节，使长度对齐到 8 字节
+ */
+static void alignBytes(Bytes *bytes) {
+	static const unsigned char zeros[8] = {0};
+	appendBytes(bytes, zeros, (8 - bytes->length % 8) % 8);
+}
+
+/**
+ * @brief 把标识符集合写入索引文件
+ * @details 先写入临时文件再重命名，查询进程映射的旧索引不会被破坏
+ * @param indexPath 索引文件路径
+ * @param files 全部文件
+ * @param results 每个文件的元数据
+ * @param terms 标识符集合，没有出现位置的标识符不写入
+ * @param written 开始检查文件之前的时间
+ * @param writtenTerms 输出参数，写入的标识符数量
+ * @return 成功返回 true，否则返回 false
+ */
+static bool writeIndex(const char *indexPath, const FileList *files, const FileResult *results, const TermSet *terms,
+                       int64_t written, uint32_t *writtenTerms) {
+	uint32_t *order = reallocOrDie(NULL, ((size_t)terms->names.count + 1) * sizeof(uint32_t));
+	uint32_t termCount = 0;
+	for (uint32_t i = 0; i < terms->names.count; i++) {
+		// 只出现在已删除或已修改的文件中的旧标识符没有剩余的出现位置
+		if (terms->lists[i].count > 0) {
+			order[termCount++] = i;
+		}
+	}
+	sortNames = &terms->names;
+	qsort(order, termCount, sizeof(uint32_t), compareTermIds);
+
+	Bytes strings = {NULL, 0, 0}, postings = {NULL, 0, 0};
+	IndexFile *fileTable = reallocOrDie(NULL, ((size_t)files->count + 1) * sizeof(IndexFile));
+	for (int i = 0; i < files->count; i++) {
+		size_t length = strlen(files->paths[i]);
+		fileTable[i] = (IndexFile){strings.length,   (uint32_t)length, 0, results[i].mtime, results[i].ctime,
+		                           results[i].inode, results[i].size};
+		appendBytes(&strings, files->paths[i], length);
+	}
+	IndexTerm *termTable = reallocOrDie(NULL, ((size_t)termCount + 1) * sizeof(IndexTerm));
+	for (uint32_t i = 0; i < termCount; i++) {
+		size_t length;
+		const char *name = stringAt(&terms->names, order[i], &length);
+		PostingList *list = &terms->lists[order[i]];
+		qsort(list->items, list->count, sizeof(Posting), comparePostings);
+		termTable[i].nameOffset = strings.length;
+		termTable[i].nameLength = (uint32_t)length;
+		termTable[i].count = (uint32_t)list->count;
+		termTable[i].postingsOffset = postings.length;
+		appendBytes(&strings, name, length);
+		for (size_t j = 0; j < list->count; j++) {
+			const Posting *posting = &list->items[j];
+			if (j > 0 && posting->file == list->items[j - 1].file) {
+				appendVarint(&postings, 0);
+				appendVarint(&postings, posting->offset - list->items[j - 1].offset);
+				appendVarint(&postings, posting->line - list->items[j - 1].line);
+			} else {
+				appendVarint(&postings, j > 0 ? posting->file - list->items[j - 1].file : posting->file);
+				appendVarint(&postings, posting->offset);
+				appendVarint(&postings, posting->line);
+			}
+		}
+		termTable[i].postingsLength = postings.length - termTable[i].postingsOffset;
+	}
+	alignBytes(&strings);
+
+	IndexHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+	header.fileCount = (uint32_t)files->count;
+	header.termCount = termCount;
+	header.filesOffset = sizeof(IndexHeader);
+	header.termsOffset = header.filesOffset + (uint64_t)files->count * sizeof(IndexFile);
+	header.stringsOffset = header.termsOffset + (uint64_t)termCount * sizeof(IndexTerm);
+	header.postingsOffset = header.stringsOffset + strings.length;
+	header.totalSize = header.postingsOffset + postings.length;
+	header.written = written;
+
+	size_t tmpLength = strlen(indexPath) + 5;
+	char *tmpPath = reallocOrDie(NULL, tmpLength);
+	snprintf(tmpPath, tmpLength, "%s.tmp", indexPath);
+	FILE *file = fopen(tmpPath, "wb");
+	bool ok = file != NULL;
+	if (ok) {
+		fwrite(&header, sizeof(header), 1, file);
+		fwrite(fileTable, sizeof(IndexFile), (size_t)files->count, file);
+		fwrite(termTable, sizeof(IndexTerm), termCount, file);
+		fwrite(strings.data, 1, strings.length, file);
+		fwrite(postings.data, 1, postings.length, file);
+		ok = !ferror(file);
+		ok = fclose(file) == 0 && ok;
+		ok = ok && rename(tmpPath, indexPath) == 0;
+	}
+	if (!ok) {
+		fprintf(stderr, "无法写入索引文件 \"%s\".\n", indexPath);
+	}
+	*writtenTerms = termCount;
+	free(tmpPath);
+	free(order);
+	free(fileTable);
+	free(termTable);
+	free(strings.data);
+	free(postings.data);
+	return ok;
+}
+
+int buildIndex(const char *indexPath, int count, const char *paths[]) {
+	FileList files;
+	collectFiles(&files, count, paths);
+	FileResult *results = reallocOrDie(NULL, ((size_t)files.count + 1) * sizeof(FileResult));
+	memset(results, 0, ((size_t)files.count + 1) * sizeof(FileResult));
+
+	// 用旧索引的文件表判断哪些文件没有变化
+	MappedIndex old;
+	bool hasOld = mapIndex(indexPath, &old);
+	StringTable oldPaths;
+	initStringTable(&oldPaths);
+	uint32_t *fileMap = NULL; // 旧文件编号到新文件编号的映射
+	if (hasOld) {
+		fileMap = reallocOrDie(NULL, ((size_t)old.header->fileCount + 1) * sizeof(uint32_t));
+		for (uint32_t i = 0; i < old.header->fileCount; i++) {
+			internString(&oldPaths, old.strings + old.files[i].pathOffset, old.files[i].pathLength);
+			fileMap[i] = UINT32_MAX;
+		}
+	}
+	// 在 stat 之前取得时间，之后修改的文件的时间戳一定不早于它
+	int64_t written = fileClock();
+	size_t reused = 0;
+	for (int i = 0; i < files.count; i++) {
+		results[i].reuse = UINT32_MAX;
+		initStringTable(&results[i].names);
+		if (!statFile(files.paths[i], &results[i])) {
+			continue;
+		}
+		uint32_t oldId = hasOld ? findString(&oldPaths, files.paths[i], strlen(files.paths[i])) : UINT32_MAX;
+		if (oldId == UINT32_MAX) {
+			continue;
+		}
+		// 状态改变时间不早于上次建立索引的文件可能在同一时间刻度内又被修改过，不能只凭元数据判断
+		const IndexFile *file = &old.files[oldId];
+		if (file->mtime == results[i].mtime && file->ctime == results[i].ctime && file->inode == results[i].inode &&
+		    file->size == results[i].size && results[i].ctime < old.header->written) {
+			results[i].reuse = oldId;
+			fileMap[oldId] = (uint32_t)i;
+			reused++;
+		}
+	}
+
+	TermSet terms;
+	initStringTable(&terms.names);
+	terms.lists = NULL;
+	terms.capacity = 0;
+	bool damaged = false;
+	for (uint32_t t = 0; reused > 0 && !damaged && t < old.header->termCount; t++) {
+		const IndexTerm *term = &old.terms[t];
+		ReuseContext reuse = {termList(&terms, old.strings + term->nameOffset, term->nameLength), fileMap};
+		damaged = !decodePostings(&old, term, reusePosting, &reuse);
+	}
+	if (damaged) {
+		// 旧索引的倒排列表损坏，放弃复用，全部重新分析
+		fprintf(stderr, "索引文件 \"%s\" 已损坏，重新分析全部文件.\n", indexPath);
+		for (size_t i = 0; i < terms.names.count; i++) {
+			terms.lists[i].count = 0;
+		}
+		for (int i = 0; i < files.count; i++) {
+			results[i].reuse = UINT32_MAX;
+		}
+		reused = 0;
+	}
+
+	// 只有发生变化的文件需要重新分析
+	IndexJob job = {&files, results};
+	parallelFor((size_t)files.count, indexTask, &job);
+
+	for (int i = 0; i < files.count; i++) {
+		FileResult *result = &results[i];
+		for (size_t j = 0; j < result->count; j++) {
+			size_t length;
+			const char *name = stringAt(&result->names, result->items[j].name, &length);
+			addPosting(termList(&terms, name, length), (uint32_t)i, result->items[j].offset, result->items[j].line);
+		}
+		freeStringTable(&result->names);
+		free(result->items);
+	}
+	if (hasOld) {
+		unmapIndex(&old);
+	}
+	uint32_t termCount;
+	bool ok = writeIndex(indexPath, &files, results, &terms, written, &termCount);
+	if (ok) {
+		fprintf(stderr, "索引 %d 个文件：重新分析 %zu 个，复用 %zu 个，共 %u 个标识符.\n", files.count,
+		        (size_t)files.count - reused, reused, termCount);
+	}
+	for (size_t i = 0; i < terms.names.count; i++) {
+		free(terms.lists[i].items);
+	}
+	free(terms.lists);
+	freeStringTable(&terms.names);
+	freeStringTable(&oldPaths);
+	free(fileMap);
+	free(results);
+	freeFileList(&files);
+	return ok ? 0 : 1;
+}
+
+/**
+ * @brief 查询时的输出上下文
+ */
+typedef struct {
+	const MappedIndex *index; ///< 索引
+	FILE *out;                ///< 输出目标
+} QueryContext;
+
+/**
+ * @brief 输出一个出现位置
+ * @param posting 出现位置
+ * @param context QueryContext
+ */
+static void printPosting(const Posting *posting, void *context) {
+	QueryContext *query = context;
+	const IndexFile *file = &query->index->files[posting->file];
+	fprintf(query->out, "%.*s:%u: %u\n", (int)file->pathLength, query->index->strings + file->pathOffset,
+	        posting->line, posting->offset);
+}
+
+long queryIndex(const char *indexPath, const char *name, FILE *out) {
+	MappedIndex index;
+	if (!mapIndex(indexPath, &index)) {
+		fprintf(stderr, "无效的索引文件 \"%s\".\n", indexPath);
+		return -1;
+	}
+	size_t length = strlen(name);
+	long found = 0;
+	uint32_t low = 0, high = index.header->termCount;
+	while (low < high) {
+		uint32_t mid = low + (high - low) / 2;
+		const IndexTerm *term = &index.terms[mid];
+		int result = compareNames(index.strings + term->nameOffset, term->nameLength, name, length);
+		if (result == 0) {
+			QueryContext query = {&index, out};
+			found = decodePostings(&index, term, printPosting, &query) ? (long)term->count : -1;
+			if (found < 0) {
+				fprintf(stderr, "无效的索引文件 \"%s\".\n", indexPath);
+			}
+			break;
+		}
+		if (result < 0) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	unmapIndex(&index);
+	return found;
+}
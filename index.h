@@ -0,0 +1,27 @@
+#pragma once
+#include <stdio.h>
+
+/**
+ * @brief 建立或更新标识符倒排索引
+ * @details 并行分析所有文件，为每个标识符记录其全部出现位置（文件、字节偏移、行号），
+ * 以增量编码的倒排列表写入一个可以直接 mmap 的索引文件。\n
+ * 索引文件已经存在时，大小、修改时间、状态改变时间和 inode 编号都没有变化，
+ * 并且状态改变时间早于上次建立索引的文件直接复用旧索引中的记录，只重新分析其余的文件。\n
+ * 索引中只保存至少出现一次的标识符。
+ * @param indexPath 索引文件路径
+ * @param count 路径数量
+ * @param paths 路径数组，目录会被递归展开
+ * @return 成功返回 0，失败返回 1
+ */
+int buildIndex(const char *indexPath, int count, const char *paths[]);
+
+/**
+ * @brief 查询标识符的出现位置
+ * @details 通过 mmap 打开索引文件，在按名称排序的标识符表中二分查找，解码倒排列表后输出，不需要重新分析任何源文件。\n
+ * 每个位置输出一行 "路径:行号: 偏移"。
+ * @param indexPath 索引文件路径
+ * @param name 标识符
+ * @param out 输出目标
+ * @return 出现的次数，索引文件无效时返回 -1
+ */
+long queryIndex(const char *indexPath, const char *name, FILE *out);
@@ -0,0 +1,332 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "json.h"
+
+/**
+ * @brief 数组和对象的最大嵌套深度，防止恶意输入耗尽栈空间
+ */
+#define JSON_MAX_DEPTH 64
+
+/**
+ * @brief 解析器状态
+ */
+typedef struct {
+	const char *current; ///< 当前位置
+	const char *end;     ///< 文本结尾
+	Arena *arena;        ///< 分配节点的 Arena
+	int depth;           ///< 当前的嵌套深度
+} JsonParser;
+
+static JsonValue *parseValue(JsonParser *parser);
+
+/**
+ * @brief 跳过空白字符
+ */
+static void skipSpace(JsonParser *parser) {
+	while (parser->current < parser->end &&
+	       (*parser->current == ' ' || *parser->current == '\t' || *parser->current == '\n' || *parser->current == '\r')) {
+		parser->current++;
+	}
+}
+
+/**
+ * @brief 如果下一个字符是 c 则跳过它
+ * @return 跳过返回 true，否则返回 false
+ */
+static bool consume(JsonParser *parser, char c) {
+	skipSpace(parser);
+	if (parser->current < parser->end && *parser->current == c) {
+		parser->current++;
+		return true;
+	}
+	return false;
+}
+
+/**
+ * @brief 分配一个节点
+ */
+static JsonValue *newValue(JsonParser *parser, JsonType type, const char *start) {
+	JsonValue *value = arenaAlloc(parser->arena, sizeof(JsonValue));
+	memset(value, 0, sizeof(JsonValue));
+	value->type = type;
+	value->text = start;
+	return value;
+}
+
+/**
+ * @brief 读取 \\u 之后的 4 位十六进制数
+ * @return 码元，格式错误时返回 -1
+ */
+static long readHex4(JsonParser *parser) {
+	if (parser->end - parser->current < 4) {
+		return -1;
+	}
+	long value = 0;
+	for (int i = 0; i < 4; i++) {
+		char c = *parser->current++;
+		value <<= 4;
+		if (c >= '0' && c <= '9') {
+			value |= c - '0';
+		} else if (c >= 'a' && c <= 'f') {
+			value |= c - 'a' + 10;
+		} else if (c >= 'A' && c <= 'F') {
+			value |= c - 'A' + 10;
+		} else {
+			return -1;
+		}
+	}
+	return value;
+}
+
+/**
+ * @brief 把一个码点写为 UTF-8
+ * @return 写入的字节数
+ */
+static size_t encodeUtf8(char *out, uint32_t code) {
+	if (code < 0x80) {
+		out[0] = (char)code;
+		return 1;
+	}
+	if (code < 0x800) {
+		out[0] = (char)(0xc0 | (code >> 6));
+		out[1] = (char)(0x80 | (code & 0x3f));
+		return 2;
+	}
+	if (code < 0x10000) {
+		out[0] = (char)(0xe0 | (code >> 12));
+		out[1] = (char)(0x80 | ((code >> 6) & 0x3f));
+		out[2] = (char)(0x80 | (code & 0x3f));
+		return 3;
+	}
+	out[0] = (char)(0xf0 | (code >> 18));
+	out[1] = (char)(0x80 | ((code >> 12) & 0x3f));
+	out[2] = (char)(0x80 | ((code >> 6) & 0x3f));
+	out[3] = (char)(0x80 | (code & 0x3f));
+	return 4;
+}
+
+/**
+ * @brief 解析字符串，当前位置为开头的引号
+ * @details 转义后的内容不会比原文更长，因此按原文长度分配一次即可
+ * @param length 输出参数，返回转义后的字节数
+ * @return 转义后的字符串，格式错误时返回 NULL
+ */
+static char *parseString(JsonParser *parser, size_t *length) {
+	parser->current++; // 开头的引号
+	const char *close = parser->current;
+	while (close < parser->end && *close != '"') {
+		close += *close == '\\' ? 2 : 1;
+	}
+	if (close >= parser->end) {
+		return NULL;
+	}
+	char *out = arenaAlloc(parser->arena, (size_t)(close - parser->current) + 1);
+	char *p = out;
+	while (parser->current < close) {
+		char c = *parser->current++;
+		if ((unsigned char)c < 0x20) {
+			return NULL;
+		}
+		if (c != '\\') {
+			*p++ = c;
+			continue;
+		}
+		c = *parser->current++;
+		switch (c) {
+			case '"': *p++ = '"'; break;
+			case '\\': *p++ = '\\'; break;
+			case '/': *p++ = '/'; break;
+			case 'b': *p++ = '\b'; break;
+			case 'f': *p++ = '\f'; break;
+			case 'n': *p++ = '\n'; break;
+			case 'r': *p++ = '\r'; break;
+			case 't': *p++ = '\t'; break;
+			case 'u': {
+				long code = readHex4(parser);
+				if (code < 0) {
+					return NULL;
+				}
+				// 高代理项后面紧跟低代理项时组合为一个码点，单独出现的代理项替换为 U+FFFD
+				if (code >= 0xd800 && code < 0xdc00 && close - parser->current >= 6 && parser->current[0] == '\\' &&
+				    parser->current[1] == 'u') {
+					const char *saved = parser->current;
+					parser->current += 2;
+					long low = readHex4(parser);
+					if (low >= 0xdc00 && low < 0xe000) {
+						code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+					} else {
+						parser->current = saved;
+						code = 0xfffd;
+					}
+				} else if (code >= 0xd800 && code < 0xe000) {
+					code = 0xfffd;
+				}
+				p += encodeUtf8(p, (uint32_t)code);
+				break;
+			}
+			default: return NULL;
+		}
+	}
+	parser->current = close + 1;
+	*p = '\0';
+	*length = (size_t)(p - out);
+	return out;
+}
+
+/**
+ * @brief 解析数组或对象
+ * @param object 为 true 时解析对象，否则解析数组
+ */
+static JsonValue *parseContainer(JsonParser *parser, bool object) {
+	if (++parser->depth > JSON_MAX_DEPTH) {
+		return NULL;
+	}
+	JsonValue *container = newValue(parser, object ? JSON_OBJECT : JSON_ARRAY, parser->current);
+	parser->current++;
+	char close = object ? '}' : ']';
+	JsonValue **tail = &container->first;
+	if (!consume(parser, close)) {
+		do {
+			const char *key = NULL;
+			if (object) {
+				skipSpace(parser);
+				size_t keyLength;
+				if (parser->current >= parser->end || *parser->current != '"' ||
+				    (key = parseString(parser, &keyLength)) == NULL || !consume(parser, ':')) {
+					return NULL;
+				}
+			}
+			JsonValue *item = parseValue(parser);
+			if (item == NULL) {
+				return NULL;
+			}
+			item->key = key;
+			*tail = item;
+			tail = &item->next;
+			container->count++;
+		} while (consume(parser, ','));
+		if (!consume(parser, close)) {
+			return NULL;
+		}
+	}
+	container->length = (size_t)(parser->current - container->text);
+	parser->depth--;
+	return container;
+}
+
+/**
+ * @brief 判断接下来的文本是否为指定的字面量，是则跳过
+ */
+static bool matchLiteral(JsonParser *parser, const char *literal) {
+	size_t length = strlen(literal);
+	if ((size_t)(parser->end - parser->current) >= length && memcmp(parser->current, literal, length) == 0) {
+		parser->current += length;
+		return true;
+	}
+	return false;
+}
+
+/**
+ * @brief 解析一个值
+ */
+static JsonValue *parseValue(JsonParser *parser) {
+	skipSpace(parser);
+	if (parser->current >= parser->end) {
+		return NULL;
+	}
+	const char *start = parser->current;
+	JsonValue *value;
+	switch (*start) {
+		case '{': return parseContainer(parser, true);
+		case '[': return parseContainer(parser, false);
+		case '"': {
+			size_t length;
+			char *text = parseString(parser, &length);
+			if (text == NULL) {
+				return NULL;
+			}
+			value = newValue(parser, JSON_STRING, text);
+			value->length = length;
+			return value;
+		}
+		case 't':
+		case 'f':
+		case 'n':
+			if (matchLiteral(parser, "true") || matchLiteral(parser, "false")) {
+				value = newValue(parser, JSON_BOOL, start);
+				value->boolean = *start == 't';
+			} else if (matchLiteral(parser, "null")) {
+				value = newValue(parser, JSON_NULL, start);
+			} else {
+				return NULL;
+			}
+			value->length = (size_t)(parser->current - start);
+			return value;
+		default: {
+			// 数字可能位于缓冲区末尾，复制到以空字符结尾的临时缓冲区后再转换
+			char digits[64];
+			size_t length = 0;
+			while (parser->current + length < parser->end && length < sizeof(digits) - 1 &&
+			       strchr("+-0123456789.eE", parser->current[length]) != NULL) {
+				length++;
+			}
+			if (length == 0) {
+				return NULL;
+			}
+			memcpy(digits, start, length);
+			digits[length] = '\0';
+			char *stop;
+			double number = strtod(digits, &stop);
+			if (stop != digits + length) {
+				return NULL;
+			}
+			parser->current += length;
+			value = newValue(parser, JSON_NUMBER, start);
+			value->number = number;
+			value->length = length;
+			return value;
+		}
+	}
+}
+
+JsonValue *parseJson(const char *text, size_t length, Arena *arena) {
+	JsonParser parser = {text, text + length, arena, 0};
+	JsonValue *value = parseValue(&parser);
+	skipSpace(&parser);
+	return parser.current == parser.end ? value : NULL;
+}
+
+const JsonValue *jsonMember(const JsonValue *object, const char *key) {
+	if (object == NULL || object->type != JSON_OBJECT) {
+		return NULL;
+	}
+	for (const JsonValue *member = object->first; member != NULL; member = member->next) {
+		if (strcmp(member->key, key) == 0) {
+			return member;
+		}
+	}
+	return NULL;
+}
+
+void printJsonString(FILE *out, const char *text, size_t length) {
+	fputc('"', out);
+	for (size_t i = 0; i < length; i++) {
+		unsigned char c = (unsigned char)text[i];
+		switch (c) {
+			case '"': fputs("\\\"", out); break;
+			case '\\': fputs("\\\\", out); break;
+			case '\n': fputs("\\n", out); break;
+			case '\r': fputs("\\r", out); break;
+			case '\t': fputs("\\t", out); break;
+			default:
+				if (c < 0x20) {
+					fprintf(out, "\\u%04x", c);
+				} else {
+					fputc(c, out);
+				}
+		}
+	}
+	fputc('"', out);
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "arena.h"
+
+/**
+ * @brief JSON 值的类型
+ */
+typedef enum {
+	JSON_NULL,   ///< null
+	JSON_BOOL,   ///< true 或 false
+	JSON_NUMBER, ///< 数字
+	JSON_STRING, ///< 字符串
+	JSON_ARRAY,  ///< 数组
+	JSON_OBJECT, ///< 对象
+} JsonType;
+
+typedef struct JsonValue JsonValue;
+
+/**
+ * @brief JSON 值
+ * @details 数组的元素和对象的成员以链表形式保存，查找成员为线性查找，适合协议消息这样的小对象
+ */
+struct JsonValue {
+	JsonType type;    ///< 类型
+	bool boolean;     ///< JSON_BOOL 的值
+	double number;    ///< JSON_NUMBER 的值
+	const char *text; ///< JSON_STRING 转义后的内容，以空字符结尾；其他类型为原始文本的起始位置
+	size_t length;    ///< JSON_STRING 转义后的字节数；其他类型为原始文本的长度
+	const char *key;  ///< 作为对象成员时的名称，以空字符结尾
+	JsonValue *first; ///< 数组的第一个元素或对象的第一个成员
+	JsonValue *next;  ///< 同一数组或对象中的下一个值
+	size_t count;     ///< 数组的元素数量或对象的成员数量
+};
+
+/**
+ * @brief 解析 JSON 文本
+ * @details 字符串中的转义序列在解析时展开，\\u 转义按 UTF-16 代理对组合后写为 UTF-8，所有节点从 arena 分配
+ * @param text JSON 文本，不要求以空字符结尾
+ * @param length 文本的字节数
+ * @param arena 分配节点和字符串的 Arena
+ * @return 根节点，文本不是合法的 JSON 时返回 NULL
+ */
+JsonValue *parseJson(const char *text, size_t length, Arena *arena);
+
+/**
+ * @brief 查找对象的成员
+ * @param object JSON 对象，可以为 NULL
+ * @param key 成员名称
+ * @return 成员的值，object 不是对象或没有该成员时返回 NULL
+ */
+const JsonValue *jsonMember(const JsonValue *object, const char *key);
+
+/**
+ * @brief 输出带引号和转义的 JSON 字符串
+ * @param out 输出目标
+ * @param text 字符串
+ * @param length 字符串的字节数
+ */
+void printJsonString(FILE *out, const char *text, size_t length);
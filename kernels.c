@@ -0,0 +1,258 @@
+#include <string.h>
+
+#include "kernels.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * @brief 二进制检测时最多检查的字节数
+ * @details 只检查开头的数据块即可判断绝大多数二进制文件，不需要读完整个输入
+ */
+#define BINARY_PROBE_SIZE 8192
+
+/**
+ * @brief 判断单个字节是否为控制字符
+ * @param c 待判断的字节
+ * @return 如果 c 小于 0x20 且不是 \\t \\n \\v \\f \\r，或者 c 为 0x7f，返回 true
+ */
+static bool isControl(unsigned char c) {
+	return (c < 0x20 && (c < '\t' || c > '\r')) || c == 0x7f;
+}
+
+bool looksBinary(const char *data, size_t length) {
+	size_t limit = length < BINARY_PROBE_SIZE ? length : BINARY_PROBE_SIZE;
+	size_t controls = 0; // 控制字符数量
+	size_t i = 0;
+#ifdef __SSE2__
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i lowMax = _mm_set1_epi8(0x1f);
+	const __m128i spaceMin = _mm_set1_epi8('\t');
+	const __m128i spaceSpan = _mm_set1_epi8('\r' - '\t');
+	const __m128i del = _mm_set1_epi8(0x7f);
+	for (; i + 16 <= limit; i += 16) {
+		__m128i block = _mm_loadu_si128((const __m128i *)(data + i));
+		// 无符号比较 block <= 0x1f 等价于 min(block, 0x1f) == block
+		__m128i low = _mm_cmpeq_epi8(_mm_min_epu8(block, lowMax), block);
+		// 减去 '\t' 后无符号不大于 4 的字节即为 \t \n \v \f \r
+		__m128i shifted = _mm_sub_epi8(block, spaceMin);
+		__m128i space = _mm_cmpeq_epi8(_mm_min_epu8(shifted, spaceSpan), shifted);
+		__m128i control = _mm_or_si128(_mm_andnot_si128(space, low), _mm_cmpeq_epi8(block, del));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(block, zero)) != 0) {
+			return true; // 文本文件中不应出现空字符
+		}
+		controls += (size_t)__builtin_popcount((unsigned)_mm_movemask_epi8(control));
+	}
+#endif
+	for (; i < limit; i++) {
+		unsigned char c = (unsigned char)data[i];
+		if (c == '\0') {
+			return true;
+		}
+		controls += isControl(c);
+	}
+	return controls * 8 > limit;
+}
+
+const char *findQuoteOrNewline(const char *p, const char *end, char quote) {
+#ifdef __SSE2__
+	const __m128i quotes = _mm_set1_epi8(quote);
+	const __m128i newlines = _mm_set1_epi8('\n');
+	const __m128i zero = _mm_setzero_si128();
+	for (; p + 16 <= end; p += 16) {
+		__m128i block = _mm_loadu_si128((const __m128i *)p);
+		__m128i hit = _mm_or_si128(_mm_cmpeq_epi8(block, quotes),
+		                           _mm_or_si128(_mm_cmpeq_epi8(block, newlines), _mm_cmpeq_epi8(block, zero)));
+		int mask = _mm_movemask_epi8(hit);
+		if (mask != 0) {
+			return p + __builtin_ctz((unsigned)mask);
+		}
+	}
+#endif
+	for (; p < end; p++) {
+		if (*p == quote || *p == '\n' || *p == '\0') {
+			return p;
+		}
+	}
+	return end;
+}
+
+#ifdef __SSE2__
+/**
+ * @brief 对 16 个字节做无符号区间判断
+ * @param block 输入的 16 个字节
+ * @param low 区间下界
+ * @param span 区间宽度，即上界减下界
+ * @return 每个落在 [low, low + span] 内的字节对应位置为 0xff，否则为 0
+ */
+static __m128i inRange(__m128i block, char low, char span) {
+	__m128i shifted = _mm_sub_epi8(block, _mm_set1_epi8(low));
+	return _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(span)), shifted);
+}
+#endif
+
+size_t estimateTokenCount(const char *data, size_t length) {
+	size_t count = 1; // TOKEN_EOF
+	unsigned prevWord = 0;  // 上一个字节是否为字母或数字
+	unsigned prevDigit = 0; // 上一个字节是否为数字
+	unsigned prevHigh = 0;  // 上一个字节是否为非 ASCII 字节
+	size_t i = 0;
+#ifdef __SSE2__
+	for (; i + 16 <= length; i += 16) {
+		__m128i block = _mm_loadu_si128((const __m128i *)(data + i));
+		// 与 0x20 按位或可以把大写字母转换为小写字母
+		__m128i lower = _mm_or_si128(block, _mm_set1_epi8(0x20));
+		__m128i alphaBytes = _mm_or_si128(inRange(lower, 'a', 'z' - 'a'),
+		                                  _mm_cmpeq_epi8(block, _mm_set1_epi8('_')));
+		__m128i digitBytes = inRange(block, '0', 9);
+		__m128i spaceBytes = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(' ')),
+		                                               _mm_cmpeq_epi8(block, _mm_set1_epi8('\t'))),
+		                                  _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('\r')),
+		                                               _mm_cmpeq_epi8(block, _mm_set1_epi8('\n'))));
+		unsigned alpha = (unsigned)_mm_movemask_epi8(alphaBytes);
+		unsigned digit = (unsigned)_mm_movemask_epi8(digitBytes);
+		unsigned space = (unsigned)_mm_movemask_epi8(spaceBytes);
+		unsigned high = (unsigned)_mm_movemask_epi8(block); // 最高位为 1 的字节
+		unsigned word = alpha | digit;
+		unsigned other = ~(word | space | high) & 0xffff;
+		// 左移一位得到每个字节前一个字节的分类，最低位由上一个数据块的最后一个字节补上
+		unsigned wordBefore = ((word << 1) | prevWord) & 0xffff;
+		unsigned digitBefore = ((digit << 1) | prevDigit) & 0xffff;
+		unsigned highBefore = ((high << 1) | prevHigh) & 0xffff;
+		unsigned starts = other | (word & ~wordBefore) | (alpha & digitBefore) | (high & ~highBefore);
+		count += (size_t)__builtin_popcount(starts);
+		prevWord = word >> 15;
+		prevDigit = digit >> 15;
+		prevHigh = high >> 15;
+	}
+#endif
+	for (; i < length; i++) {
+		char c = data[i];
+		unsigned alpha = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+		unsigned digit = c >= '0' && c <= '9';
+		unsigned space = c == ' ' || c == '\t' || c == '\r' || c == '\n';
+		unsigned high = (unsigned char)c >= 0x80;
+		unsigned word = alpha | digit;
+		count += (!word && !space && !high) || (word && !prevWord) || (alpha && prevDigit) || (high && !prevHigh);
+		prevWord = word;
+		prevDigit = digit;
+		prevHigh = high;
+	}
+	return count;
+}
+
+size_t findHtmlSpecial(const char *data, size_t length) {
+	size_t i = 0;
+#ifdef __SSE2__
+	const __m128i less = _mm_set1_epi8('<');
+	const __m128i greater = _mm_set1_epi8('>');
+	const __m128i amper = _mm_set1_epi8('&');
+	const __m128i quote = _mm_set1_epi8('"');
+	for (; i + 16 <= length; i += 16) {
+		__m128i block = _mm_loadu_si128((const __m128i *)(data + i));
+		__m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, less), _mm_cmpeq_epi8(block, greater)),
+		                           _mm_or_si128(_mm_cmpeq_epi8(block, amper), _mm_cmpeq_epi8(block, quote)));
+		int mask = _mm_movemask_epi8(hit);
+		if (mask != 0) {
+			return i + (size_t)__builtin_ctz((unsigned)mask);
+		}
+	}
+#endif
+	for (; i < length; i++) {
+		char c = data[i];
+		if (c == '<' || c == '>' || c == '&' || c == '"') {
+			return i;
+		}
+	}
+	return length;
+}
+
+/**
+ * @brief 把 64 位整数的各位充分混合
+ * @param h 输入
+ * @return 混合后的结果
+ */
+static uint64_t mix64(uint64_t h) {
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+uint64_t hashBytes(const void *data, size_t length) {
+	const unsigned char *p = data;
+	uint64_t h = 0x9e3779b97f4a7c15ULL ^ (length * 0x100000001b3ULL);
+	while (length >= 8) {
+		uint64_t word;
+		memcpy(&word, p, 8);
+		h = (h ^ mix64(word)) * 0x100000001b3ULL;
+		p += 8;
+		length -= 8;
+	}
+	uint64_t tail = 0;
+	memcpy(&tail, p, length);
+	return mix64(h ^ tail);
+}
+
+/**
+ * @brief 对一行中第一个非空白字符开始的内容分类
+ */
+static inline void classifyLine(const char *data, size_t i, size_t length, LineCounts *counts) {
+	if (data[i] == '/' && i + 1 < length && data[i + 1] == '/') {
+		counts->comment++;
+	} else {
+		counts->code++;
+	}
+}
+
+LineCounts countLines(const char *data, size_t length) {
+	LineCounts counts = {0, 0, 0};
+	bool lineStart = true; // 当前行还没有出现非空白字符
+	size_t i = 0;
+#ifdef __SSE2__
+	for (; i + 16 <= length; i += 16) {
+		__m128i block = _mm_loadu_si128((const __m128i *)(data + i));
+		__m128i newlineBytes = _mm_cmpeq_epi8(block, _mm_set1_epi8('\n'));
+		__m128i blankBytes = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(' ')),
+		                                               _mm_cmpeq_epi8(block, _mm_set1_epi8('\t'))),
+		                                  _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('\r')), newlineBytes));
+		unsigned newline = (unsigned)_mm_movemask_epi8(newlineBytes);
+		unsigned solid = ~(unsigned)_mm_movemask_epi8(blankBytes) & 0xffff;
+		// 依次处理数据块中的事件：行首等待第一个非空白字符或换行符，其他位置只等待换行符
+		for (;;) {
+			unsigned events = lineStart ? (newline | solid) : newline;
+			if (events == 0) {
+				break;
+			}
+			unsigned bit = (unsigned)__builtin_ctz(events);
+			unsigned below = (2u << bit) - 1;
+			if (newline & (1u << bit)) {
+				counts.blank += lineStart;
+				lineStart = true;
+			} else {
+				classifyLine(data, i + bit, length, &counts);
+				lineStart = false;
+			}
+			newline &= ~below;
+			solid &= ~below;
+		}
+	}
+#endif
+	for (; i < length; i++) {
+		char c = data[i];
+		if (c == '\n') {
+			counts.blank += lineStart;
+			lineStart = true;
+		} else if (lineStart && c != ' ' && c != '\t' && c != '\r') {
+			classifyLine(data, i, length, &counts);
+			lineStart = false;
+		}
+	}
+	if (length > 0 && data[length - 1] != '\n' && lineStart) {
+		counts.blank++; // 最后一行只有空白且没有换行符
+	}
+	return counts;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief 判断输入是否像二进制文件
+ * @details 只检查输入开头的若干个数据块，统计其中空字符和控制字符的数量。\n
+ * 出现空字符，或控制字符（不含 \\t \\n \\v \\f \\r）占比超过 1/8 时视为二进制文件。\n
+ * 在支持 SSE2 的平台上每次处理 16 个字节。
+ * @param data 输入数据
+ * @param length 输入数据的长度
+ * @return 如果输入像二进制文件返回 true，否则返回 false
+ */
+bool looksBinary(const char *data, size_t length);
+
+/**
+ * @brief 查找引号、换行符或空字符
+ * @details 用于快速跳过字符串和字符字面量的内容，在支持 SSE2 的平台上每次比较 16 个字节。
+ * @param p 查找的起始位置
+ * @param end 查找的结束位置（不包含）
+ * @param quote 要查找的引号字符，'"' 或 '\''
+ * @return 第一个等于 quote、'\\n' 或 '\\0' 的字符位置，找不到时返回 end
+ */
+const char *findQuoteOrNewline(const char *p, const char *end, char quote);
+
+/**
+ * @brief 估算源码中 Token 数量的上界
+ * @details 把每个字节分为空白、字母、数字、非 ASCII 和其他五类，统计可能开始一个 Token 的位置：\n
+ * 每个其他类字节、每段字母数字序列的开头、数字后紧跟字母的位置（如 12ab 会被分析成两个 Token），
+ * 以及每段非 ASCII 字节序列的开头（连续的无法识别字节只产生一个错误 Token）。\n
+ * 每个 Token 至少占用一个这样的位置，因此结果加上 TOKEN_EOF 后一定不小于实际 Token 数量。\n
+ * 字符串和注释内部的单词同样会被计入，所以结果是上界而不是精确值。
+ * @param data 源代码
+ * @param length 源代码的字节数
+ * @return Token 数量的上界，包括末尾的 TOKEN_EOF
+ */
+size_t estimateTokenCount(const char *data, size_t length);
+
+/**
+ * @brief 查找需要 HTML 转义的字符
+ * @details 查找 '<'、'>'、'&'、'"' 中最先出现的一个，在支持 SSE2 的平台上每次比较 16 个字节。
+ * @param data 待查找的数据
+ * @param length 数据的字节数
+ * @return 第一个需要转义的字符的下标，找不到时返回 length
+ */
+size_t findHtmlSpecial(const char *data, size_t length);
+
+/**
+ * @brief 计算一段数据的 64 位哈希值
+ * @details 每次处理 8 个字节，用于字符串驻留、内容去重等，不适合用于安全用途。
+ * @param data 数据
+ * @param length 数据的字节数
+ * @return 哈希值
+ */
+uint64_t hashBytes(const void *data, size_t length);
+
+/**
+ * @brief 各类源码行的数量
+ */
+typedef struct {
+	size_t code;    ///< 含有 Token 的行
+	size_t comment; ///< 只含有注释的行
+	size_t blank;   ///< 空行或只含有空白的行
+} LineCounts;
+
+/**
+ * @brief 统计源码中代码行、注释行和空行的数量
+ * @details 每行按第一个非空白字符分类：没有则为空行，是 // 则为注释行，否则为代码行。
+ * Token 不会跨行，因此行首的 // 一定是注释，不需要进行词法分析。\n
+ * 在支持 SSE2 的平台上每次处理 16 个字节，行首以外的位置只需要查找换行符。
+ * @param data 源代码
+ * @param length 源代码的字节数
+ * @return 各类行的数量，最后一行没有换行符时同样计入
+ */
+LineCounts countLines(const char *data, size_t length);
@@ -0,0 +1,674 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "arena.h"
+#include "json.h"
+#include "lsp.h"
+#include "rope.h"
+#include "scanner.h"
+
+/**
+ * @brief 每批扫描的 Token 数量
+ */
+#define LSP_BATCH 1024
+
+/**
+ * @brief 输出整数数组时的格式化缓冲区大小
+ */
+#define NUMBER_CHUNK 65536
+
+/**
+ * @brief 语义 Token 的类型，编号即在 legend.tokenTypes 中的下标
+ */
+typedef enum {
+	SEMANTIC_KEYWORD,  ///< 关键字
+	SEMANTIC_VARIABLE, ///< 标识符
+	SEMANTIC_NUMBER,   ///< 数字
+	SEMANTIC_STRING,   ///< 字符串和字符
+	SEMANTIC_OPERATOR, ///< 运算符
+	SEMANTIC_NONE,     ///< 括号、分号等标点，以及错误，不输出
+} SemanticType;
+
+/**
+ * @brief 语义 Token 类型的名称，在 initialize 的结果中告知客户端
+ */
+static const char *const semanticNames[] = {"keyword", "variable", "number", "string", "operator"};
+
+/**
+ * @brief 一个打开的文档
+ */
+typedef struct {
+	char *uri;              ///< 文档的 URI
+	char *text;             ///< 文档内容，以空字符结尾
+	size_t length;          ///< 文档的字节数
+	size_t capacity;        ///< text 的容量
+	uint32_t *lineStarts;   ///< 每行的起始字节偏移
+	size_t lineCount;       ///< 行数，至少为 1
+	size_t lineCapacity;    ///< lineStarts 的容量
+	TokenRope tokens;       ///< 语义 Token，位置以字节为单位，type 为 SemanticType
+	size_t sentCount;       ///< 上一次发送结果时的 Token 数量
+	bool dirty;             ///< 上一次发送结果之后是否有修改
+	size_t dirtyFrom;       ///< 修改过的第一个 Token
+	size_t dirtyTo;         ///< 修改过的最后一个 Token 之后，之后的 Token 除紧随其后的一个外都与上一次发送时相同
+	unsigned long resultId; ///< 上一次发送的结果编号，0 表示还没有发送过
+	bool ascii;             ///< 文档是否只含有 ASCII 字符，是则 UTF-16 位置与字节偏移相同
+} Document;
+
+/**
+ * @brief 服务器状态
+ */
+typedef struct {
+	Document **documents;    ///< 打开的文档
+	size_t documentCount;    ///< 文档数量
+	size_t documentCapacity; ///< documents 的容量
+	RopeToken *scratch;      ///< 重新分析或编码时的临时 Token
+	size_t scratchCapacity;  ///< scratch 的容量
+	bool utf8;               ///< 位置是否以 UTF-8 字节为单位，否则以 UTF-16 码元为单位
+	bool shutdown;           ///< 是否已经收到 shutdown 请求
+	Arena arena;             ///< 解析每条消息使用的 Arena，处理完后重置
+	FILE *out;               ///< 输出
+} Server;
+
+/**
+ * @brief 保证数组至少能容纳 needed 个元素，失败时打印错误信息并退出程序
+ */
+static void reserve(void **items, size_t *capacity, size_t needed, size_t size) {
+	if (needed <= *capacity) {
+		return;
+	}
+	size_t grown = *capacity < 16 ? 16 : *capacity * 2;
+	while (grown < needed) {
+		grown *= 2;
+	}
+	*items = realloc(*items, grown * size);
+	if (*items == NULL) {
+		fprintf(stderr, "内存不足，语言服务器无法继续.\n");
+		exit(1);
+	}
+	*capacity = grown;
+}
+
+/**
+ * @brief 取得 Token 类型对应的语义类型
+ */
+static SemanticType semanticType(TokenType type) {
+	if (type >= TOKEN_SIGNED && type <= TOKEN_TYPEDEF) {
+		return SEMANTIC_KEYWORD;
+	}
+	if (type >= TOKEN_PLUS && type <= TOKEN_GREATER_GREATER) {
+		return SEMANTIC_OPERATOR;
+	}
+	switch (type) {
+		case TOKEN_TILDE: return SEMANTIC_OPERATOR;
+		case TOKEN_IDENTIFIER: return SEMANTIC_VARIABLE;
+		case TOKEN_NUMBER: return SEMANTIC_NUMBER;
+		case TOKEN_STRING:
+		case TOKEN_CHARACTER: return SEMANTIC_STRING;
+		default: return SEMANTIC_NONE;
+	}
+}
+
+/**
+ * @brief 分析文档中 first 到 last 行（包含）的语义 Token，写入 server->scratch
+ * @details 从 first 行的行首开始扫描，遇到超过 last 行的 Token 时停止
+ * @return Token 数量
+ */
+static size_t scanLines(Server *server, const Document *document, size_t first, size_t last) {
+	size_t count = 0;
+	Token tokens[LSP_BATCH];
+	initScannerWithFeatures(document->text + document->lineStarts[first], SCAN_LINES | SCAN_COLUMNS | SCAN_KEYWORDS);
+	for (bool done = false; !done;) {
+		size_t scanned = scanTokens(tokens, LSP_BATCH);
+		reserve((void **)&server->scratch, &server->scratchCapacity, count + scanned, sizeof(RopeToken));
+		for (size_t i = 0; i < scanned && !done; i++) {
+			size_t line = first + (size_t)tokens[i].line - 1;
+			if (tokens[i].type == TOKEN_EOF || line > last) {
+				done = true;
+				continue;
+			}
+			SemanticType type = semanticType(tokens[i].type);
+			if (type != SEMANTIC_NONE) {
+				uint32_t column = (uint32_t)tokens[i].column - 1;
+				server->scratch[count++] = (RopeToken){(uint64_t)document->lineStarts[line] + column, (uint32_t)line,
+				                                       column, (uint32_t)tokens[i].length, (uint32_t)type};
+			}
+		}
+	}
+	return count;
+}
+
+/**
+ * @brief 判断文本是否只含有 ASCII 字符
+ */
+static bool isAscii(const char *text, size_t length) {
+	for (size_t i = 0; i < length; i++) {
+		if ((unsigned char)text[i] >= 0x80) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief 查找字节偏移所在的行
+ */
+static size_t lineOf(const Document *document, size_t offset) {
+	size_t low = 0, high = document->lineCount;
+	while (high - low > 1) {
+		size_t middle = (low + high) / 2;
+		if (document->lineStarts[middle] <= offset) {
+			low = middle;
+		} else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+/**
+ * @brief 记录被修改的 Token 范围，与之前未发送的修改合并为一个连续的范围
+ * @param document 文档
+ * @param from 被替换的第一个 Token
+ * @param to 被替换的最后一个 Token 之后（替换前的下标）
+ * @param count 新的 Token 数量
+ */
+static void markDirty(Document *document, size_t from, size_t to, size_t count) {
+	if (!document->dirty) {
+		document->dirty = true;
+		document->dirtyFrom = from;
+		document->dirtyTo = from + count;
+		return;
+	}
+	// 先把之前的范围映射到这次修改之后的下标，再与这次修改的范围合并
+	size_t dirtyFrom = document->dirtyFrom, dirtyTo = document->dirtyTo;
+	dirtyFrom = dirtyFrom <= from ? dirtyFrom : dirtyFrom >= to ? dirtyFrom - (to - from) + count : from;
+	dirtyTo = dirtyTo <= from ? dirtyTo : dirtyTo >= to ? dirtyTo - (to - from) + count : from + count;
+	document->dirtyFrom = dirtyFrom < from ? dirtyFrom : from;
+	document->dirtyTo = dirtyTo > from + count ? dirtyTo : from + count;
+}
+
+/**
+ * @brief 用新内容替换文档的全部内容，并重新分析整个文档
+ */
+static void setText(Server *server, Document *document, const char *text, size_t length) {
+	reserve((void **)&document->text, &document->capacity, length + 1, 1);
+	memcpy(document->text, text, length);
+	document->text[length] = '\0';
+	document->length = length;
+	document->ascii = isAscii(text, length);
+	document->lineCount = 0;
+	reserve((void **)&document->lineStarts, &document->lineCapacity, 1, sizeof(uint32_t));
+	document->lineStarts[document->lineCount++] = 0;
+	for (const char *p = text; (p = memchr(p, '\n', (size_t)(text + length - p))) != NULL; p++) {
+		reserve((void **)&document->lineStarts, &document->lineCapacity, document->lineCount + 1, sizeof(uint32_t));
+		document->lineStarts[document->lineCount++] = (uint32_t)(p - text + 1);
+	}
+	size_t count = scanLines(server, document, 0, document->lineCount - 1);
+	size_t old = ropeTokenCount(&document->tokens);
+	ropeReplace(&document->tokens, 0, old, server->scratch, count, 0, 0);
+	markDirty(document, 0, old, count);
+}
+
+/**
+ * @brief 把字节范围 [start, end) 替换为新文本，只重新分析受影响的行
+ * @details Token 不会跨行，被修改的行之外的 Token 保持不变，之后的 Token 由 Token 树在 O(log n) 时间内整体平移
+ */
+static void replaceRange(Server *server, Document *document, size_t start, size_t end, const char *text,
+                         size_t length) {
+	size_t firstLine = lineOf(document, start), lastLine = lineOf(document, end);
+	size_t removed = end - start;
+
+	// 修改文本
+	reserve((void **)&document->text, &document->capacity, document->length - removed + length + 1, 1);
+	memmove(document->text + start + length, document->text + end, document->length - end + 1);
+	memcpy(document->text + start, text, length);
+	document->length = document->length - removed + length;
+	document->ascii = document->ascii && isAscii(text, length);
+
+	// 修改行首表：删除被替换范围内的换行，插入新文本中的换行，之后的行首整体平移
+	size_t added = 0;
+	for (const char *p = text; (p = memchr(p, '\n', (size_t)(text + length - p))) != NULL; p++) {
+		added++;
+	}
+	size_t oldLines = lastLine - firstLine, tail = document->lineCount - lastLine - 1;
+	reserve((void **)&document->lineStarts, &document->lineCapacity, document->lineCount - oldLines + added,
+	        sizeof(uint32_t));
+	uint32_t *starts = document->lineStarts;
+	memmove(starts + firstLine + 1 + added, starts + lastLine + 1, tail * sizeof(uint32_t));
+	for (size_t i = firstLine + 1 + added; i < firstLine + 1 + added + tail; i++) {
+		starts[i] = (uint32_t)(starts[i] - removed + length);
+	}
+	size_t line = firstLine + 1;
+	for (const char *p = text; (p = memchr(p, '\n', (size_t)(text + length - p))) != NULL; p++) {
+		starts[line++] = (uint32_t)(start + (size_t)(p - text) + 1);
+	}
+	document->lineCount = document->lineCount - oldLines + added;
+
+	// 重新分析被修改的行，替换原来这些行上的 Token，之后的 Token 调整行号
+	size_t newLast = firstLine + added;
+	size_t count = scanLines(server, document, firstLine, newLast);
+	size_t from = ropeFindLine(&document->tokens, (uint32_t)firstLine);
+	size_t to = ropeFindLine(&document->tokens, (uint32_t)lastLine + 1);
+	ropeReplace(&document->tokens, from, to, server->scratch, count, (int64_t)length - (int64_t)removed,
+	            (int64_t)added - (int64_t)oldLines);
+	markDirty(document, from, to, count);
+}
+
+/**
+ * @brief 把协议中的位置换算为字节偏移
+ * @details 超出行尾的位置截断到行尾，超出文档的行截断到文档末尾
+ */
+static size_t offsetOf(const Server *server, const Document *document, const JsonValue *position) {
+	const JsonValue *lineValue = jsonMember(position, "line"), *characterValue = jsonMember(position, "character");
+	double lineNumber = lineValue != NULL ? lineValue->number : 0, character = characterValue != NULL ? characterValue->number : 0;
+	if (lineNumber < 0 || character < 0) {
+		return 0;
+	}
+	if ((size_t)lineNumber >= document->lineCount) {
+		return document->length;
+	}
+	size_t line = (size_t)lineNumber;
+	size_t offset = document->lineStarts[line];
+	size_t lineEnd = line + 1 < document->lineCount ? document->lineStarts[line + 1] - 1 : document->length;
+	if (server->utf8 || document->ascii) {
+		return offset + (size_t)character < lineEnd ? offset + (size_t)character : lineEnd;
+	}
+	// 按 UTF-16 码元计数，四字节的 UTF-8 序列对应两个码元
+	for (size_t units = 0; offset < lineEnd && units < (size_t)character;) {
+		unsigned char lead = (unsigned char)document->text[offset];
+		size_t size = lead < 0x80 ? 1 : lead < 0xe0 ? 2 : lead < 0xf0 ? 3 : 4;
+		units += size == 4 ? 2 : 1;
+		offset += size;
+	}
+	return offset < lineEnd ? offset : lineEnd;
+}
+
+/**
+ * @brief 计算一段 UTF-8 文本的 UTF-16 码元数量
+ */
+static uint32_t utf16Length(const char *text, size_t length) {
+	uint32_t units = 0;
+	for (size_t i = 0; i < length; i++) {
+		unsigned char c = (unsigned char)text[i];
+		if ((c & 0xc0) != 0x80) {
+			units += c >= 0xf0 ? 2 : 1;
+		}
+	}
+	return units;
+}
+
+/**
+ * @brief 把文档中一段语义 Token 编码为协议规定的相对位置整数数组
+ * @details 每个 Token 5 个整数：与上一个 Token 的行差、列差（换行后为列号）、长度、类型和修饰符。\n
+ * 文档只含 ASCII 或协商为 UTF-8 时直接使用字节偏移，否则按 UTF-16 换算，同一行内沿 Token 顺序累加，每行只遍历一次
+ * @param from 第一个 Token，其相对位置按前一个 Token 计算
+ * @param to 最后一个 Token 之后
+ * @return 整数数组，共 (to - from) * 5 个，由调用者释放
+ */
+static uint32_t *encodeTokens(Server *server, const Document *document, size_t from, size_t to) {
+	uint32_t *data = malloc((to - from) * 5 * sizeof(uint32_t) + 1);
+	if (data == NULL) {
+		fprintf(stderr, "内存不足，语言服务器无法继续.\n");
+		exit(1);
+	}
+	bool bytes = server->utf8 || document->ascii;
+	uint32_t previousLine = 0, previousColumn = 0;
+	uint32_t walkedLine = UINT32_MAX, walkedBytes = 0, walkedUnits = 0; // 当前行已经换算过的字节数和对应的码元数
+	reserve((void **)&server->scratch, &server->scratchCapacity, LSP_BATCH, sizeof(RopeToken));
+	// 从前一个 Token 开始读取，以计算第一个 Token 的相对位置
+	for (size_t index = from > 0 ? from - 1 : from; index < to;) {
+		size_t wanted = to - index < LSP_BATCH ? to - index : LSP_BATCH;
+		size_t read = ropeRead(&document->tokens, index, server->scratch, wanted);
+		for (size_t i = 0; i < read; i++, index++) {
+			const RopeToken *token = &server->scratch[i];
+			uint32_t column = token->column, length = token->length;
+			if (!bytes) {
+				const char *lineText = document->text + document->lineStarts[token->line];
+				if (token->line != walkedLine) {
+					walkedLine = token->line;
+					walkedBytes = walkedUnits = 0;
+				}
+				walkedUnits += utf16Length(lineText + walkedBytes, column - walkedBytes);
+				walkedBytes = column;
+				column = walkedUnits;
+				length = utf16Length(lineText + token->column, token->length);
+			}
+			if (index >= from) {
+				uint32_t *entry = &data[(index - from) * 5];
+				entry[0] = token->line - previousLine;
+				entry[1] = token->line == previousLine ? column - previousColumn : column;
+				entry[2] = length;
+				entry[3] = token->type;
+				entry[4] = 0;
+			}
+			previousLine = token->line;
+			previousColumn = column;
+		}
+		if (read < wanted) {
+			break;
+		}
+	}
+	return data;
+}
+
+/**
+ * @brief 输出整数数组，用局部缓冲区格式化后整块写出
+ */
+static void printNumbers(FILE *out, const uint32_t *numbers, size_t count) {
+	char chunk[NUMBER_CHUNK];
+	size_t used = 0;
+	fputc('[', out);
+	for (size_t i = 0; i < count; i++) {
+		if (used > NUMBER_CHUNK - 16) {
+			fwrite(chunk, 1, used, out);
+			used = 0;
+		}
+		if (i > 0) {
+			chunk[used++] = ',';
+		}
+		char digits[10];
+		int n = 0;
+		uint32_t value = numbers[i];
+		do {
+			digits[n++] = (char)('0' + value % 10);
+			value /= 10;
+		} while (value != 0);
+		while (n > 0) {
+			chunk[used++] = digits[--n];
+		}
+	}
+	fwrite(chunk, 1, used, out);
+	fputc(']', out);
+}
+
+/**
+ * @brief 查找打开的文档
+ * @return 文档在 documents 中的下标，没有打开时返回 documentCount
+ */
+static size_t findDocument(const Server *server, const JsonValue *params) {
+	const JsonValue *uri = jsonMember(jsonMember(params, "textDocument"), "uri");
+	for (size_t i = 0; uri != NULL && uri->type == JSON_STRING && i < server->documentCount; i++) {
+		if (strcmp(server->documents[i]->uri, uri->text) == 0) {
+			return i;
+		}
+	}
+	return server->documentCount;
+}
+
+/**
+ * @brief 关闭文档，释放其内存
+ */
+static void closeDocument(Server *server, size_t index) {
+	Document *document = server->documents[index];
+	free(document->uri);
+	free(document->text);
+	free(document->lineStarts);
+	freeTokenRope(&document->tokens);
+	free(document);
+	server->documents[index] = server->documents[--server->documentCount];
+}
+
+/**
+ * @brief 处理 textDocument/didOpen，已经打开的文档会被替换
+ */
+static void openDocument(Server *server, const JsonValue *params) {
+	const JsonValue *item = jsonMember(params, "textDocument");
+	const JsonValue *uri = jsonMember(item, "uri"), *text = jsonMember(item, "text");
+	if (uri == NULL || uri->type != JSON_STRING || text == NULL || text->type != JSON_STRING) {
+		return;
+	}
+	size_t index = findDocument(server, params);
+	if (index < server->documentCount) {
+		closeDocument(server, index);
+	}
+	Document *document = calloc(1, sizeof(Document));
+	reserve((void **)&server->documents, &server->documentCapacity, server->documentCount + 1, sizeof(Document *));
+	server->documents[server->documentCount++] = document;
+	document->uri = strdup(uri->text);
+	initTokenRope(&document->tokens);
+	setText(server, document, text->text, text->length);
+}
+
+/**
+ * @brief 处理 textDocument/didChange，按顺序应用每一处修改
+ */
+static void changeDocument(Server *server, const JsonValue *params) {
+	size_t index = findDocument(server, params);
+	const JsonValue *changes = jsonMember(params, "contentChanges");
+	if (index == server->documentCount || changes == NULL || changes->type != JSON_ARRAY) {
+		return;
+	}
+	Document *document = server->documents[index];
+	for (const JsonValue *change = changes->first; change != NULL; change = change->next) {
+		const JsonValue *text = jsonMember(change, "text"), *range = jsonMember(change, "range");
+		if (text == NULL || text->type != JSON_STRING) {
+			continue;
+		}
+		if (range == NULL) {
+			setText(server, document, text->text, text->length);
+			continue;
+		}
+		size_t start = offsetOf(server, document, jsonMember(range, "start"));
+		size_t end = offsetOf(server, document, jsonMember(range, "end"));
+		if (end < start) {
+			size_t swap = start;
+			start = end;
+			end = swap;
+		}
+		replaceRange(server, document, start, end, text->text, text->length);
+	}
+}
+
+/**
+ * @brief 开始一条响应消息，写入到内存中，由 sendMessage 加上头部后发送
+ */
+static FILE *beginResponse(const JsonValue *id, char **body, size_t *length) {
+	FILE *out = open_memstream(body, length);
+	fputs("{\"jsonrpc\":\"2.0\",\"id\":", out);
+	if (id == NULL) {
+		fputs("null", out);
+	} else if (id->type == JSON_STRING) {
+		printJsonString(out, id->text, id->length);
+	} else {
+		fwrite(id->text, 1, id->length, out);
+	}
+	return out;
+}
+
+/**
+ * @brief 结束响应消息并发送
+ */
+static void sendMessage(Server *server, FILE *message, char **body, size_t *length) {
+	fputc('}', message);
+	fclose(message);
+	fprintf(server->out, "Content-Length: %zu\r\n\r\n", *length);
+	fwrite(*body, 1, *length, server->out);
+	fflush(server->out);
+	free(*body);
+}
+
+/**
+ * @brief 发送错误响应
+ */
+static void sendError(Server *server, const JsonValue *id, int code, const char *message) {
+	char *body;
+	size_t length;
+	FILE *out = beginResponse(id, &body, &length);
+	fprintf(out, ",\"error\":{\"code\":%d,\"message\":", code);
+	printJsonString(out, message, strlen(message));
+	fputc('}', out);
+	sendMessage(server, out, &body, &length);
+}
+
+/**
+ * @brief 处理 initialize，客户端支持时使用 UTF-8 位置，省去 UTF-16 换算
+ */
+static void initialize(Server *server, const JsonValue *id, const JsonValue *params) {
+	const JsonValue *encodings = jsonMember(jsonMember(jsonMember(params, "capabilities"), "general"), "positionEncodings");
+	server->utf8 = false;
+	for (const JsonValue *item = encodings != NULL ? encodings->first : NULL; item != NULL; item = item->next) {
+		if (item->type == JSON_STRING && strcmp(item->text, "utf-8") == 0) {
+			server->utf8 = true;
+		}
+	}
+	char *body;
+	size_t length;
+	FILE *out = beginResponse(id, &body, &length);
+	fprintf(out, ",\"result\":{\"capabilities\":{\"positionEncoding\":\"%s\",", server->utf8 ? "utf-8" : "utf-16");
+	fputs("\"textDocumentSync\":{\"openClose\":true,\"change\":2},", out);
+	fputs("\"semanticTokensProvider\":{\"legend\":{\"tokenTypes\":[", out);
+	for (size_t i = 0; i < sizeof(semanticNames) / sizeof(semanticNames[0]); i++) {
+		fprintf(out, "%s\"%s\"", i > 0 ? "," : "", semanticNames[i]);
+	}
+	fputs("],\"tokenModifiers\":[]},\"full\":{\"delta\":true}}},\"serverInfo\":{\"name\":\"lexer\"}}", out);
+	sendMessage(server, out, &body, &length);
+}
+
+/**
+ * @brief 处理 semanticTokens/full 和 semanticTokens/full/delta
+ * @details 请求 delta 且 previousResultId 与上一次发送的结果一致时，只编码上一次发送之后修改过的 Token 范围，
+ * 再加上紧随其后的一个 Token（其相对位置可能改变），作为一处修改发送，代价与文档大小无关；否则发送完整结果
+ */
+static void semanticTokens(Server *server, const JsonValue *id, const JsonValue *params, bool delta) {
+	size_t index = findDocument(server, params);
+	char *body;
+	size_t length;
+	FILE *out = beginResponse(id, &body, &length);
+	if (index == server->documentCount) {
+		fputs(",\"result\":null", out);
+		sendMessage(server, out, &body, &length);
+		return;
+	}
+	Document *document = server->documents[index];
+	size_t count = ropeTokenCount(&document->tokens);
+	const JsonValue *previous = jsonMember(params, "previousResultId");
+	char previousId[32];
+	snprintf(previousId, sizeof(previousId), "%lu", document->resultId);
+	if (delta && document->resultId != 0 && previous != NULL && previous->type == JSON_STRING &&
+	    strcmp(previous->text, previousId) == 0) {
+		fprintf(out, ",\"result\":{\"resultId\":\"%lu\",\"edits\":[", document->resultId + 1);
+		if (document->dirty) {
+			size_t from = document->dirtyFrom, to = document->dirtyTo;
+			size_t oldTo = to + document->sentCount - count;
+			if (to < count) {
+				to++;
+				oldTo++;
+			}
+			uint32_t *data = encodeTokens(server, document, from, to);
+			fprintf(out, "{\"start\":%zu,\"deleteCount\":%zu,\"data\":", from * 5, (oldTo - from) * 5);
+			printNumbers(out, data, (to - from) * 5);
+			fputc('}', out);
+			free(data);
+		}
+		fputs("]}", out);
+	} else {
+		uint32_t *data = encodeTokens(server, document, 0, count);
+		fprintf(out, ",\"result\":{\"resultId\":\"%lu\",\"data\":", document->resultId + 1);
+		printNumbers(out, data, count * 5);
+		fputc('}', out);
+		free(data);
+	}
+	sendMessage(server, out, &body, &length);
+	document->sentCount = count;
+	document->dirty = false;
+	document->resultId++;
+}
+
+/**
+ * @brief 读取一条消息
+ * @details 头部以空行结束，只使用 Content-Length，其余头部忽略
+ * @param length 输出参数，返回消息体的字节数
+ * @return 消息体，由调用者释放；输入结束或格式错误时返回 NULL
+ */
+static char *readMessage(FILE *in, size_t *length) {
+	char header[256];
+	long contentLength = -1;
+	for (;;) {
+		if (fgets(header, sizeof(header), in) == NULL) {
+			return NULL;
+		}
+		if (strcmp(header, "\r\n") == 0 || strcmp(header, "\n") == 0) {
+			break;
+		}
+		if (strncasecmp(header, "Content-Length:", 15) == 0) {
+			contentLength = atol(header + 15);
+		}
+	}
+	if (contentLength < 0) {
+		return NULL;
+	}
+	char *body = malloc((size_t)contentLength + 1);
+	if (body == NULL || fread(body, 1, (size_t)contentLength, in) != (size_t)contentLength) {
+		free(body);
+		return NULL;
+	}
+	body[contentLength] = '\0';
+	*length = (size_t)contentLength;
+	return body;
+}
+
+int runLanguageServer(FILE *in, FILE *out) {
+	Server server;
+	memset(&server, 0, sizeof(server));
+	server.out = out;
+	initArena(&server.arena, (size_t)1 << 16);
+	int status = 1;
+	for (;;) {
+		size_t length;
+		char *body = readMessage(in, &length);
+		if (body == NULL) {
+			break;
+		}
+		resetArena(&server.arena);
+		const JsonValue *message = parseJson(body, length, &server.arena);
+		if (message == NULL) {
+			sendError(&server, NULL, -32700, "Parse error");
+			free(body);
+			continue;
+		}
+		const JsonValue *method = jsonMember(message, "method"), *id = jsonMember(message, "id");
+		const JsonValue *params = jsonMember(message, "params");
+		const char *name = method != NULL && method->type == JSON_STRING ? method->text : "";
+		if (strcmp(name, "exit") == 0) {
+			status = server.shutdown ? 0 : 1;
+			free(body);
+			break;
+		} else if (strcmp(name, "initialize") == 0) {
+			initialize(&server, id, params);
+		} else if (strcmp(name, "shutdown") == 0) {
+			server.shutdown = true;
+			char *response;
+			size_t responseLength;
+			FILE *stream = beginResponse(id, &response, &responseLength);
+			fputs(",\"result\":null", stream);
+			sendMessage(&server, stream, &response, &responseLength);
+		} else if (strcmp(name, "textDocument/didOpen") == 0) {
+			openDocument(&server, params);
+		} else if (strcmp(name, "textDocument/didChange") == 0) {
+			changeDocument(&server, params);
+		} else if (strcmp(name, "textDocument/didClose") == 0) {
+			size_t index = findDocument(&server, params);
+			if (index < server.documentCount) {
+				closeDocument(&server, index);
+			}
+		} else if (strcmp(name, "textDocument/semanticTokens/full") == 0) {
+			semanticTokens(&server, id, params, false);
+		} else if (strcmp(name, "textDocument/semanticTokens/full/delta") == 0) {
+			semanticTokens(&server, id, params, true);
+		} else if (id != NULL) {
+			// 不支持的请求必须回复错误，不支持的通知直接忽略
+			sendError(&server, id, -32601, "Method not found");
+		}
+		free(body);
+	}
+	while (server.documentCount > 0) {
+		closeDocument(&server, 0);
+	}
+	free(server.documents);
+	free(server.scratch);
+	freeArena(&server.arena);
+	return status;
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <stdio.h>
+
+/**
+ * @brief 运行语义高亮语言服务器
+ * @details 通过 in 和 out 使用 Language Server Protocol 的 JSON-RPC 消息通信，每条消息以 Content-Length 头部开始。\n
+ * 支持 initialize、shutdown、exit、textDocument/didOpen、didChange（增量同步）、didClose，
+ * 以及 textDocument/semanticTokens/full 和 textDocument/semanticTokens/full/delta。\n
+ * 打开的文档保存在内存中，修改时只重新分析被修改的行，Token 不会跨行，因此结果与重新分析整个文档相同。
+ * @param in 输入，通常为标准输入
+ * @param out 输出，通常为标准输出
+ * @return 收到 shutdown 后再收到 exit 时返回 0，否则返回 1
+ */
+int runLanguageServer(FILE *in, FILE *out);
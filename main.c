@@ -1,8 +1,34 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
+#include "archive.h"
+#include "arena.h"
+#include "batch.h"
+#include "bench.h"
+#include "chunk.h"
+#include "clone.h"
+#include "decompress.h"
+#include "diff.h"
+#include "export.h"
+#include "files.h"
+#include "grep.h"
+#include "highlight.h"
+#include "index.h"
+#include "kernels.h"
+#include "lsp.h"
+#include "minify.h"
+#include "parallel.h"
+#include "rewrite.h"
 #include "scanner.h"
+#include "shard.h"
+#include "tar.h"
 #include "tools.h"
+#include "topk.h"
+#include "tree.h"
+#include "validate.h"
+#include "watch.h"
 
 /**
  * @brief 运行词法分析器并打印 Token 分析结果。
@@ -49,45 +75,555 @@ static void repl() {
 }
 
 /**
- * @brief 从文件读取内容到内存。
- * @param path 文件路径。
- * @return 动态分配的字符串，包含文件的全部字符信息。
- * @note 使用者负责释放返回的内存。
+ * @brief 运行并分析整个文件的内容。
+ * @param path 要分析的文件路径。
  */
-static char *readFile(const char *path) {
-	FILE *file = fopen(path, "rb");
-	if (file == NULL) {
-		fprintf(stderr, "无法打开文件 \"%s\".\n", path);
-		exit(1);
+static void runFile(const char *path) {
+	size_t length;
+	char *source = readFile(path, &length); // 读取文件内容
+	if (looksBinary(source, length)) {
+		// 二进制文件没有词法分析的意义，直接跳过，避免输出大量错误 Token
+		fprintf(stderr, "跳过二进制文件 \"%s\".\n", path);
+	} else {
+		run(source); // 调用 run 函数处理源文件生成的字符串
 	}
+	releaseFile(source, length); // 及时归还缓冲区，下一个文件复用
+}
 
-	fseek(file, 0, SEEK_END); // 获取文件大小
-	size_t size = ftell(file);
-	rewind(file); // 重置文件指针
-	char *buffer = malloc(size + 1);
-	if (buffer == NULL) {
-		fprintf(stderr, "内存不足，无法读取文件 \"%s\".\n", path);
-		exit(1);
+/**
+ * @brief 依次分析多个文件的内容。
+ * @details 多于一个文件时，在每个文件的输出前打印文件路径。
+ * @param count 文件数量。
+ * @param paths 文件路径数组。
+ */
+static void runFiles(int count, const char *paths[]) {
+	for (int i = 0; i < count; i++) {
+		if (count > 1) {
+			printf("==> %s <==\n", paths[i]);
+		}
+		runFile(paths[i]);
 	}
+}
 
-	size_t bytesRead = fread(buffer, sizeof(char), size, file); // 读取文件内容
-	if (bytesRead < size) {
-		fprintf(stderr, "无法读取文件 \"%s\" 的全部内容.\n", path);
-		exit(1);
+/**
+ * @brief 用 Token 和 Trivia 表还原源码，检查结果与源码逐字节相同。
+ * @param path 文件路径，用于报告错误。
+ * @param source 源代码。
+ * @param length 源代码的字节数。
+ * @return 还原结果与源码相同返回 true，否则返回 false。
+ */
+static bool roundtripSource(const char *path, const char *source, size_t length) {
+	TokenBuffer buffer;
+	initTokenBuffer(&buffer);
+	scanAll(source, length, SCAN_KEYWORDS | SCAN_TRIVIA, &buffer);
+	char *out = acquireBuffer(length + 1, NULL);
+	size_t written = reconstructSource(&buffer, scannerTrivia(), source, out);
+	size_t expected = strnlen(source, length); // 扫描器在空字符处结束
+	size_t same = 0;
+	while (same < written && same < expected && out[same] == source[same]) {
+		same++;
 	}
-	buffer[size] = '\0';
-	fclose(file);
-	return buffer;
+	bool ok = same == expected && written == expected;
+	if (!ok) {
+		fprintf(stderr, "%s: 还原结果从第 %zu 字节开始与源码不同\n", path, same);
+	}
+	releaseBuffer(out, length + 1);
+	freeTokenBuffer(&buffer);
+	return ok;
 }
 
 /**
- * @brief 运行并分析整个文件的内容。
- * @param path 要分析的文件路径。
+ * @brief 只校验文件能否通过词法分析，不输出 Token。
+ * @details 每个文件报告第一个词法错误的位置，格式为 "路径:行:列: 错误信息"。\n
+ * 路径前加上 --roundtrip 时，还用 Token 和 Trivia 表无损还原每个文件，检查还原结果与源码完全相同。
+ * @param count 参数数量。
+ * @param args 参数数组。
+ * @return 所有文件都没有词法错误并且还原一致返回 0，否则返回 1。
  */
-static void runFile(const char *path) {
-	char *source = readFile(path); // 读取文件内容
-	run(source);                   // // 调用 run 函数处理源文件生成的字符串
-	free(source);                  // 及时释放资源
+static int checkFiles(int count, const char *args[]) {
+	bool roundtrip = count > 0 && strcmp(args[0], "--roundtrip") == 0;
+	if (roundtrip) {
+		count--;
+		args++;
+	}
+	int status = 0;
+	for (int i = 0; i < count; i++) {
+		size_t length;
+		char *source = readFile(args[i], &length);
+		LexError error;
+		if (looksBinary(source, length)) {
+			fprintf(stderr, "%s: 二进制文件\n", args[i]);
+			status = 1;
+		} else {
+			if (!validateSource(source, length, &error)) {
+				fprintf(stderr, "%s:%d:%d: %s\n", args[i], error.line, error.column, error.message);
+				status = 1;
+			}
+			// 有词法错误的文件也应当能无损还原，错误 Token 覆盖的字节记录在 Trivia 表中
+			if (roundtrip && !roundtripSource(args[i], source, length)) {
+				status = 1;
+			}
+		}
+		releaseFile(source, length);
+	}
+	return status;
+}
+
+/**
+ * @brief 压缩文件内容并输出到标准输出。
+ * @details 删除注释并压缩空白，多个文件的结果依次输出。
+ * @param count 文件数量。
+ * @param paths 文件路径数组。
+ * @return 所有文件都压缩成功返回 0，有文件存在词法错误返回 1。
+ */
+static int minifyFiles(int count, const char *paths[]) {
+	int status = 0;
+	Output out;
+	initOutput(&out, stdout);
+	for (int i = 0; i < count; i++) {
+		size_t length;
+		char *source = readFile(paths[i], &length);
+		LexError error;
+		if (!minifySource(source, length, &out, &error)) {
+			flushOutput(&out);
+			fprintf(stderr, "%s:%d:%d: %s\n", paths[i], error.line, error.column, error.message);
+			status = 1;
+		}
+		releaseFile(source, length);
+	}
+	freeOutput(&out);
+	return status;
+}
+
+/**
+ * @brief 输出语法高亮后的文件内容。
+ * @param format 输出格式的名称，ansi 或 html。
+ * @param count 文件数量。
+ * @param paths 文件路径数组。
+ * @return 成功返回 0，格式名称无法识别时返回 1。
+ */
+static int highlightFiles(const char *format, int count, const char *paths[]) {
+	HighlightFormat highlightFormat;
+	if (strcmp(format, "ansi") == 0) {
+		highlightFormat = HIGHLIGHT_ANSI;
+	} else if (strcmp(format, "html") == 0) {
+		highlightFormat = HIGHLIGHT_HTML;
+	} else {
+		fprintf(stderr, "无法识别的高亮格式 \"%s\"，可选 ansi 或 html.\n", format);
+		return 1;
+	}
+	Output out;
+	initOutput(&out, stdout);
+	for (int i = 0; i < count; i++) {
+		size_t length;
+		char *source = readFile(paths[i], &length);
+		if (looksBinary(source, length)) {
+			fprintf(stderr, "跳过二进制文件 \"%s\".\n", paths[i]);
+		} else {
+			highlightSource(source, length, highlightFormat, &out);
+		}
+		releaseFile(source, length);
+	}
+	freeOutput(&out);
+	return 0;
+}
+
+/**
+ * @brief 并行查找 Token 模式时的共享状态。
+ */
+typedef struct {
+	const TokenPattern *pattern; ///< 编译后的模式
+	const FileList *files;       ///< 要查找的文件
+	char **results;              ///< 每个文件的输出内容
+	size_t *sizes;               ///< 每个文件输出内容的字节数
+	size_t *matches;             ///< 每个文件的匹配数量
+	bool *failed;                ///< 每个文件是否无法读取
+} GrepJob;
+
+/**
+ * @brief 在一个文件中查找 Token 模式，输出先保存在内存中。
+ * @param index 文件编号。
+ * @param worker 工作线程编号。
+ * @param context GrepJob。
+ */
+static void grepTask(size_t index, int worker, void *context) {
+	(void)worker;
+	GrepJob *job = context;
+	const char *path = job->files->paths[index];
+	FILE *out = open_memstream(&job->results[index], &job->sizes[index]);
+	size_t length;
+	char *source = tryReadFile(path, &length);
+	job->failed[index] = source == NULL;
+	if (source != NULL && !looksBinary(source, length)) {
+		job->matches[index] = grepSource(job->pattern, source, length, path, out);
+	}
+	fclose(out);
+	if (source != NULL) {
+		releaseFile(source, length);
+	}
+}
+
+/**
+ * @brief 在多个文件中并行查找 Token 模式。
+ * @details 各文件的结果按文件顺序输出，与线程的执行顺序无关。
+ * @param text 模式字符串。
+ * @param count 路径数量。
+ * @param paths 路径数组，目录会被递归展开。
+ * @return 找到匹配返回 0，没有匹配返回 1，模式有误或有文件无法读取返回 2。
+ */
+static int grepFiles(const char *text, int count, const char *paths[]) {
+	TokenPattern pattern;
+	const char *error;
+	if (!compilePattern(text, &pattern, &error)) {
+		fprintf(stderr, "无效的模式 \"%s\": %s.\n", text, error);
+		return 2;
+	}
+	FileList files;
+	collectFiles(&files, count, paths);
+	size_t fileCount = (size_t)files.count;
+	GrepJob job = {&pattern, &files, calloc(fileCount, sizeof(char *)), calloc(fileCount, sizeof(size_t)),
+	               calloc(fileCount, sizeof(size_t)), calloc(fileCount, sizeof(bool))};
+	parallelFor(fileCount, grepTask, &job);
+	size_t total = 0;
+	bool failed = false;
+	for (size_t i = 0; i < fileCount; i++) {
+		fwrite(job.results[i], 1, job.sizes[i], stdout);
+		free(job.results[i]);
+		total += job.matches[i];
+		failed = failed || job.failed[i]; // 错误信息已由 tryReadFile 输出
+	}
+	free(job.results);
+	free(job.sizes);
+	free(job.matches);
+	free(job.failed);
+	freeFileList(&files);
+	freePattern(&pattern);
+	return failed ? 2 : total > 0 ? 0 : 1;
+}
+
+/**
+ * @brief 在多个文件中检测代码克隆。
+ * @details 路径前可以加上 --raw（不抽象标识符和字面量）、--k 数量（每个指纹的 Token 数）、
+ * --window 数量（winnowing 窗口大小）和 --min 数量（报告所需的最少共同指纹数）。
+ * @param count 参数数量。
+ * @param args 参数数组，目录会被递归展开。
+ * @return 找到克隆返回 0，没有找到返回 1。
+ */
+static int cloneFiles(int count, const char *args[]) {
+	CloneOptions options = {25, 10, 3, true};
+	while (count > 0 && strncmp(args[0], "--", 2) == 0) {
+		if (strcmp(args[0], "--raw") == 0) {
+			options.abstract = false;
+			count--;
+			args++;
+			continue;
+		}
+		if (count < 2) {
+			break;
+		}
+		int value = atoi(args[1]);
+		if (strcmp(args[0], "--k") == 0) {
+			options.gramLength = value;
+		} else if (strcmp(args[0], "--window") == 0) {
+			options.window = value;
+		} else if (strcmp(args[0], "--min") == 0) {
+			options.minShared = value;
+		} else {
+			break;
+		}
+		count -= 2;
+		args += 2;
+	}
+	if (options.gramLength < 1 || options.gramLength > 256 || options.window < 1 || options.window > 256 ||
+	    options.minShared < 1) {
+		fprintf(stderr, "克隆检测的参数超出范围，--k 和 --window 应在 1 到 256 之间.\n");
+		return 2;
+	}
+	FileList files;
+	collectFiles(&files, count, args);
+	size_t reported = detectClones(&files, &options, stdout);
+	freeFileList(&files);
+	return reported > 0 ? 0 : 1;
+}
+
+/**
+ * @brief 按 Token 比较两个文件。
+ * @param pathA 旧文件的路径。
+ * @param pathB 新文件的路径。
+ * @return Token 序列相同返回 0，不同返回 1。
+ */
+static int diffFiles(const char *pathA, const char *pathB) {
+	size_t lengthA, lengthB;
+	char *sourceA = readFile(pathA, &lengthA);
+	char *sourceB = readFile(pathB, &lengthB);
+	size_t hunks = diffSources(pathA, sourceA, lengthA, pathB, sourceB, lengthB, stdout);
+	releaseFile(sourceA, lengthA);
+	releaseFile(sourceB, lengthB);
+	return hunks > 0 ? 1 : 0;
+}
+
+/**
+ * @brief 把文件的 Token 导出为整数编号数组。
+ * @details 路径前可以加上 --vocab 数量（词表的最大长度）和 --min 数量（进入词表所需的最少出现次数）。
+ * @param prefix 输出文件的前缀。
+ * @param count 参数数量。
+ * @param args 参数数组，目录会被递归展开。
+ * @return 成功返回 0，失败返回 1。
+ */
+static int exportFiles(const char *prefix, int count, const char *args[]) {
+	ExportOptions options = {prefix, 32000, 2};
+	while (count > 1 && (strcmp(args[0], "--vocab") == 0 || strcmp(args[0], "--min") == 0)) {
+		long value = atol(args[1]);
+		if (value < 0) {
+			fprintf(stderr, "参数 %s 不能为负数.\n", args[0]);
+			return 1;
+		}
+		if (strcmp(args[0], "--vocab") == 0) {
+			options.vocabularyMax = (uint32_t)value;
+		} else {
+			options.minFrequency = (uint32_t)value;
+		}
+		count -= 2;
+		args += 2;
+	}
+	return exportTokens(&options, count, args);
+}
+
+/**
+ * @brief 统计出现最频繁的标识符和字符串字面量。
+ * @details 路径前可以加上 --counters 数量，指定每个工作线程的计数器数量，越多越精确。
+ * @param limit 输出的元素数量。
+ * @param count 参数数量。
+ * @param args 参数数组，目录会被递归展开。
+ * @return 成功返回 0，参数有误返回 1。
+ */
+static int topFiles(const char *limit, int count, const char *args[]) {
+	long top = atol(limit), counters = 4096;
+	if (count > 1 && strcmp(args[0], "--counters") == 0) {
+		counters = atol(args[1]);
+		count -= 2;
+		args += 2;
+	}
+	if (top < 1 || counters < 1 || counters > 1L << 24) {
+		fprintf(stderr, "输出数量和计数器数量必须是正数，计数器不超过 %ld 个.\n", 1L << 24);
+		return 1;
+	}
+	reportTopTokens((size_t)top, (uint32_t)counters, count, args, stdout);
+	return 0;
+}
+
+/**
+ * @brief 用多个进程分片分析文件，合并为语料归档。
+ * @details 路径前可以加上 --shards 数量，指定分片和子进程的数量，默认等于工作线程数量。
+ * @param archivePath 归档路径。
+ * @param count 参数数量。
+ * @param args 参数数组，目录会被递归展开。
+ * @return 全部文件都成功时返回 0，否则返回 1。
+ */
+static int shardFiles(const char *archivePath, int count, const char *args[]) {
+	int shards = 0;
+	if (count > 1 && strcmp(args[0], "--shards") == 0) {
+		shards = atoi(args[1]);
+		count -= 2;
+		args += 2;
+		if (shards < 1) {
+			fprintf(stderr, "分片数量必须是正数.\n");
+			return 1;
+		}
+	}
+	return shardLex(archivePath, shards, count, args);
+}
+
+/**
+ * @brief 并行分析文件，写入语料归档。
+ * @details 路径前可以加上 --strings，为每个文件同时写入字符串表。
+ * @param archivePath 归档路径。
+ * @param count 参数数量。
+ * @param args 参数数组，目录会被递归展开。
+ * @return 成功返回 0，失败返回 1。
+ */
+static int archiveFiles(const char *archivePath, int count, const char *args[]) {
+	bool strings = count > 0 && strcmp(args[0], "--strings") == 0;
+	if (strings) {
+		count--;
+		args++;
+	}
+	return buildArchive(archivePath, strings, count, args);
+}
+
+/**
+ * @brief 并行统计源码行数时的共享状态。
+ */
+typedef struct {
+	const FileList *files; ///< 要统计的文件
+	LineCounts *counts;    ///< 每个文件的统计结果
+	bool *skipped;         ///< 每个文件是否因无法读取或为二进制文件而跳过
+} LineJob;
+
+/**
+ * @brief 统计一个文件的代码行、注释行和空行。
+ * @param index 文件编号。
+ * @param worker 工作线程编号。
+ * @param context LineJob。
+ */
+static void lineTask(size_t index, int worker, void *context) {
+	(void)worker;
+	LineJob *job = context;
+	size_t length;
+	char *source = tryReadFile(job->files->paths[index], &length);
+	if (source == NULL) {
+		job->skipped[index] = true; // 错误信息已由 tryReadFile 输出
+		return;
+	}
+	job->skipped[index] = looksBinary(source, length);
+	if (!job->skipped[index]) {
+		job->counts[index] = countLines(source, length);
+	}
+	releaseFile(source, length);
+}
+
+/**
+ * @brief 并行统计多个文件的代码行、注释行和空行，输出每个文件的结果和总计。
+ * @param count 路径数量。
+ * @param paths 路径数组，目录会被递归展开。
+ */
+static void countFileLines(int count, const char *paths[]) {
+	FileList files;
+	collectFiles(&files, count, paths);
+	size_t fileCount = (size_t)files.count;
+	LineJob job = {&files, calloc(fileCount + 1, sizeof(LineCounts)), calloc(fileCount + 1, sizeof(bool))};
+	parallelFor(fileCount, lineTask, &job);
+	LineCounts total = {0, 0, 0};
+	size_t reported = 0;
+	// 每个汉字占两列、三个字节，%10s 按字节补齐会错位，表头直接按列宽补齐
+	printf("      代码       注释       空行  文件\n");
+	for (size_t i = 0; i < fileCount; i++) {
+		if (job.skipped[i]) {
+			continue;
+		}
+		reported++;
+		const LineCounts *lines = &job.counts[i];
+		printf("%10zu %10zu %10zu  %s\n", lines->code, lines->comment, lines->blank, files.paths[i]);
+		total.code += lines->code;
+		total.comment += lines->comment;
+		total.blank += lines->blank;
+	}
+	printf("%10zu %10zu %10zu  总计 (%zu 个文件)\n", total.code, total.comment, total.blank, reported);
+	free(job.counts);
+	free(job.skipped);
+	freeFileList(&files);
+}
+
+/**
+ * @brief 判断字符串是否恰好是一个标识符。
+ */
+static bool isIdentifier(const char *text) {
+	initScannerWithFeatures(text, SCAN_KEYWORDS);
+	Token token = scanToken();
+	return token.type == TOKEN_IDENTIFIER && (size_t)token.length == strlen(text);
+}
+
+/**
+ * @brief 在多个文件中按 Token 替换。
+ * @details 路径前可以加上 --dry-run，只报告匹配数量而不修改文件。
+ * @param rename 为 true 时要求查找内容和替换文本都是单个标识符。
+ * @param pattern 要查找的 Token 序列。
+ * @param replacement 替换后的文本。
+ * @param count 参数数量。
+ * @param args 参数数组，目录会被递归展开。
+ * @return 有替换返回 0，没有匹配返回 1，参数有误或写入失败返回 2。
+ */
+static int rewriteTokens(bool rename, const char *pattern, const char *replacement, int count, const char *args[]) {
+	bool dryRun = count > 0 && strcmp(args[0], "--dry-run") == 0;
+	if (dryRun) {
+		count--;
+		args++;
+	}
+	if (rename && (!isIdentifier(pattern) || !isIdentifier(replacement))) {
+		fprintf(stderr, "--rename 的参数必须是标识符.\n");
+		return 2;
+	}
+	RewriteRule rule;
+	const char *error;
+	if (!compileRewriteRule(pattern, replacement, &rule, &error)) {
+		fprintf(stderr, "无效的查找内容 \"%s\": %s.\n", pattern, error);
+		return 2;
+	}
+	int status = rewriteFiles(&rule, count, args, dryRun);
+	freeRewriteRule(&rule);
+	return status;
+}
+
+/**
+ * @brief 分块缓存的 Token 占用内存的上限。
+ */
+#define RELEX_CACHE_BUDGET ((size_t)1 << 30)
+
+/**
+ * @brief 读取单调时钟。
+ * @return 当前时间，单位为秒。
+ */
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief 依次分块词法分析多个文件，文件之间共享块缓存。
+ * @details 用于同一个文件的多个版本：后面的文件只重新扫描与前面的文件内容不同的块。\n
+ * 输出每个文件的 Token 数量、复用的块数、重新扫描的字节数和耗时。
+ * @param count 文件数量。
+ * @param paths 文件路径数组，按给出的顺序分析。
+ */
+static void relexFiles(int count, const char *paths[]) {
+	ChunkCache cache;
+	initChunkCache(&cache, RELEX_CACHE_BUDGET);
+	TokenBuffer buffer;
+	initTokenBuffer(&buffer);
+	for (int i = 0; i < count; i++) {
+		size_t length;
+		char *source = readFile(paths[i], &length);
+		double start = now();
+		ChunkStats stats = lexChunked(&cache, source, length, &buffer);
+		double elapsed = now() - start;
+		printf("%s: %zu 个 Token，复用 %zu/%zu 块，扫描 %zu 字节，耗时 %.3f ms\n", paths[i], buffer.count - 1,
+		       stats.reused, stats.chunks, stats.scannedBytes, elapsed * 1e3);
+		releaseFile(source, length);
+	}
+	freeTokenBuffer(&buffer);
+	freeChunkCache(&cache);
+}
+
+/**
+ * @brief 打印命令行用法。
+ */
+static void usage(void) {
+	fprintf(stderr, "用法：参数 [--huge-pages] [--jobs 线程数] [路径...]\n");
+	fprintf(stderr, "      参数 --check [--roundtrip] 路径...   只校验词法错误，出错时退出码为 1；--roundtrip 同时检查无损还原\n");
+	fprintf(stderr, "      参数 --bench 路径...   测量词法分析的吞吐量和 Token 数量估算的准确度\n");
+	fprintf(stderr, "      参数 --minify 路径...  删除注释并压缩空白后输出源码\n");
+	fprintf(stderr, "      参数 --highlight ansi|html 路径...  输出语法高亮后的源码\n");
+	fprintf(stderr, "      参数 --grep 模式 路径...  按 Token 序列查找，如 'IDENT ( ... ) ;'，目录会被递归展开\n");
+	fprintf(stderr, "      参数 --index 索引文件 路径...  建立或增量更新标识符倒排索引\n");
+	fprintf(stderr, "      参数 --query 索引文件 标识符  从索引中查询标识符的出现位置\n");
+	fprintf(stderr, "      参数 --clones [--raw] [--k 数量] [--window 数量] [--min 数量] 路径...  检测代码克隆\n");
+	fprintf(stderr, "      参数 --diff 旧文件 新文件  按 Token 比较两个文件，忽略空白和注释的变化\n");
+	fprintf(stderr, "      参数 --export 输出前缀 [--vocab 数量] [--min 次数] 路径...  导出 Token 编号数组 (.npy)\n");
+	fprintf(stderr, "      参数 --top 数量 [--counters 数量] 路径...  近似统计最频繁的标识符和字符串字面量\n");
+	fprintf(stderr, "      参数 --lines 路径...  统计每个文件的代码行、注释行和空行\n");
+	fprintf(stderr, "      参数 --rename 旧名 新名 [--dry-run] 路径...  重命名标识符，不影响字符串和注释\n");
+	fprintf(stderr, "      参数 --replace 查找 替换 [--dry-run] 路径...  把 Token 序列替换为指定文本\n");
+	fprintf(stderr, "      参数 --lsp  在标准输入输出上运行语义高亮语言服务器\n");
+	fprintf(stderr, "      参数 --relex 路径...  依次分块分析同一文件的多个版本，复用内容未变的块\n");
+	fprintf(stderr, "      参数 --watch 套接字 目录...  监视目录并增量重新分析，通过套接字查询 stats、files、query 标识符\n");
+	fprintf(stderr, "      参数 --lex-tree 输出目录 路径...  增量分析源码树，只为变化的文件写入二进制 Token 流\n");
+	fprintf(stderr, "      参数 --shard-lex 归档 [--shards 数量] 路径...  多进程分片分析，合并为语料归档\n");
+	fprintf(stderr, "      参数 --archive 归档 [--strings] 路径...  并行分析并写入语料归档，可以附带字符串表\n");
+	fprintf(stderr, "      参数 --archive-list 归档  列出语料归档中的文件\n");
+	fprintf(stderr, "      参数 --archive-cat 归档 路径  输出语料归档中一个文件的 Token\n");
+	fprintf(stderr, "      参数 --lex-tar 归档 tar包|-  直接分析 tar 包中的源文件并写入语料归档，- 表示标准输入\n");
+	fprintf(stderr, "      参数 --lex-compressed 路径...  流式解压 gzip 或 zstd 压缩的源文件并分块分析，- 表示标准输入\n");
 }
 
 /**
@@ -97,20 +633,130 @@ static void runFile(const char *path) {
  * @return 程序退出码。
  * @note 主函数支持操作系统传递命令行参数，并根据参数决定程序行为。\n
  * 如果没有主动传入参数 (argc = 1), 因为第一个参数总会传入一个当前可执行文件的目录作为命令行参数，此时执行 repl 函数。\n
- * 如果传递了一个参数 (argc = 2), 说明传递了一个参数, 将传递的参数视为某个源代码的路径，然后调用 runFile 函数, 传入该源代码文件的路径, 处理源文件。\n
- * 如果传递多个参数 (argc > 2), 说明传递了多个参数, 进行错误处理。
+ * 如果传递了路径参数, 将传递的参数视为源代码的路径，然后调用 runFiles 函数依次处理这些源文件。\n
+ * 所有模式前都可以加上 --huge-pages, 让大缓冲区使用大页，以及 --jobs 线程数, 指定并行模式使用的线程数量。\n
+ * 如果第一个参数是 --check, 则把其余参数视为源代码路径，只校验词法错误并通过退出码报告结果，
+ * 之后再加上 --roundtrip 时还检查由 Token 和 Trivia 表还原的源码与原文件完全相同。\n
+ * 如果第一个参数是 --bench, 则对其余参数指定的源代码文件运行基准测试。\n
+ * 如果第一个参数是 --minify, 则压缩其余参数指定的源代码文件并输出。\n
+ * 如果第一个参数是 --highlight, 则第二个参数为输出格式，输出其余参数指定的源代码文件的语法高亮结果。\n
+ * 如果第一个参数是 --grep, 则第二个参数为 Token 模式，在其余参数指定的文件和目录中并行查找。\n
+ * 如果第一个参数是 --index, 则第二个参数为索引文件，为其余参数指定的文件和目录建立标识符索引。\n
+ * 如果第一个参数是 --query, 则从第二个参数指定的索引文件中查询第三个参数指定的标识符。\n
+ * 如果第一个参数是 --clones, 则在其余参数指定的文件和目录中检测代码克隆。\n
+ * 如果第一个参数是 --diff, 则按 Token 比较第二个和第三个参数指定的文件。\n
+ * 如果第一个参数是 --export, 则第二个参数为输出文件的前缀，把其余参数指定的文件和目录的 Token 导出为编号数组。\n
+ * 如果第一个参数是 --top, 则第二个参数为输出数量，用固定内存统计其余参数指定的文件和目录中最频繁的标识符和字符串字面量。\n
+ * 如果第一个参数是 --lines, 则统计其余参数指定的文件和目录的代码行、注释行和空行。\n
+ * 如果第一个参数是 --rename 或 --replace, 则把第二个参数指定的标识符或 Token 序列替换为第三个参数，改写其余参数指定的文件和目录。\n
+ * 如果第一个参数是 --lsp, 则在标准输入输出上运行语义高亮语言服务器。\n
+ * 如果第一个参数是 --relex, 则按顺序分块分析其余参数指定的文件，文件之间共享块缓存。\n
+ * 如果第一个参数是 --watch, 则监视其余参数指定的目录，在第二个参数指定的套接字上提供最新的分析结果。\n
+ * 如果第一个参数是 --lex-tree, 则第二个参数为输出目录，按清单增量分析其余参数指定的文件和目录。\n
+ * 如果第一个参数是 --shard-lex, 则第二个参数为归档路径，用多个进程分片分析其余参数指定的文件和目录。\n
+ * 如果第一个参数是 --archive, 则第二个参数为归档路径，用多个线程分析其余参数指定的文件和目录并写入归档。\n
+ * 如果第一个参数是 --archive-list 或 --archive-cat, 则列出第二个参数指定的归档中的文件，或输出其中第三个参数指定的文件的 Token。\n
+ * 如果第一个参数是 --lex-tar, 则不解包地分析第三个参数指定的 tar 包中的源文件，写入第二个参数指定的归档。\n
+ * 如果第一个参数是 --lex-compressed, 则一边解压一边分析其余参数指定的压缩文件。\n
+ * 其他以 -- 开头的参数视为参数传递有误, 进行错误处理。
  */
 int main(int argc, const char *argv[]) {
+	// 全局选项可以与任何模式组合，处理后从参数中去掉
+	for (;;) {
+		int used = 0;
+		if (argc > 1 && strcmp(argv[1], "--huge-pages") == 0) {
+			enableHugePages(true);
+			used = 1;
+		} else if (argc > 2 && strcmp(argv[1], "--jobs") == 0) {
+			setWorkerCount(atoi(argv[2]));
+			used = 2;
+		}
+		if (used == 0) {
+			break;
+		}
+		argv[used] = argv[0];
+		argc -= used;
+		argv += used;
+	}
 	if (argc == 1) {
 		// 交互式的输入源代码字符串，然后词法分析
 		repl();
-	} else if (argc == 2) {
-		// 命令行参数输入一个源文件的路径名，然后词法分析此源文件代码
-		runFile(argv[1]);
+	} else if (strcmp(argv[1], "--check") == 0) {
+		// 校验模式：只报告第一个词法错误，不打印 Token
+		return checkFiles(argc - 2, argv + 2);
+	} else if (strcmp(argv[1], "--bench") == 0) {
+		// 基准测试模式
+		runBenchmark(argc - 2, argv + 2);
+	} else if (strcmp(argv[1], "--minify") == 0) {
+		// 压缩模式
+		return minifyFiles(argc - 2, argv + 2);
+	} else if (strcmp(argv[1], "--highlight") == 0 && argc > 2) {
+		// 语法高亮模式
+		return highlightFiles(argv[2], argc - 3, argv + 3);
+	} else if (strcmp(argv[1], "--grep") == 0 && argc > 2) {
+		// Token 模式查找模式
+		return grepFiles(argv[2], argc - 3, argv + 3);
+	} else if (strcmp(argv[1], "--index") == 0 && argc > 2) {
+		// 建立标识符索引
+		return buildIndex(argv[2], argc - 3, argv + 3);
+	} else if (strcmp(argv[1], "--query") == 0 && argc == 4) {
+		// 查询标识符索引，找不到时退出码为 1
+		return queryIndex(argv[2], argv[3], stdout) > 0 ? 0 : 1;
+	} else if (strcmp(argv[1], "--clones") == 0) {
+		// 代码克隆检测
+		return cloneFiles(argc - 2, argv + 2);
+	} else if (strcmp(argv[1], "--diff") == 0 && argc == 4) {
+		// 按 Token 比较两个文件，有差异时退出码为 1
+		return diffFiles(argv[2], argv[3]);
+	} else if (strcmp(argv[1], "--export") == 0 && argc > 2) {
+		// 导出 Token 编号数组
+		return exportFiles(argv[2], argc - 3, argv + 3);
+	} else if (strcmp(argv[1], "--top") == 0 && argc > 2) {
+		// 近似统计最频繁的标识符和字符串字面量
+		return topFiles(argv[2], argc - 3, argv + 3);
+	} else if (strcmp(argv[1], "--lines") == 0) {
+		// 统计代码行、注释行和空行
+		countFileLines(argc - 2, argv + 2);
+	} else if ((strcmp(argv[1], "--rename") == 0 || strcmp(argv[1], "--replace") == 0) && argc > 3) {
+		// 按 Token 替换
+		return rewriteTokens(strcmp(argv[1], "--rename") == 0, argv[2], argv[3], argc - 4, argv + 4);
+	} else if (strcmp(argv[1], "--lsp") == 0 && argc == 2) {
+		// 语义高亮语言服务器
+		return runLanguageServer(stdin, stdout);
+	} else if (strcmp(argv[1], "--relex") == 0) {
+		// 分块词法分析，复用内容未变的块
+		relexFiles(argc - 2, argv + 2);
+	} else if (strcmp(argv[1], "--watch") == 0 && argc > 3) {
+		// 监视目录，增量重新分析
+		return watchTree(argv[2], argc - 3, argv + 3);
+	} else if (strcmp(argv[1], "--lex-tree") == 0 && argc > 2) {
+		// 按清单增量分析源码树
+		return lexTree(argv[2], argc - 3, argv + 3);
+	} else if (strcmp(argv[1], "--shard-lex") == 0 && argc > 2) {
+		// 多进程分片分析
+		return shardFiles(argv[2], argc - 3, argv + 3);
+	} else if (strcmp(argv[1], "--archive") == 0 && argc > 2) {
+		// 多线程写入语料归档
+		return archiveFiles(argv[2], argc - 3, argv + 3);
+	} else if (strcmp(argv[1], "--archive-list") == 0 && argc == 3) {
+		// 列出语料归档中的文件
+		return listArchive(argv[2], stdout);
+	} else if (strcmp(argv[1], "--archive-cat") == 0 && argc == 4) {
+		// 从语料归档中读取一个文件的 Token
+		return catArchive(argv[2], argv[3], stdout);
+	} else if (strcmp(argv[1], "--lex-tar") == 0 && argc == 4) {
+		// 不解包地分析 tar 包
+		return lexTar(argv[2], argv[3]);
+	} else if (strcmp(argv[1], "--lex-compressed") == 0 && argc > 2) {
+		// 流式解压并分析压缩的源文件
+		return lexCompressed(argc - 2, argv + 2);
+	} else if (strncmp(argv[1], "--", 2) != 0) {
+		// 命令行参数输入源文件的路径名，然后依次词法分析这些源文件代码
+		runFiles(argc - 1, argv + 1);
 	} else {
-		// 如果主动传入超过一个命令行参数. 即参数传递有误, 错误处理
+		// 如果传入了无法识别的选项. 即参数传递有误, 错误处理
 		// 告诉用户正确的使用函数的方式
-		fprintf(stderr, "用法：参数 [路径]\n");
+		usage();
 		exit(1);
 	}
 	return 0;
@@ -0,0 +1,107 @@
+#include <string.h>
+
+#include "minify.h"
+#include "scanner.h"
+
+/**
+ * @brief 每批扫描的 Token 数量
+ */
+#define MINIFY_BATCH 1024
+
+/**
+ * @brief 判断字符是否为字母、数字或下划线
+ * @param c 待判断的字符
+ * @return 如果 c 是字母、数字或下划线，返回 true，否则返回 false
+ */
+static bool isWordChar(char c) {
+	return (c >= 'a' && c <= 'z') ||
+			(c >= 'A' && c <= 'Z') ||
+			(c >= '0' && c <= '9') ||
+			c == '_';
+}
+
+/**
+ * @brief 判断两个字符拼接后是否会构成一个双字符运算符或注释的开头
+ * @param first 前一个字符
+ * @param second 后一个字符
+ * @return 会构成时返回 true，否则返回 false
+ */
+static bool formsOperator(char first, char second) {
+	static const char *const pairs[] = {
+		"++", "+=", "--", "-=", "->", "*=", "/=", "//", "%=", "&=", "&&",
+		"|=", "||", "^=", "==", "!=", "<=", "<<", ">=", ">>",
+	};
+	for (size_t i = 0; i < sizeof(pairs) / sizeof(pairs[0]); i++) {
+		if (pairs[i][0] == first && pairs[i][1] == second) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief 判断两个 Token 之间是否需要保留一个空格
+ * @param before prev 之前的 Token，输出中与 prev 之间没有空白时才提供，否则为 NULL
+ * @param prev 前一个 Token
+ * @param next 后一个 Token
+ * @return 直接拼接会改变分析结果时返回 true，否则返回 false
+ */
+static bool needsSpace(const Token *before, const Token *prev, const Token *next) {
+	char last = prev->start[prev->length - 1];
+	char first = next->start[0];
+	if (isWordChar(last) && isWordChar(first)) {
+		return true; // 标识符、关键字、数字之间
+	}
+	if (prev->type == TOKEN_NUMBER && first == '.') {
+		return true; // 1 .5 拼接成 1.5 会变成一个数字
+	}
+	if (prev->type == TOKEN_DOT && first >= '0' && first <= '9' && before != NULL && before->type == TOKEN_NUMBER &&
+	    memchr(before->start, '.', (size_t)before->length) == NULL) {
+		return true; // 1. 5 拼接成 1.5 同样会变成一个数字
+	}
+	return formsOperator(last, first);
+}
+
+bool minifySource(const char *source, size_t length, Output *out, LexError *error) {
+	// 先用只校验模式确认没有词法错误，错误 Token 不指向源码，无法原样输出
+	if (!validateSource(source, length, error)) {
+		return false;
+	}
+	// 不需要行号和关键字，使用最快的特化版本；Token 分批扫描到一个小数组中，不需要为整个文件分配 Token 数组
+	initScannerWithFeatures(source, 0);
+	Token tokens[MINIFY_BATCH];
+	Token prev = {0};
+	Token before = {0};
+	bool beforeAdjacent = false; // 输出中 before 与 prev 之间是否没有空白
+	const char *blockStart = NULL; // 当前连续块的起始位置
+	const char *blockEnd = NULL;   // 当前连续块的结束位置
+	for (;;) {
+		size_t count = scanTokens(tokens, MINIFY_BATCH);
+		for (size_t i = 0; i < count; i++) {
+			const Token *token = &tokens[i];
+			if (token->type == TOKEN_EOF) {
+				if (blockStart != NULL) {
+					writeOutput(out, blockStart, (size_t)(blockEnd - blockStart));
+					writeChar(out, '\n');
+				}
+				return true;
+			}
+			bool adjacent = true;
+			if (blockStart == NULL) {
+				blockStart = token->start;
+			} else if (token->start != blockEnd) {
+				// 两个 Token 之间有空白或注释，写出之前连续的一整块
+				writeOutput(out, blockStart, (size_t)(blockEnd - blockStart));
+				if (needsSpace(beforeAdjacent ? &before : NULL, &prev, token)) {
+					writeChar(out, ' ');
+					adjacent = false;
+				}
+				blockStart = token->start;
+			}
+			blockEnd = token->start + token->length;
+			before = prev;
+			beforeAdjacent = adjacent && before.start != NULL;
+			prev = *token;
+		}
+	}
+}
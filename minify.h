@@ -0,0 +1,19 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "output.h"
+#include "validate.h"
+
+/**
+ * @brief 压缩源码
+ * @details 删除所有注释，把 Token 之间的空白压缩到最少：只有两个相邻 Token 直接拼接后会被分析成不同的 Token 时
+ * （如标识符后接标识符、+ 后接 +）才保留一个空格。\n
+ * 源码中本来就相邻的 Token 合并成一整块，直接从源码复制到输出。
+ * @param source 源代码，必须以空字符结尾
+ * @param length 源代码的字节数
+ * @param out 输出缓冲区
+ * @param error 输出参数，源码有词法错误时写入第一个错误的位置，可以为 NULL
+ * @return 成功返回 true；源码有词法错误时不输出任何内容并返回 false
+ */
+bool minifySource(const char *source, size_t length, Output *out, LexError *error);
@@ -0,0 +1,47 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "output.h"
+
+/**
+ * @brief 输出缓冲区的大小
+ */
+#define OUTPUT_BUFFER_SIZE ((size_t)1 << 18)
+
+void initOutput(Output *out, FILE *file) {
+	out->file = file;
+	out->data = acquireBuffer(OUTPUT_BUFFER_SIZE, &out->capacity);
+	out->length = 0;
+}
+
+void flushOutput(Output *out) {
+	if (out->length > 0) {
+		fwrite(out->data, 1, out->length, out->file);
+		out->length = 0;
+	}
+}
+
+void freeOutput(Output *out) {
+	flushOutput(out);
+	fflush(out->file);
+	releaseBuffer(out->data, out->capacity);
+	out->data = NULL;
+	out->capacity = 0;
+}
+
+void writeOutput(Output *out, const char *data, size_t length) {
+	if (length > out->capacity - out->length) {
+		flushOutput(out);
+		if (length >= out->capacity) {
+			fwrite(data, 1, length, out->file); // 大块数据直接写出，不再复制到缓冲区
+			return;
+		}
+	}
+	memcpy(out->data + out->length, data, length);
+	out->length += length;
+}
+
+void writeString(Output *out, const char *text) {
+	writeOutput(out, text, strlen(text));
+}
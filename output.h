@@ -0,0 +1,61 @@
+#pragma once
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * @brief 输出缓冲区
+ * @details 把大量小块输出先拼接到大缓冲区中再整体写出，减少系统调用次数。\n
+ * 超过缓冲区大小的单块数据直接写出，不经过缓冲区复制。
+ */
+typedef struct {
+	FILE *file;      ///< 输出目标
+	char *data;      ///< 缓冲区
+	size_t length;   ///< 缓冲区中待写出的字节数
+	size_t capacity; ///< 缓冲区的容量
+} Output;
+
+/**
+ * @brief 初始化输出缓冲区
+ * @param out 输出缓冲区
+ * @param file 输出目标
+ */
+void initOutput(Output *out, FILE *file);
+
+/**
+ * @brief 把缓冲区中的数据全部写出
+ * @param out 输出缓冲区
+ */
+void flushOutput(Output *out);
+
+/**
+ * @brief 写出缓冲区中剩余的数据并释放缓冲区
+ * @param out 输出缓冲区
+ */
+void freeOutput(Output *out);
+
+/**
+ * @brief 追加一段数据
+ * @param out 输出缓冲区
+ * @param data 数据
+ * @param length 数据的字节数
+ */
+void writeOutput(Output *out, const char *data, size_t length);
+
+/**
+ * @brief 追加一个以空字符结尾的字符串
+ * @param out 输出缓冲区
+ * @param text 字符串
+ */
+void writeString(Output *out, const char *text);
+
+/**
+ * @brief 追加一个字符
+ * @param out 输出缓冲区
+ * @param c 字符
+ */
+static inline void writeChar(Output *out, char c) {
+	if (out->length == out->capacity) {
+		flushOutput(out);
+	}
+	out->data[out->length++] = c;
+}
@@ -0,0 +1,91 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "parallel.h"
+
+/**
+ * @brief 一次 parallelFor 调用的共享状态
+ */
+typedef struct {
+	atomic_size_t next; ///< 下一个待领取的任务编号
+	size_t count;       ///< 任务数量
+	ParallelTask task;  ///< 任务函数
+	void *context;      ///< 任务上下文
+} Job;
+
+/**
+ * @brief 工作线程的参数
+ */
+typedef struct {
+	Job *job;   ///< 共享状态
+	int worker; ///< 工作线程编号
+} WorkerArgs;
+
+static int workers = 0;
+
+void setWorkerCount(int count) {
+	workers = count;
+}
+
+int workerCount(void) {
+	if (workers < 1) {
+		long online = sysconf(_SC_NPROCESSORS_ONLN);
+		workers = online > 0 ? (int)online : 1;
+	}
+	return workers;
+}
+
+/**
+ * @brief 工作线程的主循环
+ * @param arg WorkerArgs
+ * @return NULL
+ */
+static void *workerMain(void *arg) {
+	WorkerArgs *args = arg;
+	Job *job = args->job;
+	for (;;) {
+		size_t index = atomic_fetch_add(&job->next, 1);
+		if (index >= job->count) {
+			return NULL;
+		}
+		job->task(index, args->worker, job->context);
+	}
+}
+
+void parallelFor(size_t count, ParallelTask task, void *context) {
+	Job job;
+	atomic_init(&job.next, 0);
+	job.count = count;
+	job.task = task;
+	job.context = context;
+	int threads = workerCount();
+	if ((size_t)threads > count) {
+		threads = count > 0 ? (int)count : 1;
+	}
+	pthread_t *ids = malloc((size_t)threads * sizeof(pthread_t));
+	WorkerArgs *args = malloc((size_t)threads * sizeof(WorkerArgs));
+	if (ids == NULL || args == NULL) {
+		fprintf(stderr, "内存不足，无法启动工作线程.\n");
+		exit(1);
+	}
+	// 当前线程作为 0 号工作线程参与执行，只有多于一个线程时才创建新线程
+	for (int i = 1; i < threads; i++) {
+		args[i].job = &job;
+		args[i].worker = i;
+		if (pthread_create(&ids[i], NULL, workerMain, &args[i]) != 0) {
+			fprintf(stderr, "无法创建工作线程.\n");
+			exit(1);
+		}
+	}
+	args[0].job = &job;
+	args[0].worker = 0;
+	workerMain(&args[0]);
+	for (int i = 1; i < threads; i++) {
+		pthread_join(ids[i], NULL);
+	}
+	free(ids);
+	free(args);
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <stddef.h>
+
+/**
+ * @brief 并行任务函数
+ * @param index 任务编号，从 0 到任务数量减 1
+ * @param worker 执行该任务的工作线程编号，从 0 到 workerCount() 减 1
+ * @param context 调用 parallelFor 时传入的上下文
+ */
+typedef void (*ParallelTask)(size_t index, int worker, void *context);
+
+/**
+ * @brief 设置工作线程的数量
+ * @param count 工作线程数量，小于 1 时使用处理器核心数
+ */
+void setWorkerCount(int count);
+
+/**
+ * @brief 取得工作线程的数量
+ * @return 工作线程数量，默认等于处理器核心数
+ */
+int workerCount(void);
+
+/**
+ * @brief 并行执行一组任务
+ * @details 启动 workerCount() 个线程，每个线程不断领取下一个未执行的任务编号，直到全部任务执行完毕才返回。\n
+ * 任务按编号动态分配，文件大小不均时也能保持各线程负载均衡。
+ * @param count 任务数量
+ * @param task 任务函数
+ * @param context 传给任务函数的上下文
+ */
+void parallelFor(size_t count, ParallelTask task, void *context);
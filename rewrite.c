@@ -0,0 +1,281 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "batch.h"
+#include "files.h"
+#include "kernels.h"
+#include "parallel.h"
+#include "rewrite.h"
+#include "tools.h"
+#include "validate.h"
+
+/**
+ * @brief 一次 writev 最多写出的片段数量
+ */
+#ifdef IOV_MAX
+#define REWRITE_IOV IOV_MAX
+#else
+#define REWRITE_IOV 1024
+#endif
+
+/**
+ * @brief 一组输出片段
+ */
+typedef struct {
+	struct iovec *items; ///< 片段数组，指向源码缓冲区或替换文本
+	size_t count;        ///< 片段数量
+	size_t capacity;     ///< 数组的容量
+} Pieces;
+
+/**
+ * @brief 单个文件的处理结果
+ */
+typedef enum {
+	REWRITE_DONE,       ///< 已处理，替换数量见 replaced
+	REWRITE_SKIPPED,    ///< 二进制文件，跳过
+	REWRITE_UNREADABLE, ///< 无法读取，跳过
+	REWRITE_LEX_ERROR,  ///< 存在词法错误，Token 可能落在字符串内部，不改写
+	REWRITE_FAILED,     ///< 写入失败
+} RewriteStatus;
+
+/**
+ * @brief 并行替换时的共享状态
+ */
+typedef struct {
+	const RewriteRule *rule; ///< 替换规则
+	const FileList *files;   ///< 文件列表
+	size_t *replaced;        ///< 每个文件的替换数量
+	RewriteStatus *status;   ///< 每个文件的处理结果
+	LexError *errors;        ///< 存在词法错误的文件的第一个错误
+	bool dryRun;             ///< 是否只统计不修改
+} RewriteJob;
+
+bool compileRewriteRule(const char *pattern, const char *replacement, RewriteRule *rule, const char **error) {
+	rule->count = 0;
+	rule->text = strdup(pattern);
+	rule->replacement = replacement;
+	rule->replacementLength = strlen(replacement);
+	initScannerWithFeatures(rule->text, SCAN_KEYWORDS);
+	for (;;) {
+		Token token = scanToken();
+		if (token.type == TOKEN_EOF) {
+			break;
+		}
+		if (token.type == TOKEN_ERROR) {
+			*error = "查找内容中存在词法错误";
+			freeRewriteRule(rule);
+			return false;
+		}
+		if (rule->count == REWRITE_MAX_TOKENS) {
+			*error = "查找内容过长";
+			freeRewriteRule(rule);
+			return false;
+		}
+		rule->tokens[rule->count++] = token;
+	}
+	if (rule->count == 0) {
+		*error = "查找内容为空";
+		freeRewriteRule(rule);
+		return false;
+	}
+	return true;
+}
+
+void freeRewriteRule(RewriteRule *rule) {
+	free(rule->text);
+	rule->text = NULL;
+	rule->count = 0;
+}
+
+/**
+ * @brief 判断两个 Token 的类型和字符序列是否相同
+ */
+static bool sameToken(const Token *a, const Token *b) {
+	return a->type == b->type && a->length == b->length && memcmp(a->start, b->start, (size_t)a->length) == 0;
+}
+
+/**
+ * @brief 追加一个输出片段，空片段被忽略
+ */
+static void addPiece(Pieces *pieces, const char *data, size_t length) {
+	if (length == 0) {
+		return;
+	}
+	if (pieces->count == pieces->capacity) {
+		pieces->capacity = pieces->capacity < 64 ? 64 : pieces->capacity * 2;
+		pieces->items = realloc(pieces->items, pieces->capacity * sizeof(struct iovec));
+		if (pieces->items == NULL) {
+			fprintf(stderr, "内存不足，无法替换.\n");
+			exit(1);
+		}
+	}
+	pieces->items[pieces->count++] = (struct iovec){(void *)data, length};
+}
+
+/**
+ * @brief 用 writev 写出全部片段，处理部分写入的情况
+ * @return 全部写出返回 true，否则返回 false
+ */
+static bool writePieces(int fd, Pieces *pieces) {
+	struct iovec *items = pieces->items;
+	size_t remaining = pieces->count;
+	while (remaining > 0) {
+		int batch = remaining < REWRITE_IOV ? (int)remaining : REWRITE_IOV;
+		ssize_t written = writev(fd, items, batch);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		// 跳过已经完整写出的片段，部分写出的片段调整起点
+		size_t done = (size_t)written;
+		while (remaining > 0 && done >= items->iov_len) {
+			done -= items->iov_len;
+			items++;
+			remaining--;
+		}
+		if (remaining > 0) {
+			items->iov_base = (char *)items->iov_base + done;
+			items->iov_len -= done;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief 把片段写入临时文件，再重命名覆盖原文件
+ * @return 成功返回 true，否则返回 false
+ */
+static bool replaceFile(const char *path, Pieces *pieces) {
+	struct stat info;
+	if (stat(path, &info) != 0) {
+		return false;
+	}
+	// 临时文件与原文件在同一目录，rename 才是原子的；mkstemp 保证不覆盖已有文件，并发运行也互不干扰
+	size_t tmpLength = strlen(path) + 8;
+	char *tmpPath = malloc(tmpLength);
+	if (tmpPath == NULL) {
+		return false;
+	}
+	snprintf(tmpPath, tmpLength, "%s.XXXXXX", path);
+	int fd = mkstemp(tmpPath);
+	bool ok = fd >= 0;
+	if (ok) {
+		ok = writePieces(fd, pieces) && fchmod(fd, info.st_mode & 07777) == 0;
+		ok = close(fd) == 0 && ok;
+		ok = ok && rename(tmpPath, path) == 0;
+		if (!ok) {
+			unlink(tmpPath);
+		}
+	}
+	free(tmpPath);
+	return ok;
+}
+
+/**
+ * @brief 在一个文件中替换
+ * @param index 文件编号
+ * @param worker 工作线程编号
+ * @param context RewriteJob
+ */
+static void rewriteTask(size_t index, int worker, void *context) {
+	(void)worker;
+	RewriteJob *job = context;
+	const RewriteRule *rule = job->rule;
+	const char *path = job->files->paths[index];
+	size_t length;
+	char *source = tryReadFile(path, &length);
+	if (source == NULL) {
+		job->status[index] = REWRITE_UNREADABLE;
+		return;
+	}
+	if (looksBinary(source, length)) {
+		job->status[index] = REWRITE_SKIPPED;
+		releaseFile(source, length);
+		return;
+	}
+	// 词法分析器不支持转义，有词法错误时字符串可能被拆成标识符，匹配会改写字符串内部的文本
+	if (!validateSource(source, length, &job->errors[index])) {
+		job->status[index] = REWRITE_LEX_ERROR;
+		releaseFile(source, length);
+		return;
+	}
+	TokenBuffer buffer;
+	initTokenBuffer(&buffer);
+	scanAll(source, length, SCAN_KEYWORDS, &buffer);
+	Pieces pieces = {NULL, 0, 0};
+	const char *copied = source; // 之前的源码已经加入片段
+	size_t replaced = 0;
+	size_t last = buffer.count - 1; // 不含 TOKEN_EOF
+	for (size_t i = 0; i + (size_t)rule->count <= last;) {
+		int matched = 0;
+		while (matched < rule->count && sameToken(&buffer.tokens[i + (size_t)matched], &rule->tokens[matched])) {
+			matched++;
+		}
+		if (matched < rule->count) {
+			i++;
+			continue;
+		}
+		const Token *first = &buffer.tokens[i], *end = &buffer.tokens[i + (size_t)rule->count - 1];
+		addPiece(&pieces, copied, (size_t)(first->start - copied));
+		addPiece(&pieces, rule->replacement, rule->replacementLength);
+		copied = end->start + end->length;
+		replaced++;
+		i += (size_t)rule->count;
+	}
+	freeTokenBuffer(&buffer);
+	if (replaced > 0 && !job->dryRun) {
+		addPiece(&pieces, copied, (size_t)(source + length - copied));
+		job->status[index] = replaceFile(path, &pieces) ? REWRITE_DONE : REWRITE_FAILED;
+	}
+	job->replaced[index] = replaced;
+	free(pieces.items);
+	releaseFile(source, length);
+}
+
+int rewriteFiles(const RewriteRule *rule, int count, const char *paths[], bool dryRun) {
+	FileList files;
+	collectFiles(&files, count, paths);
+	size_t fileCount = (size_t)files.count;
+	RewriteJob job = {rule, &files, NULL, NULL, NULL, dryRun};
+	job.replaced = calloc(fileCount + 1, sizeof(size_t));
+	job.status = calloc(fileCount + 1, sizeof(RewriteStatus));
+	job.errors = calloc(fileCount + 1, sizeof(LexError));
+	if (job.replaced == NULL || job.status == NULL || job.errors == NULL) {
+		fprintf(stderr, "内存不足，无法替换.\n");
+		exit(1);
+	}
+	parallelFor(fileCount, rewriteTask, &job);
+	size_t total = 0, changed = 0;
+	bool failed = false;
+	for (size_t i = 0; i < fileCount; i++) {
+		const LexError *error = &job.errors[i];
+		if (job.status[i] == REWRITE_UNREADABLE) {
+			failed = true; // 错误信息已由 tryReadFile 输出
+		} else if (job.status[i] == REWRITE_LEX_ERROR) {
+			fprintf(stderr, "%s:%d:%d: %s\n", files.paths[i], error->line, error->column, error->message);
+			failed = true;
+		} else if (job.status[i] == REWRITE_FAILED) {
+			fprintf(stderr, "无法写入文件 \"%s\".\n", files.paths[i]);
+			failed = true;
+		} else if (job.replaced[i] > 0) {
+			printf("%s: %zu 处\n", files.paths[i], job.replaced[i]);
+			total += job.replaced[i];
+			changed++;
+		}
+	}
+	fprintf(stderr, "%s %zu 个文件中的 %zu 处.\n", dryRun ? "找到" : "已替换", changed, total);
+	free(job.replaced);
+	free(job.status);
+	free(job.errors);
+	freeFileList(&files);
+	return failed ? 2 : total > 0 ? 0 : 1;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "scanner.h"
+
+/**
+ * @brief 替换规则最多包含的 Token 数量
+ */
+#define REWRITE_MAX_TOKENS 64
+
+/**
+ * @brief 按 Token 替换的规则
+ * @details 源码中与 tokens 的类型和字符序列依次相同的 Token 序列被替换为 replacement，
+ * 字符串、注释以及更长的标识符中的相同文本不会被替换
+ */
+typedef struct {
+	Token tokens[REWRITE_MAX_TOKENS]; ///< 要查找的 Token 序列，start 指向 text
+	int count;                        ///< Token 数量
+	char *text;                       ///< 查找内容的副本
+	const char *replacement;          ///< 替换后的文本，原样写入
+	size_t replacementLength;         ///< 替换文本的长度
+} RewriteRule;
+
+/**
+ * @brief 编译替换规则
+ * @param pattern 要查找的 Token 序列，如 "oldName" 或 "malloc ( sizeof"
+ * @param replacement 替换后的文本
+ * @param rule 输出的规则，由调用者调用 freeRewriteRule 释放
+ * @param error 输出参数，编译失败时指向错误信息
+ * @return 编译成功返回 true，否则返回 false
+ * @note 会使用当前线程的词法分析器，调用后之前的扫描状态失效
+ */
+bool compileRewriteRule(const char *pattern, const char *replacement, RewriteRule *rule, const char **error);
+
+/**
+ * @brief 释放替换规则
+ * @param rule 替换规则
+ */
+void freeRewriteRule(RewriteRule *rule);
+
+/**
+ * @brief 在多个文件中按 Token 替换
+ * @details 各文件并行处理。每个文件扫描一次，找出不重叠的匹配后，输出由源码中未改变的片段和替换文本交替组成，
+ * 用 writev 直接从读入的缓冲区写出，不再复制源码。\n
+ * 输出先写入同目录下的临时文件，保留原文件的权限，成功后再重命名覆盖原文件；没有匹配的文件不会被改写。\n
+ * 存在词法错误的文件报告第一个错误的位置后跳过，不会被改写；无法读取的文件和二进制文件同样跳过。
+ * @param rule 替换规则
+ * @param count 路径数量
+ * @param paths 路径数组，目录会被递归展开
+ * @param dryRun 为 true 时只报告匹配数量，不修改文件
+ * @return 有匹配且全部写入成功返回 0，没有匹配返回 1，有文件无法读取、存在词法错误或写入失败返回 2
+ */
+int rewriteFiles(const RewriteRule *rule, int count, const char *paths[], bool dryRun);
@@ -0,0 +1,390 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rope.h"
+
+/**
+ * @brief 每个节点最多保存的 Token 数量
+ */
+#define ROPE_RUN 64
+
+/**
+ * @brief 节点中保存的 Token，位置相对于前一个 Token
+ */
+typedef struct {
+	uint32_t gap;    ///< 与前一个 Token 结尾之间的字节数，第一个 Token 为其起始偏移
+	uint32_t lines;  ///< 与前一个 Token 之间的行差，第一个 Token 为其行号
+	uint32_t column; ///< 在行内的字节偏移
+	uint32_t length; ///< 字节数
+	uint32_t type;   ///< 类型
+} RopeEntry;
+
+struct RopeNode {
+	RopeNode *left;          ///< 左子树，位于本节点之前的 Token
+	RopeNode *right;         ///< 右子树，位于本节点之后的 Token
+	uint32_t priority;       ///< Treap 的堆优先级，父节点不小于子节点
+	uint32_t count;          ///< 本节点的 Token 数量
+	size_t tokens;           ///< 子树的 Token 数量
+	uint64_t bytes;          ///< 子树的 gap + length 之和，即子树最后一个 Token 相对子树之前的结尾偏移
+	uint64_t lines;          ///< 子树的行差之和
+	RopeEntry run[ROPE_RUN]; ///< 本节点的 Token
+};
+
+/**
+ * @brief 生成下一个随机优先级
+ */
+static uint32_t nextPriority(TokenRope *rope) {
+	uint32_t x = rope->seed;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	rope->seed = x;
+	return x;
+}
+
+/**
+ * @brief 根据子节点重新计算节点的汇总值
+ */
+static void update(RopeNode *node) {
+	node->tokens = node->count;
+	node->bytes = 0;
+	node->lines = 0;
+	for (uint32_t i = 0; i < node->count; i++) {
+		node->bytes += (uint64_t)node->run[i].gap + node->run[i].length;
+		node->lines += node->run[i].lines;
+	}
+	if (node->left != NULL) {
+		node->tokens += node->left->tokens;
+		node->bytes += node->left->bytes;
+		node->lines += node->left->lines;
+	}
+	if (node->right != NULL) {
+		node->tokens += node->right->tokens;
+		node->bytes += node->right->bytes;
+		node->lines += node->right->lines;
+	}
+}
+
+/**
+ * @brief 创建一个保存若干 Token 的节点
+ */
+static RopeNode *newNode(TokenRope *rope, const RopeEntry *entries, uint32_t count, uint32_t priority) {
+	RopeNode *node = malloc(sizeof(RopeNode));
+	if (node == NULL) {
+		fprintf(stderr, "内存不足，无法保存 Token.\n");
+		exit(1);
+	}
+	node->left = node->right = NULL;
+	node->priority = priority;
+	node->count = count;
+	memcpy(node->run, entries, count * sizeof(RopeEntry));
+	update(node);
+	rope->nodeCount++;
+	return node;
+}
+
+/**
+ * @brief 释放子树
+ */
+static void freeTree(TokenRope *rope, RopeNode *node) {
+	while (node != NULL) {
+		freeTree(rope, node->left);
+		RopeNode *right = node->right;
+		free(node);
+		rope->nodeCount--;
+		node = right;
+	}
+}
+
+/**
+ * @brief 把子树分成前 k 个 Token 和其余部分
+ * @details k 落在某个节点的 Token 段中间时，把该段拆成两个节点，后一半沿用原节点的优先级以保持堆性质
+ */
+static void split(TokenRope *rope, RopeNode *node, size_t k, RopeNode **left, RopeNode **right) {
+	if (node == NULL) {
+		*left = *right = NULL;
+		return;
+	}
+	size_t before = node->left != NULL ? node->left->tokens : 0;
+	if (k <= before) {
+		split(rope, node->left, k, left, &node->left);
+		update(node);
+		*right = node;
+	} else if (k >= before + node->count) {
+		split(rope, node->right, k - before - node->count, &node->right, right);
+		update(node);
+		*left = node;
+	} else {
+		uint32_t cut = (uint32_t)(k - before);
+		RopeNode *tail = newNode(rope, node->run + cut, node->count - cut, node->priority);
+		tail->right = node->right;
+		update(tail);
+		node->count = cut;
+		node->right = NULL;
+		update(node);
+		*left = node;
+		*right = tail;
+	}
+}
+
+/**
+ * @brief 连接两棵子树，a 的 Token 全部位于 b 之前
+ */
+static RopeNode *join(RopeNode *a, RopeNode *b) {
+	if (a == NULL) {
+		return b;
+	}
+	if (b == NULL) {
+		return a;
+	}
+	if (a->priority >= b->priority) {
+		a->right = join(a->right, b);
+		update(a);
+		return a;
+	}
+	b->left = join(a, b->left);
+	update(b);
+	return b;
+}
+
+/**
+ * @brief 自底向上计算子树的汇总值
+ */
+static void updateTree(RopeNode *node) {
+	if (node != NULL) {
+		updateTree(node->left);
+		updateTree(node->right);
+		update(node);
+	}
+}
+
+/**
+ * @brief 用一组相对位置的 Token 建立子树
+ * @details 每 ROPE_RUN 个 Token 一个节点，按顺序用栈构造笛卡尔树，时间为 O(n)
+ */
+static RopeNode *buildTree(TokenRope *rope, const RopeEntry *entries, size_t count) {
+	size_t depth = 0, capacity = 64;
+	RopeNode **stack = malloc(capacity * sizeof(RopeNode *));
+	for (size_t i = 0; i < count; i += ROPE_RUN) {
+		uint32_t size = count - i < ROPE_RUN ? (uint32_t)(count - i) : ROPE_RUN;
+		RopeNode *node = newNode(rope, entries + i, size, nextPriority(rope));
+		RopeNode *last = NULL;
+		while (depth > 0 && stack[depth - 1]->priority < node->priority) {
+			last = stack[--depth];
+		}
+		node->left = last;
+		if (depth > 0) {
+			stack[depth - 1]->right = node;
+		}
+		if (depth == capacity) {
+			capacity *= 2;
+			stack = realloc(stack, capacity * sizeof(RopeNode *));
+		}
+		stack[depth++] = node;
+	}
+	RopeNode *root = depth > 0 ? stack[0] : NULL;
+	free(stack);
+	updateTree(root);
+	return root;
+}
+
+/**
+ * @brief 把绝对位置的 Token 转换为相对位置
+ * @param tokens 绝对位置的 Token
+ * @param count Token 数量
+ * @param end 前一个 Token 的结尾偏移
+ * @param line 前一个 Token 所在的行
+ * @param out 输出的相对位置 Token
+ */
+static void toEntries(const RopeToken *tokens, size_t count, uint64_t end, uint64_t line, RopeEntry *out) {
+	for (size_t i = 0; i < count; i++) {
+		out[i] = (RopeEntry){(uint32_t)(tokens[i].offset - end), (uint32_t)(tokens[i].line - line), tokens[i].column,
+		                     tokens[i].length, tokens[i].type};
+		end = tokens[i].offset + tokens[i].length;
+		line = tokens[i].line;
+	}
+}
+
+void initTokenRope(TokenRope *rope) {
+	rope->root = NULL;
+	rope->nodeCount = 0;
+	rope->seed = 0x9e3779b9u;
+}
+
+void freeTokenRope(TokenRope *rope) {
+	freeTree(rope, rope->root);
+	rope->root = NULL;
+}
+
+size_t ropeTokenCount(const TokenRope *rope) {
+	return rope->root != NULL ? rope->root->tokens : 0;
+}
+
+size_t ropeFindLine(const TokenRope *rope, uint32_t line) {
+	size_t index = 0;
+	uint64_t current = 0; // 已经经过的 Token 中最后一个所在的行
+	const RopeNode *node = rope->root;
+	while (node != NULL) {
+		if (node->left != NULL && current + node->left->lines >= line) {
+			node = node->left;
+			continue;
+		}
+		if (node->left != NULL) {
+			current += node->left->lines;
+			index += node->left->tokens;
+		}
+		for (uint32_t i = 0; i < node->count; i++) {
+			current += node->run[i].lines;
+			if (current >= line) {
+				return index;
+			}
+			index++;
+		}
+		node = node->right;
+	}
+	return index;
+}
+
+/**
+ * @brief 累加前 index 个 Token 的相对位置
+ * @param end 输出参数，第 index - 1 个 Token 的结尾偏移
+ * @param line 输出参数，第 index - 1 个 Token 所在的行
+ */
+static void prefix(const TokenRope *rope, size_t index, uint64_t *end, uint64_t *line) {
+	*end = 0;
+	*line = 0;
+	const RopeNode *node = rope->root;
+	while (node != NULL && index > 0) {
+		size_t before = node->left != NULL ? node->left->tokens : 0;
+		if (index <= before) {
+			node = node->left;
+			continue;
+		}
+		if (node->left != NULL) {
+			*end += node->left->bytes;
+			*line += node->left->lines;
+		}
+		index -= before;
+		uint32_t take = index < node->count ? (uint32_t)index : node->count;
+		for (uint32_t i = 0; i < take; i++) {
+			*end += (uint64_t)node->run[i].gap + node->run[i].length;
+			*line += node->run[i].lines;
+		}
+		index -= take;
+		node = node->right;
+	}
+}
+
+RopeToken ropeGet(const TokenRope *rope, size_t index) {
+	RopeToken token;
+	ropeRead(rope, index, &token, 1);
+	return token;
+}
+
+/**
+ * @brief 按顺序收集子树中的 Token
+ * @param node 子树
+ * @param skip 还需要跳过的 Token 数量
+ * @param end 当前的结尾偏移
+ * @param line 当前的行
+ * @param out 输出数组
+ * @param capacity 输出数组的容量
+ * @param count 已经输出的 Token 数量
+ */
+static void collect(const RopeNode *node, size_t *skip, uint64_t *end, uint64_t *line, RopeToken *out,
+                    size_t capacity, size_t *count) {
+	if (node == NULL || *count == capacity) {
+		return;
+	}
+	if (*skip >= node->tokens) {
+		*skip -= node->tokens;
+		*end += node->bytes;
+		*line += node->lines;
+		return;
+	}
+	collect(node->left, skip, end, line, out, capacity, count);
+	for (uint32_t i = 0; i < node->count && *count < capacity; i++) {
+		const RopeEntry *entry = &node->run[i];
+		uint64_t offset = *end + entry->gap;
+		*end = offset + entry->length;
+		*line += entry->lines;
+		if (*skip > 0) {
+			(*skip)--;
+			continue;
+		}
+		out[(*count)++] = (RopeToken){offset, (uint32_t)*line, entry->column, entry->length, entry->type};
+	}
+	collect(node->right, skip, end, line, out, capacity, count);
+}
+
+size_t ropeRead(const TokenRope *rope, size_t from, RopeToken *out, size_t capacity) {
+	size_t count = 0;
+	uint64_t end = 0, line = 0;
+	collect(rope->root, &from, &end, &line, out, capacity, &count);
+	return count;
+}
+
+/**
+ * @brief 节点过于零碎时把全部 Token 取出后重新建树
+ * @details 每次替换最多增加常数个节点，重建的代价分摊到之前的替换上仍为常数
+ */
+static void compact(TokenRope *rope) {
+	size_t tokens = ropeTokenCount(rope);
+	if (rope->nodeCount <= tokens / (ROPE_RUN / 2) + 16) {
+		return;
+	}
+	RopeToken *all = malloc((tokens + 1) * sizeof(RopeToken));
+	RopeEntry *entries = malloc((tokens + 1) * sizeof(RopeEntry));
+	if (all == NULL || entries == NULL) {
+		fprintf(stderr, "内存不足，无法保存 Token.\n");
+		exit(1);
+	}
+	ropeRead(rope, 0, all, tokens);
+	toEntries(all, tokens, 0, 0, entries);
+	freeTree(rope, rope->root);
+	rope->root = buildTree(rope, entries, tokens);
+	free(all);
+	free(entries);
+}
+
+void ropeReplace(TokenRope *rope, size_t from, size_t to, const RopeToken *tokens, size_t count, int64_t byteShift,
+                 int64_t lineShift) {
+	// 修改前先取得前一个 Token 的结尾和后一个 Token 的新位置
+	bool hasNext = to < ropeTokenCount(rope);
+	RopeToken next = {0, 0, 0, 0, 0};
+	if (hasNext) {
+		next = ropeGet(rope, to);
+		next.offset = (uint64_t)((int64_t)next.offset + byteShift);
+		next.line = (uint32_t)((int64_t)next.line + lineShift);
+	}
+	uint64_t end, line;
+	prefix(rope, from, &end, &line);
+
+	RopeNode *head, *middle, *tail;
+	split(rope, rope->root, to, &middle, &tail);
+	split(rope, middle, from, &head, &middle);
+	freeTree(rope, middle);
+
+	RopeEntry *entries = malloc((count + 1) * sizeof(RopeEntry));
+	toEntries(tokens, count, end, line, entries);
+	if (count > 0) {
+		end = tokens[count - 1].offset + tokens[count - 1].length;
+		line = tokens[count - 1].line;
+	}
+	RopeNode *inserted = buildTree(rope, entries, count);
+	free(entries);
+
+	// 后面的 Token 只有第一个的相对位置发生变化
+	if (hasNext) {
+		RopeNode *first, *rest;
+		split(rope, tail, 1, &first, &rest);
+		first->run[0].gap = (uint32_t)(next.offset - end);
+		first->run[0].lines = (uint32_t)(next.line - line);
+		update(first);
+		tail = join(first, rest);
+	}
+	rope->root = join(join(head, inserted), tail);
+	compact(rope);
+}
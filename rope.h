@@ -0,0 +1,88 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief 保存在 Token 树中的 Token，位置为绝对位置
+ */
+typedef struct {
+	uint64_t offset; ///< 起始字节偏移
+	uint32_t line;   ///< 所在的行，从 0 开始
+	uint32_t column; ///< 在行内的字节偏移
+	uint32_t length; ///< 字节数
+	uint32_t type;   ///< 由使用者决定含义的类型
+} RopeToken;
+
+typedef struct RopeNode RopeNode;
+
+/**
+ * @brief 按位置排序的 Token 序列，支持 O(log n) 的区间替换
+ * @details 以 Token 段为节点的 Treap：每个节点保存最多 ROPE_RUN 个连续的 Token，并汇总子树的 Token 数、字节数和行数。\n
+ * 每个 Token 只保存相对前一个 Token 的字节间隔和行差，绝对位置在查找时沿路径累加得到，
+ * 因此修改文本后，其后的 Token 只需要调整紧随修改处的那一个，替换一段 Token 只需要 O(log n + k) 的时间。
+ */
+typedef struct {
+	RopeNode *root;   ///< 根节点
+	size_t nodeCount; ///< 节点数量，碎片过多时整体重建
+	uint32_t seed;    ///< 生成节点优先级的随机数种子
+} TokenRope;
+
+/**
+ * @brief 初始化一个空的 Token 树
+ * @param rope Token 树
+ */
+void initTokenRope(TokenRope *rope);
+
+/**
+ * @brief 释放 Token 树
+ * @param rope Token 树
+ */
+void freeTokenRope(TokenRope *rope);
+
+/**
+ * @brief 取得 Token 数量
+ * @param rope Token 树
+ * @return Token 数量
+ */
+size_t ropeTokenCount(const TokenRope *rope);
+
+/**
+ * @brief 查找第一个所在行不小于 line 的 Token
+ * @param rope Token 树
+ * @param line 行号
+ * @return Token 的下标，所有 Token 都在 line 之前时返回 Token 数量
+ */
+size_t ropeFindLine(const TokenRope *rope, uint32_t line);
+
+/**
+ * @brief 取得一个 Token
+ * @param rope Token 树
+ * @param index Token 的下标，必须小于 Token 数量
+ * @return Token 及其绝对位置
+ */
+RopeToken ropeGet(const TokenRope *rope, size_t index);
+
+/**
+ * @brief 从指定下标开始连续读取 Token
+ * @param rope Token 树
+ * @param from 第一个 Token 的下标
+ * @param out 输出数组
+ * @param capacity 输出数组的容量
+ * @return 读取的 Token 数量，到达末尾时小于 capacity
+ */
+size_t ropeRead(const TokenRope *rope, size_t from, RopeToken *out, size_t capacity);
+
+/**
+ * @brief 替换一段 Token，并平移其后的 Token
+ * @details 把下标 [from, to) 的 Token 替换为 tokens，原来位于 to 及之后的 Token 的偏移和行号分别加上 byteShift 和 lineShift，
+ * 实际只修改紧随其后的一个 Token 的相对位置
+ * @param rope Token 树
+ * @param from 被替换的第一个 Token
+ * @param to 被替换的最后一个 Token 之后
+ * @param tokens 新的 Token，位置为修改后的绝对位置，必须按位置排序且位于前后 Token 之间
+ * @param count 新的 Token 数量
+ * @param byteShift 其后 Token 的字节偏移变化量
+ * @param lineShift 其后 Token 的行号变化量
+ */
+void ropeReplace(TokenRope *rope, size_t from, size_t to, const RopeToken *tokens, size_t count, int64_t byteShift,
+                 int64_t lineShift);
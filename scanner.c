@@ -1,3 +1,4 @@
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
@@ -10,33 +11,51 @@
  * 该结构体为内部实现细节，不对外暴露
  */
 typedef struct {
-	const char *start;   ///< 指向当前正在扫描的 Token 的起始字符
-	const char *current; ///< 当前处理的 Token 的字符，初始为 start，遍历完 Token 后指向下一个字符
-	int line;            ///< 记录当前 Token 所处的行
+	const char *source;    ///< 源代码的起始位置，用于计算错误信息中的字节偏移
+	const char *start;     ///< 指向当前正在扫描的 Token 的起始字符
+	const char *current;   ///< 当前处理的 Token 的字符，初始为 start，遍历完 Token 后指向下一个字符
+	const char *lineStart; ///< 当前行的起始位置，用于计算列号
+	int line;              ///< 记录当前 Token 所处的行
+	unsigned features;     ///< 启用的 ScanFeature 组合，决定使用哪一个特化的扫描函数
+	Token (*scan)(void);   ///< 与 features 对应的特化扫描函数
 } Scanner;
 
 /**
  * @brief 全局 Scanner 实例
- * @details 静态全局变量，用于存储词法分析器的状态
+ * @details 静态全局变量，用于存储词法分析器的状态 \n
+ * 每个线程各自拥有一份，多个线程可以同时分析不同的文件
  */
-static Scanner scanner;
+static _Thread_local Scanner scanner;
 
 /**
  * @brief 错误信息缓冲区
  * @details 用于存储词法分析器处理错误 Token 时的错误信息
  */
-static char message[50];
+static _Thread_local char message[128];
 
 /**
- * @brief 初始化词法分析器
- * @details 初始化全局变量 Scanner 的状态，传入要分析的源码字符串，开始词法分析
- * @param source 源码字符串
+ * @brief Trivia 表
+ * @details 启用 SCAN_TRIVIA 时记录每个 Token 的前置 Trivia，每个线程一份，重新初始化词法分析器时清空并复用
  */
-void initScanner(const char *source) {
-	scanner.start = source;
-	scanner.current = source;
-	scanner.line = 1;
-}
+static _Thread_local TriviaTable trivia;
+
+/**
+ * @brief 线程退出时释放 Trivia 表的 pthread 键
+ */
+static pthread_key_t triviaKey;
+static pthread_once_t triviaOnce = PTHREAD_ONCE_INIT;
+static _Thread_local bool triviaRegistered = false;
+
+/**
+ * @brief 强制内联
+ * @details 扫描函数的各个辅助函数都以 features 为参数，强制内联后 features 成为常量，
+ * 编译器会删除未启用功能的代码，每个特化版本中不存在任何运行时的功能判断
+ */
+#if defined(__GNUC__)
+#define SCANNER_INLINE static inline __attribute__((always_inline))
+#else
+#define SCANNER_INLINE static inline
+#endif
 
 /**
  * @brief 判断字符是否为字母或下划线
@@ -58,6 +77,20 @@ static bool isDigit(char c) {
 	return c >= '0' && c <= '9';
 }
 
+/**
+ * @brief 判断字符是否可能构成合法的 Token 或空白
+ * @details 用于在出现意外字符时确定连续无法识别的字节序列的结束位置
+ * @param c 待判断的字符
+ * @return 如果 c 是字母、数字、空白、已知的运算符或引号，返回 true，否则返回 false
+ */
+static bool isRecognized(char c) {
+	if (isAlpha(c) || isDigit(c)) {
+		return true;
+	}
+	// strchr 同样会匹配到字符串末尾的空字符，因此 '\0' 也视为可识别，保证错误序列在源码末尾停止
+	return strchr("(){}[],.;~+-*/%&|^=!<>\"' \t\r\n", c) != NULL;
+}
+
 /**
  * @brief 判断是否到达字符串末尾
  * @return 如果当前字符是字符串末尾的空字符，返回 true，否则返回 false
@@ -115,12 +148,13 @@ static bool match(char expected) {
  * @param type 要创建的 Token 的类型
  * @return Token 结构体
  */
-static Token makeToken(TokenType type) {
+SCANNER_INLINE Token makeToken(TokenType type, unsigned features) {
 	Token token;
 	token.type = type;
 	token.start = scanner.start;
 	token.length = (int)(scanner.current - scanner.start); // 计算 Token 字符串的长度
-	token.line = scanner.line;
+	token.line = (features & SCAN_LINES) ? scanner.line : 0;
+	token.column = (features & SCAN_COLUMNS) ? (int)(scanner.start - scanner.lineStart) + 1 : 0;
 	return token;
 }
 
@@ -131,12 +165,17 @@ static Token makeToken(TokenType type) {
  * @param message 错误信息
  * @return 错误 Token
  */
-static Token errorToken(const char *message) {
+SCANNER_INLINE Token errorToken(const char *message, unsigned features) {
 	Token token;
 	token.type = TOKEN_ERROR;
 	token.start = message;
 	token.length = (int)strlen(message);
-	token.line = scanner.line;
+	if (features & SCAN_TRIVIA) {
+		// 错误 Token 不指向源码，把它覆盖的源码记为 Trivia，保证能够无损还原源码
+		addTriviaRun(&trivia, TRIVIA_SKIPPED, (size_t)(scanner.current - scanner.start));
+	}
+	token.line = (features & SCAN_LINES) ? scanner.line : 0;
+	token.column = (features & SCAN_COLUMNS) ? (int)(scanner.start - scanner.lineStart) + 1 : 0;
 	return token;
 }
 
@@ -145,24 +184,43 @@ static Token errorToken(const char *message) {
  * @details 此函数将 scanner 的当前位置向前移动，跳过所有空白字符和单行注释，
  * 直到遇到非空白字符或源代码结束
  */
-static void skipWhitespace() {
+SCANNER_INLINE void skipWhitespace(unsigned features) {
 	for (;;) {
 		char c = peek(); // 查看当前字符
 		switch (c) {
 			case ' ':  // 空格
 			case '\r': // 回车
 			case '\t': // 制表符
-			case '\n': // 换行符
 				// 如果当前字符是空白字符，移动到下一个字符
+				if (features & SCAN_TRIVIA) {
+					addTriviaRun(&trivia, c == ' ' ? TRIVIA_SPACE : c == '\t' ? TRIVIA_TAB : TRIVIA_CARRIAGE_RETURN, 1);
+				}
 				advance();
 				break;
+			case '\n': // 换行符
+				// 换行时需要更新行号和行首位置，Token 才能记录正确的行和列
+				if (features & SCAN_TRIVIA) {
+					addTriviaRun(&trivia, TRIVIA_NEWLINE, 1);
+				}
+				advance();
+				if (features & SCAN_LINES) {
+					scanner.line++;
+				}
+				if (features & SCAN_COLUMNS) {
+					scanner.lineStart = scanner.current;
+				}
+				break;
 			case '/': // 正斜杠，可能是注释或除号
 				// 如果当前字符是正斜杠，检查下一个字符以确定是否为注释
 				if (peekNext() == '/') {
 					// 单行注释，跳过直到行尾或源代码结束
+					const char *commentStart = scanner.current;
 					while (peek() != '\n' && !isAtEnd()) {
 						advance();
 					}
+					if (features & SCAN_TRIVIA) {
+						addTriviaRun(&trivia, TRIVIA_COMMENT, (size_t)(scanner.current - commentStart));
+					}
 				} else {
 					// 如果不是注释，说明已经到达有效的 Token，退出循环
 					return;
@@ -309,7 +367,7 @@ static TokenType identifierType() {
  * @details 识别并构造以字母或下划线开头，后跟任意数量的字母、下划线或数字的标识符 Token
  * @return 返回类型为 TOKEN_IDENTIFIER 或特定关键字类型的
  */
-static Token identifier() {
+SCANNER_INLINE Token identifier(unsigned features) {
 	// 循环以识别标识符的字符序列，只要当前字符是字母、下划线或数字，就继续读取下一个字符
 	// 循环将自动跳过标识符中的所有字符，直到遇到非标识符字符
 	while (isAlpha(peek()) || isDigit(peek())) {
@@ -319,9 +377,10 @@ static Token identifier() {
 	// 此时，scanner.start 指向标识符的开始，而 scanner.current 指向标识符的下一个字符
 	// 使用 identifierType() 函数判断当前扫描的标识符是普通标识符还是关键字
 	// 这个函数会根据标识符的字符串内容返回相应的 TokenType
-	TokenType type = identifierType();
+	// 不需要区分关键字时，所有标识符都直接作为 TOKEN_IDENTIFIER
+	TokenType type = (features & SCAN_KEYWORDS) ? identifierType() : TOKEN_IDENTIFIER;
 	// 构造并返回 Token
-	return makeToken(type);
+	return makeToken(type, features);
 }
 
 /**
@@ -329,7 +388,7 @@ static Token identifier() {
  * @details 根据预定义的规则，识别数字（包括整数和小数），并构造相应的 Token
  * @return 返回类型为 TOKEN_NUMBER 的 Token
  */
-static Token number() {
+SCANNER_INLINE Token number(unsigned features) {
 	// 识别数字的整数部分，包括数字零和正整数
 	while (isDigit(peek())) {
 		advance();
@@ -344,7 +403,7 @@ static Token number() {
 		}
 	}
 	// 无论数字是整数还是小数，都使用相同的 Token 类型 TOKEN_NUMBER
-	return makeToken(TOKEN_NUMBER);
+	return makeToken(TOKEN_NUMBER, features);
 }
 
 /**
@@ -352,23 +411,23 @@ static Token number() {
  * @details 处理以双引号开头和结尾的字符串 Token
  * @return Token
  */
-static Token string() {
+SCANNER_INLINE Token string(unsigned features) {
 	// 字符串必须以双引号开头和结尾，不能跨越多行，不支持转义字符
 	// 循环直到遇到双引号或文件结束符
 	while (!isAtEnd() && peek() != '"') {
 		// 如果当前字符是换行符，表示字符串跨越了多行，这是不允许的
 		if (peek() == '\n') {
-			return errorToken("不支持多行字符串!");
+			return errorToken("不支持多行字符串!", features);
 		}
 		advance(); // 继续检查下一个字符，直到字符串结束或文件结束。
 	}
 	// 检查是否到达文件结束符，如果没有找到结束的双引号，表示字符串未终止
 	if (isAtEnd()) {
-		return errorToken("未终止的字符串字面量！");
+		return errorToken("未终止的字符串字面量！", features);
 	}
 	// 找到字符串结束的双引号，构造字符串 Token 并返回
 	advance();
-	return makeToken(TOKEN_STRING);
+	return makeToken(TOKEN_STRING, features);
 }
 
 /**
@@ -376,22 +435,22 @@ static Token string() {
  * @details 处理以单引号开头和结尾的字符 Token
  * @return Token
  */
-static Token character() {
+SCANNER_INLINE Token character(unsigned features) {
 	// 如果到达文件结束符，表示字符 Token 不完整，缺少右单引号
 	if (isAtEnd()) {
-		return errorToken("此字符不完整,缺少右单引号!");
+		return errorToken("此字符不完整,缺少右单引号!", features);
 	}
 	// 确保当前字符不是空字符，且不是单引号
 	while (!isAtEnd() && peek() != '\'') {
 		// 循环直到遇到单引号或文件结束符
 		if (peek() == '\n') {
 			// 如果遇到换行符，表示字符 Token 跨越了多行，这是不允许的
-			return errorToken("不支持多行字符!");
+			return errorToken("不支持多行字符!", features);
 		}
 		advance(); // 继续检查下一个字符
 	}
 	if (isAtEnd()) {
-		return errorToken("此字符不完整,缺少右单引号!");
+		return errorToken("此字符不完整,缺少右单引号!", features);
 	}
 	// 确认找到了右单引号，此时已经完成了字符 Token 的识别，需要检查单引号内是否正好有一个字符
 	// 结束一个 Token 处理时，要保证 curr 指针移动向此 Token 的下一个位置
@@ -399,128 +458,248 @@ static Token character() {
 	int charLen = scanner.current - scanner.start - 2;
 	// 如果单引号内只有一个字符，则构造并返回正常的字符 Token
 	if (charLen == 1 || charLen == 0) {
-		return makeToken(TOKEN_CHARACTER);
+		return makeToken(TOKEN_CHARACTER, features);
 	}
 	// 如果单引号内字符数量不为一，这是不合法的字符 Token
 	// 构造并返回一个错误 Token，描述非法字符 Token 的内容
 	char *charStart = (char *)(scanner.start + 1); // 指向字符 Token 的起始位置
-	sprintf(message, "非单字符Token: %.*s", charLen, charStart);
-	return errorToken(message);
+	snprintf(message, sizeof(message), "非单字符Token: %.*s", charLen, charStart);
+	return errorToken(message, features);
 }
 
 /**
  * @brief 处理无法识别的字符
- * @param character 字符
+ * @details 连续的无法识别字节会被合并为一个错误 Token，避免二进制或乱码输入时每个字节都产生一个 Token \n
+ * 单个字符时输出该字符，多个字符时输出其在源码中的字节范围 [起始, 结束)
+ * @param character 第一个无法识别的字符
  * @return Token 错误信息
  */
-static Token errorTokenWithChar(char character) {
-	// 将无法识别的字符输出
-	sprintf(message, "意外字符：%c", character);
-	return errorToken(message);
+SCANNER_INLINE Token errorTokenWithChar(char character, unsigned features) {
+	// 一直跳过到下一个可能合法的字符为止
+	while (!isAtEnd() && !isRecognized(peek())) {
+		advance();
+	}
+	long length = (long)(scanner.current - scanner.start);
+	if (length == 1) {
+		// 将无法识别的字符输出
+		snprintf(message, sizeof(message), "意外字符：%c", character);
+	} else {
+		long offset = (long)(scanner.start - scanner.source);
+		snprintf(message, sizeof(message), "意外字符序列：字节 [%ld, %ld)，共 %ld 字节", offset, offset + length, length);
+	}
+	return errorToken(message, features);
 }
 
 /**
  * @brief 词法分析器核心逻辑
- * @details 返回一个制作好的 Token
+ * @details 返回一个制作好的 Token \n
+ * 只编写一次，由下面的宏按 features 的每种组合实例化，features 在每个实例中都是常量
+ * @param features 启用的 ScanFeature 组合
  * @return Token
  */
-Token scanToken() {
+SCANNER_INLINE Token scanTokenWith(unsigned features) {
+	if (features & SCAN_TRIVIA) {
+		beginTokenTrivia(&trivia); // 接下来跳过的空白和注释都属于这个 Token 的前置 Trivia
+	}
 	// 跳过所有前置的空白字符和注释，将 scanner.current 指向下一个有效的 Token 起始位置
-	skipWhitespace();
+	skipWhitespace(features);
 	// 记录下一个 Token 的起始位置
 	scanner.start = scanner.current;
 	// 如果 curr 指向了空字符, 那么就已经处理源代码完毕了, 直接返回 TOKEN_EOF
 	if (isAtEnd()) {
-		return makeToken(TOKEN_EOF);
+		return makeToken(TOKEN_EOF, features);
 	}
 	char c = advance();
 	// 如果当前字符是字母或下划线，进入标识符或关键字的识别流程
 	if (isAlpha(c)) {
-		return identifier();
+		return identifier(features);
 	}
 	// 如果当前字符是数字，进入数字的识别流程
 	if (isDigit(c)) {
-		return number();
+		return number(features);
 	}
 	// 根据当前字符，通过 switch 语句识别和处理各种单字符和多字符的 Token
 	switch (c) {
 		// 处理单字符 Token
-		case '(': return makeToken(TOKEN_LEFT_PAREN);
-		case ')': return makeToken(TOKEN_RIGHT_PAREN);
-		case '{': return makeToken(TOKEN_LEFT_BRACE);
-		case '}': return makeToken(TOKEN_RIGHT_BRACE);
-		case ',': return makeToken(TOKEN_COMMA);
-		case '.': return makeToken(TOKEN_DOT);
-		case ';': return makeToken(TOKEN_SEMICOLON);
-		case '~': return makeToken(TOKEN_TILDE);
+		case '(': return makeToken(TOKEN_LEFT_PAREN, features);
+		case ')': return makeToken(TOKEN_RIGHT_PAREN, features);
+		case '[': return makeToken(TOKEN_LEFT_BRACKET, features);
+		case ']': return makeToken(TOKEN_RIGHT_BRACKET, features);
+		case '{': return makeToken(TOKEN_LEFT_BRACE, features);
+		case '}': return makeToken(TOKEN_RIGHT_BRACE, features);
+		case ',': return makeToken(TOKEN_COMMA, features);
+		case '.': return makeToken(TOKEN_DOT, features);
+		case ';': return makeToken(TOKEN_SEMICOLON, features);
+		case '~': return makeToken(TOKEN_TILDE, features);
 		// 处理可能的双字符 Token
 		case '+':
 			if (match('+')) {
-				return makeToken(TOKEN_PLUS_PLUS);
+				return makeToken(TOKEN_PLUS_PLUS, features);
 			} else if (match('=')) {
-				return makeToken(TOKEN_PLUS_EQUAL);
+				return makeToken(TOKEN_PLUS_EQUAL, features);
 			} else {
-				return makeToken(TOKEN_PLUS);
+				return makeToken(TOKEN_PLUS, features);
 			}
 		case '-':
 			if (match('-')) {
-				return makeToken(TOKEN_MINUS_MINUS);
+				return makeToken(TOKEN_MINUS_MINUS, features);
 			} else if (match('=')) {
-				return makeToken(TOKEN_MINUS_EQUAL);
+				return makeToken(TOKEN_MINUS_EQUAL, features);
 			} else if (match('>')) {
-				return makeToken(TOKEN_MINUS_GREATER);
+				return makeToken(TOKEN_MINUS_GREATER, features);
 			} else {
-				return makeToken(TOKEN_MINUS);
+				return makeToken(TOKEN_MINUS, features);
 			}
 		case '*':
-			return makeToken(match('=') ? TOKEN_STAR_EQUAL : TOKEN_STAR);
+			return makeToken(match('=') ? TOKEN_STAR_EQUAL : TOKEN_STAR, features);
 		case '/':
-			return makeToken(match('=') ? TOKEN_SLASH_EQUAL : TOKEN_SLASH);
+			return makeToken(match('=') ? TOKEN_SLASH_EQUAL : TOKEN_SLASH, features);
 		case '%':
-			return makeToken(match('=') ? TOKEN_PERCENT_EQUAL : TOKEN_PERCENT);
+			return makeToken(match('=') ? TOKEN_PERCENT_EQUAL : TOKEN_PERCENT, features);
 		case '&':
 			if (match('=')) {
-				return makeToken(TOKEN_AMPER_EQUAL);
+				return makeToken(TOKEN_AMPER_EQUAL, features);
 			} else if (match('&')) {
-				return makeToken(TOKEN_AMPER_AMPER);
+				return makeToken(TOKEN_AMPER_AMPER, features);
 			} else {
-				return makeToken(TOKEN_AMPER);
+				return makeToken(TOKEN_AMPER, features);
 			}
 		case '|':
 			if (match('=')) {
-				return makeToken(TOKEN_PIPE_EQUAL);
+				return makeToken(TOKEN_PIPE_EQUAL, features);
 			} else if (match('|')) {
-				return makeToken(TOKEN_PIPE_PIPE);
+				return makeToken(TOKEN_PIPE_PIPE, features);
 			} else {
-				return makeToken(TOKEN_PIPE);
+				return makeToken(TOKEN_PIPE, features);
 			}
 		case '^':
-			return makeToken(match('=') ? TOKEN_HAT_EQUAL : TOKEN_HAT);
+			return makeToken(match('=') ? TOKEN_HAT_EQUAL : TOKEN_HAT, features);
 		case '=':
-			return makeToken(match('=') ? TOKEN_EQUAL_EQUAL : TOKEN_EQUAL);
+			return makeToken(match('=') ? TOKEN_EQUAL_EQUAL : TOKEN_EQUAL, features);
 		case '!':
-			return makeToken(match('=') ? TOKEN_BANG_EQUAL : TOKEN_BANG);
+			return makeToken(match('=') ? TOKEN_BANG_EQUAL : TOKEN_BANG, features);
 		case '<':
 			if (match('=')) {
-				return makeToken(TOKEN_LESS_EQUAL);
+				return makeToken(TOKEN_LESS_EQUAL, features);
 			} else if (match('<')) {
-				return makeToken(TOKEN_LESS_LESS);
+				return makeToken(TOKEN_LESS_LESS, features);
 			} else {
-				return makeToken(TOKEN_LESS);
+				return makeToken(TOKEN_LESS, features);
 			}
 		case '>':
 			if (match('=')) {
-				return makeToken(TOKEN_GREATER_EQUAL);
+				return makeToken(TOKEN_GREATER_EQUAL, features);
 			} else if (match('>')) {
-				return makeToken(TOKEN_GREATER_GREATER);
+				return makeToken(TOKEN_GREATER_GREATER, features);
 			} else {
-				return makeToken(TOKEN_GREATER);
+				return makeToken(TOKEN_GREATER, features);
 			}
 		// 处理字符串和字符字面量 Token
-		case '"': return string();     // 字符串处理模式
-		case '\'': return character(); // 字符处理模式
+		case '"': return string(features);     // 字符串处理模式
+		case '\'': return character(features); // 字符处理模式
 		// 如果当前字符不匹配任何已知 Token 类型，则生成一个错误 Token
 		default:
-			return errorTokenWithChar(c);
+			return errorTokenWithChar(c, features);
+	}
+}
+
+/**
+ * @brief 批量扫描的核心循环
+ * @details 与 scanTokenWith 一样按 features 特化，整个循环位于特化函数内部，每个 Token 不需要任何间接调用
+ * @param tokens 保存 Token 的数组
+ * @param capacity 数组的容量
+ * @param features 启用的 ScanFeature 组合
+ * @return 写入的 Token 数量
+ */
+SCANNER_INLINE size_t scanTokensWith(Token *tokens, size_t capacity, unsigned features) {
+	size_t count = 0;
+	while (count < capacity) {
+		Token token = scanTokenWith(features);
+		tokens[count++] = token;
+		if (token.type == TOKEN_EOF) {
+			break;
+		}
 	}
+	return count;
+}
+
+/**
+ * @brief 列出所有需要实例化的 features 组合
+ * @details 组合的值必须是 0 到 SCAN_ALL 的全部整数，按顺序排列，以便直接用 features 作为下标
+ */
+#define SCAN_SPECIALIZATIONS(X) \
+	X(0) X(1) X(2) X(3) X(4) X(5) X(6) X(7) \
+	X(8) X(9) X(10) X(11) X(12) X(13) X(14) X(15)
+
+/**
+ * @brief 为一个 features 组合定义特化的扫描函数
+ */
+#define DEFINE_SCAN(mask) \
+	static Token scanToken##mask(void) { return scanTokenWith(mask); } \
+	static size_t scanTokens##mask(Token *tokens, size_t capacity) { return scanTokensWith(tokens, capacity, mask); }
+
+SCAN_SPECIALIZATIONS(DEFINE_SCAN)
+
+#define SCAN_ENTRY(mask) scanToken##mask,
+#define SCAN_BATCH_ENTRY(mask) scanTokens##mask,
+
+/**
+ * @brief 按 features 索引的特化扫描函数表
+ */
+static Token (*const scanTable[])(void) = {SCAN_SPECIALIZATIONS(SCAN_ENTRY)};
+
+/**
+ * @brief 按 features 索引的特化批量扫描函数表
+ */
+static size_t (*const scanBatchTable[])(Token *, size_t) = {SCAN_SPECIALIZATIONS(SCAN_BATCH_ENTRY)};
+
+/**
+ * @brief 线程退出时把 Trivia 表的数组归还给缓冲池，缓冲池随后由 arena.c 的清理函数释放
+ * @param value 登记时的值，未使用
+ */
+static void freeThreadTrivia(void *value) {
+	(void)value;
+	triviaRegistered = false;
+	freeTriviaTable(&trivia);
+}
+
+/**
+ * @brief 创建线程退出时的清理键
+ */
+static void createTriviaKey(void) {
+	pthread_key_create(&triviaKey, freeThreadTrivia);
+}
+
+void initScannerWithFeatures(const char *source, unsigned features) {
+	if (!triviaRegistered) {
+		pthread_once(&triviaOnce, createTriviaKey);
+		pthread_setspecific(triviaKey, &trivia);
+		triviaRegistered = true;
+	}
+	features &= SCAN_ALL;
+	scanner.source = source;
+	scanner.start = source;
+	scanner.current = source;
+	scanner.lineStart = source;
+	scanner.line = 1;
+	scanner.features = features;
+	scanner.scan = scanTable[features]; // 初始化时选择特化版本，扫描时不再判断功能开关
+	trivia.runCount = 0;
+	trivia.tokenCount = 0;
+}
+
+void initScanner(const char *source) {
+	initScannerWithFeatures(source, SCAN_DEFAULT);
+}
+
+Token scanToken() {
+	return scanner.scan();
+}
+
+size_t scanTokens(Token *tokens, size_t capacity) {
+	return scanBatchTable[scanner.features](tokens, capacity);
+}
+
+const TriviaTable *scannerTrivia(void) {
+	return &trivia;
 }
@@ -1,6 +1,10 @@
 #ifndef SCANNER_H
 #define SCANNER_H
 
+#include <stddef.h>
+
+#include "trivia.h"
+
 /**
  * @brief TokenType 枚举
  * @details 定义一个 TokenType 枚举，用于标记不同种类的 Token
@@ -84,15 +88,45 @@ typedef struct {
 	/*!< Token 的起始字符指针 */
 	const char *start; ///< start 指向 source 中的字符，source 为读入的源代码。
 	int length;        ///< length 表示这个 Token 的长度
-	int line;          ///< line 表示这个 Token 在源代码的哪一行, 方便后面的报错和描述 Token
+	int line;          ///< line 表示这个 Token 在源代码的哪一行, 方便后面的报错和描述 Token, 未启用 SCAN_LINES 时为 0
+	int column;        ///< column 表示这个 Token 在所在行的第几个字节, 从 1 开始, 未启用 SCAN_COLUMNS 时为 0
 } Token;
 
+/**
+ * @brief ScanFeature 枚举
+ * @details 词法分析器的可选功能，可以按位或组合。\n
+ * 每种组合都有一个编译期特化的扫描函数，未启用的功能在扫描时不执行任何指令
+ */
+typedef enum {
+	SCAN_LINES = 1 << 0,    ///< 记录 Token 所在的行
+	SCAN_COLUMNS = 1 << 1,  ///< 记录 Token 所在的列
+	SCAN_KEYWORDS = 1 << 2, ///< 区分关键字和普通标识符，未启用时关键字也作为 TOKEN_IDENTIFIER
+	SCAN_TRIVIA = 1 << 3,   ///< 在 Trivia 表中记录每个 Token 的前置空白和注释，用于无损还原源码
+} ScanFeature;
+
+/**
+ * @brief 所有 ScanFeature 的组合
+ */
+#define SCAN_ALL (SCAN_LINES | SCAN_COLUMNS | SCAN_KEYWORDS | SCAN_TRIVIA)
+
+/**
+ * @brief initScanner 使用的默认功能组合
+ */
+#define SCAN_DEFAULT (SCAN_LINES | SCAN_KEYWORDS)
+
 /**
  * @brief 初始化词法分析器
  * @param source 源代码字符串
- * @details 将源码转换成字符串，供词法分析器使用。
+ * @details 将源码转换成字符串，供词法分析器使用。使用 SCAN_DEFAULT 功能组合。
  */
 void initScanner(const char *source);
+/**
+ * @brief 以指定的功能组合初始化词法分析器
+ * @param source 源代码字符串
+ * @param features ScanFeature 的组合
+ * @details 根据 features 选择对应的特化扫描函数，之后的 scanToken 和 scanTokens 都使用该版本。
+ */
+void initScannerWithFeatures(const char *source, unsigned features);
 /**
  * @brief 词法分析器的核心 API
  * @details 调用此函数，生成源代码中下一段字符数据的 Token。
@@ -100,5 +134,21 @@ void initScanner(const char *source);
  * 当 Token 返回的是 TOKEN_EOF 时，表示源文件已完全分析。
  */
 Token scanToken();
+/**
+ * @brief 批量生成 Token
+ * @details 连续生成 Token 写入数组，直到生成 TOKEN_EOF 或数组写满。\n
+ * 整个循环在特化函数内部执行，比逐个调用 scanToken 少一次间接调用。
+ * @param tokens 保存 Token 的数组
+ * @param capacity 数组的容量
+ * @return 写入的 Token 数量，最后一个 Token 为 TOKEN_EOF 时表示源文件已完全分析。
+ */
+size_t scanTokens(Token *tokens, size_t capacity);
+/**
+ * @brief 取得当前线程词法分析器的 Trivia 表
+ * @details 启用 SCAN_TRIVIA 时，第 i 次 scanToken 返回的 Token 对应表中的第 i 项。\n
+ * 表在下一次初始化词法分析器时被清空。
+ * @return Trivia 表
+ */
+const TriviaTable *scannerTrivia(void);
 
 #endif  // !SCANNER_H
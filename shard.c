@@ -0,0 +1,420 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "archive.h"
+#include "files.h"
+#include "kernels.h"
+#include "parallel.h"
+#include "shard.h"
+#include "stream.h"
+#include "tools.h"
+
+/**
+ * @brief 分片完成一个文件后追加的记录
+ */
+typedef struct {
+	uint32_t file;   ///< 文件编号
+	uint32_t shard;  ///< 数据所在的分片
+	uint64_t offset; ///< Token 流在分片数据段中的位置
+	uint64_t length; ///< Token 流的字节数
+	uint64_t hash;   ///< 源文件内容的哈希值
+} ShardRecord;
+
+/**
+ * @brief 一个分片
+ */
+typedef struct {
+	uint32_t *files; ///< 分片中的文件编号
+	size_t count;    ///< 文件数量
+	uint64_t bytes;  ///< 文件的总字节数
+	pid_t pid;       ///< 运行中的子进程，0 表示没有运行
+	bool failed;     ///< 子进程是否异常退出
+} Shard;
+
+/**
+ * @brief 分片分析的全部状态
+ */
+typedef struct {
+	const FileList *files; ///< 全部文件
+	uint64_t *sizes;       ///< 每个文件的字节数
+	const char *directory; ///< 存放分片数据段和记录的临时目录
+	Shard *shards;         ///< 全部分片，包括重试时的单文件分片
+	size_t shardCount;     ///< 分片数量
+	size_t shardCapacity;  ///< shards 的容量
+	ShardRecord *done;     ///< 每个文件的完成记录，length 为 UINT64_MAX 表示未完成
+} ShardJob;
+
+/**
+ * @brief 重新分配内存，失败时打印错误信息并退出程序
+ */
+static void *reallocOrDie(void *memory, size_t size) {
+	void *result = realloc(memory, size > 0 ? size : 1);
+	if (result == NULL) {
+		fprintf(stderr, "内存不足，无法分片分析.\n");
+		exit(1);
+	}
+	return result;
+}
+
+/**
+ * @brief 取得分片的数据段或记录文件的路径
+ * @param job 分片分析的状态
+ * @param shard 分片编号
+ * @param suffix "seg" 或 "idx"
+ * @return 路径，由调用者释放
+ */
+static char *shardPath(const ShardJob *job, size_t shard, const char *suffix) {
+	size_t length = strlen(job->directory) + 32;
+	char *path = reallocOrDie(NULL, length);
+	snprintf(path, length, "%s/%zu.%s", job->directory, shard, suffix);
+	return path;
+}
+
+/**
+ * @brief 追加一个分片
+ * @return 分片编号
+ */
+static size_t addShard(ShardJob *job) {
+	if (job->shardCount == job->shardCapacity) {
+		job->shardCapacity = job->shardCapacity > 0 ? job->shardCapacity * 2 : 16;
+		job->shards = reallocOrDie(job->shards, job->shardCapacity * sizeof(Shard));
+	}
+	job->shards[job->shardCount] = (Shard){NULL, 0, 0, 0, false};
+	return job->shardCount++;
+}
+
+/**
+ * @brief 把文件加入分片
+ */
+static void addShardFile(ShardJob *job, size_t shard, uint32_t file) {
+	Shard *target = &job->shards[shard];
+	target->files = reallocOrDie(target->files, (target->count + 1) * sizeof(uint32_t));
+	target->files[target->count++] = file;
+	target->bytes += job->sizes[file];
+}
+
+/**
+ * @brief 写入全部数据
+ * @return 成功返回 true，否则返回 false
+ */
+static bool writeAll(int fd, const void *data, size_t length) {
+	const char *p = data;
+	while (length > 0) {
+		ssize_t n = write(fd, p, length);
+		if (n <= 0) {
+			return false;
+		}
+		p += n;
+		length -= (size_t)n;
+	}
+	return true;
+}
+
+/**
+ * @brief 子进程：依次分析分片中的文件
+ * @details 每个文件的 Token 流写入数据段之后才追加记录，进程在任何时刻崩溃，已有的记录都指向完整的数据。\n
+ * 无法读取的文件不写记录，继续分析其余文件，最后以非零退出码结束，由父进程单独重试。
+ * @param job 分片分析的状态
+ * @param shard 分片编号
+ * @return 进程退出码
+ */
+static int runShard(const ShardJob *job, size_t shard) {
+	char *segmentPath = shardPath(job, shard, "seg");
+	char *recordPath = shardPath(job, shard, "idx");
+	int segment = open(segmentPath, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	int records = open(recordPath, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0666);
+	free(segmentPath);
+	free(recordPath);
+	if (segment < 0 || records < 0) {
+		fprintf(stderr, "无法创建分片 %zu 的输出文件.\n", shard);
+		return 1;
+	}
+	TokenStream stream;
+	initTokenStream(&stream);
+	uint64_t offset = 0;
+	int status = 0;
+	const Shard *target = &job->shards[shard];
+	for (size_t i = 0; i < target->count; i++) {
+		uint32_t file = target->files[i];
+		size_t length;
+		// readFile 失败时调用 exit，会执行 startShard 有意避开的退出处理
+		char *source = tryReadFile(job->files->paths[file], &length);
+		if (source == NULL) {
+			status = 1;
+			continue;
+		}
+		encodeTokenStream(source, length, &stream);
+		ShardRecord record = {file, (uint32_t)shard, offset, stream.length, hashBytes(source, length)};
+		releaseFile(source, length);
+		if (!writeAll(segment, stream.data, stream.length) || !writeAll(records, &record, sizeof(record))) {
+			fprintf(stderr, "无法写入分片 %zu 的输出文件.\n", shard);
+			return 1;
+		}
+		offset += stream.length;
+	}
+	freeTokenStream(&stream);
+	return close(segment) == 0 && close(records) == 0 ? status : 1;
+}
+
+/**
+ * @brief 启动一个分片的子进程
+ */
+static void startShard(ShardJob *job, size_t shard) {
+	fflush(stdout);
+	fflush(stderr);
+	pid_t pid = fork();
+	if (pid < 0) {
+		fprintf(stderr, "无法创建分片 %zu 的子进程.\n", shard);
+		job->shards[shard].failed = true;
+		return;
+	}
+	if (pid == 0) {
+		_exit(runShard(job, shard)); // 不执行父进程注册的退出处理，也不重复刷新父进程的缓冲区
+	}
+	job->shards[shard].pid = pid;
+}
+
+/**
+ * @brief 读取分片的完成记录
+ * @details 记录文件末尾不完整的记录（子进程在写入时崩溃）被忽略
+ */
+static void collectRecords(ShardJob *job, size_t shard) {
+	char *recordPath = shardPath(job, shard, "idx");
+	FILE *file = fopen(recordPath, "rb");
+	free(recordPath);
+	if (file == NULL) {
+		return;
+	}
+	ShardRecord record;
+	while (fread(&record, sizeof(record), 1, file) == 1) {
+		if (record.file < (uint32_t)job->files->count && record.shard == shard) {
+			job->done[record.file] = record;
+		}
+	}
+	fclose(file);
+}
+
+/**
+ * @brief 运行编号在 [first, last) 之间的分片，最多同时运行 parallel 个子进程
+ * @param job 分片分析的状态
+ * @param first 第一个分片
+ * @param last 最后一个分片之后
+ * @param parallel 同时运行的子进程数量
+ */
+static void runShards(ShardJob *job, size_t first, size_t last, size_t parallel) {
+	size_t next = first, running = 0;
+	while (next < last || running > 0) {
+		if (next < last && running < parallel) {
+			startShard(job, next++);
+			running += job->shards[next - 1].pid != 0;
+			continue;
+		}
+		int status;
+		pid_t pid = wait(&status);
+		if (pid < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		for (size_t shard = first; shard < last; shard++) {
+			Shard *target = &job->shards[shard];
+			if (target->pid != pid) {
+				continue;
+			}
+			target->pid = 0;
+			running--;
+			if (WIFSIGNALED(status)) {
+				fprintf(stderr, "分片 %zu 被信号 %d 终止.\n", shard, WTERMSIG(status));
+				target->failed = true;
+			} else if (WEXITSTATUS(status) != 0) {
+				target->failed = true;
+			}
+			collectRecords(job, shard);
+		}
+	}
+}
+
+/**
+ * @brief 排序文件编号时使用的文件大小，qsort 不支持传入上下文
+ */
+static const uint64_t *sortSizes;
+
+/**
+ * @brief 按文件大小从大到小比较两个文件编号，大小相同时按编号排序
+ */
+static int compareBySize(const void *a, const void *b) {
+	uint64_t x = sortSizes[*(const uint32_t *)a], y = sortSizes[*(const uint32_t *)b];
+	if (x != y) {
+		return x > y ? -1 : 1;
+	}
+	return *(const uint32_t *)a < *(const uint32_t *)b ? -1 : 1;
+}
+
+/**
+ * @brief 并行任务：读取文件的大小
+ * @param context ShardJob
+ */
+static void sizeTask(size_t index, int worker, void *context) {
+	(void)worker;
+	ShardJob *job = context;
+	struct stat st;
+	job->sizes[index] = stat(job->files->paths[index], &st) == 0 ? (uint64_t)st.st_size : 0;
+}
+
+/**
+ * @brief 按文件列表的顺序把各分片的数据合并为归档
+ * @param job 分片分析的状态
+ * @param archivePath 归档路径
+ * @return 成功返回 true，否则返回 false
+ */
+static bool mergeShards(const ShardJob *job, const char *archivePath) {
+	ArchiveWriter writer;
+	if (!createArchive(&writer, archivePath)) {
+		return false;
+	}
+	int *segments = reallocOrDie(NULL, job->shardCount * sizeof(int));
+	for (size_t shard = 0; shard < job->shardCount; shard++) {
+		segments[shard] = -1;
+	}
+	char *buffer = NULL;
+	size_t capacity = 0;
+	bool ok = true;
+	for (int i = 0; ok && i < job->files->count; i++) {
+		const ShardRecord *record = &job->done[i];
+		if (record->length == UINT64_MAX) {
+			continue;
+		}
+		// 同一时刻只打开一个分片的数据段，单文件分片很多时也不会耗尽文件描述符
+		if (segments[record->shard] < 0) {
+			for (size_t shard = 0; shard < job->shardCount; shard++) {
+				if (segments[shard] >= 0) {
+					close(segments[shard]);
+					segments[shard] = -1;
+				}
+			}
+			char *segmentPath = shardPath(job, record->shard, "seg");
+			segments[record->shard] = open(segmentPath, O_RDONLY);
+			free(segmentPath);
+		}
+		if (record->length > capacity) {
+			capacity = (size_t)record->length;
+			buffer = reallocOrDie(buffer, capacity);
+		}
+		ok = segments[record->shard] >= 0 &&
+		     pread(segments[record->shard], buffer, (size_t)record->length, (off_t)record->offset) ==
+		         (ssize_t)record->length;
+		if (ok) {
+			addArchiveEntry(&writer, job->files->paths[i], buffer, (size_t)record->length, record->hash);
+		}
+	}
+	for (size_t shard = 0; shard < job->shardCount; shard++) {
+		if (segments[shard] >= 0) {
+			close(segments[shard]);
+		}
+	}
+	free(segments);
+	free(buffer);
+	return finishArchive(&writer) && ok;
+}
+
+int shardLex(const char *archivePath, int shards, int count, const char *paths[]) {
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	FileList files;
+	collectFiles(&files, count, paths);
+	size_t fileCount = (size_t)files.count;
+	size_t parallel = shards > 0 ? (size_t)shards : (size_t)workerCount();
+	size_t length = strlen(archivePath) + 16;
+	char *directory = reallocOrDie(NULL, length);
+	snprintf(directory, length, "%s.shards", archivePath);
+	if (mkdir(directory, 0777) != 0 && errno != EEXIST) {
+		fprintf(stderr, "无法创建临时目录 \"%s\".\n", directory);
+		free(directory);
+		freeFileList(&files);
+		return 1;
+	}
+	ShardJob job = {&files, reallocOrDie(NULL, (fileCount + 1) * sizeof(uint64_t)), directory, NULL, 0, 0,
+	                reallocOrDie(NULL, (fileCount + 1) * sizeof(ShardRecord))};
+	for (size_t i = 0; i < fileCount; i++) {
+		job.done[i].length = UINT64_MAX;
+	}
+	parallelFor(fileCount, sizeTask, &job);
+
+	// LPT：从大到小依次分给当前总大小最小的分片
+	uint32_t *order = reallocOrDie(NULL, (fileCount + 1) * sizeof(uint32_t));
+	for (size_t i = 0; i < fileCount; i++) {
+		order[i] = (uint32_t)i;
+	}
+	sortSizes = job.sizes;
+	qsort(order, fileCount, sizeof(uint32_t), compareBySize);
+	size_t initial = parallel < fileCount ? parallel : fileCount;
+	for (size_t shard = 0; shard < initial; shard++) {
+		addShard(&job);
+	}
+	for (size_t i = 0; i < fileCount; i++) {
+		size_t lightest = 0;
+		for (size_t shard = 1; shard < initial; shard++) {
+			if (job.shards[shard].bytes < job.shards[lightest].bytes) {
+				lightest = shard;
+			}
+		}
+		addShardFile(&job, lightest, order[i]);
+	}
+	free(order);
+	runShards(&job, 0, initial, parallel);
+
+	// 异常退出的分片中没有完成的文件各自单独重试
+	for (size_t shard = 0; shard < initial; shard++) {
+		if (!job.shards[shard].failed) {
+			continue;
+		}
+		for (size_t i = 0; i < job.shards[shard].count; i++) {
+			uint32_t file = job.shards[shard].files[i];
+			if (job.done[file].length == UINT64_MAX) {
+				addShardFile(&job, addShard(&job), file);
+			}
+		}
+	}
+	size_t retried = job.shardCount - initial;
+	runShards(&job, initial, job.shardCount, parallel);
+	size_t failed = 0;
+	for (size_t i = 0; i < fileCount; i++) {
+		if (job.done[i].length == UINT64_MAX) {
+			fprintf(stderr, "无法分析文件 \"%s\"，已跳过.\n", files.paths[i]);
+			failed++;
+		}
+	}
+	bool ok = mergeShards(&job, archivePath);
+
+	for (size_t shard = 0; shard < job.shardCount; shard++) {
+		char *segmentPath = shardPath(&job, shard, "seg");
+		char *recordPath = shardPath(&job, shard, "idx");
+		unlink(segmentPath);
+		unlink(recordPath);
+		free(segmentPath);
+		free(recordPath);
+		free(job.shards[shard].files);
+	}
+	rmdir(directory);
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double elapsed = (double)(end.tv_sec - start.tv_sec) * 1e3 + (double)(end.tv_nsec - start.tv_nsec) / 1e6;
+	fprintf(stderr, "共 %zu 个文件，%zu 个分片，重试 %zu 个文件，失败 %zu 个，耗时 %.1f ms.\n", fileCount, initial,
+	        retried, failed, elapsed);
+	free(job.shards);
+	free(job.sizes);
+	free(job.done);
+	free(directory);
+	freeFileList(&files);
+	return ok && failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+/**
+ * @brief 用多个进程分片分析文件，合并为一个语料归档
+ * @details 按文件大小用 LPT 算法把文件分成 shards 个分片：从大到小依次分给当前总大小最小的分片。\n
+ * 每个分片由一个子进程分析，把各文件的二进制 Token 流写入分片的数据段，每完成一个文件追加一条记录。\n
+ * 子进程异常退出时，其中还没有完成的文件各自在单独的子进程中重试，仍然失败的文件被跳过，
+ * 一个病态输入只影响它自己。\n
+ * 最后按文件列表的顺序合并为归档，结果与分片方式和各进程完成的先后无关。
+ * @param archivePath 归档路径
+ * @param shards 分片数量，小于 1 时使用 workerCount()
+ * @param count 路径数量
+ * @param paths 路径数组，目录会被递归展开
+ * @return 全部文件都成功时返回 0，否则返回 1
+ */
+int shardLex(const char *archivePath, int shards, int count, const char *paths[]);
@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "batch.h"
+#include "stream.h"
+
+void initTokenStream(TokenStream *stream) {
+	stream->data = NULL;
+	stream->length = 0;
+	stream->capacity = 0;
+	stream->tokens = 0;
+}
+
+void freeTokenStream(TokenStream *stream) {
+	free(stream->data);
+	initTokenStream(stream);
+}
+
+/**
+ * @brief 保证 Token 流还能追加 extra 个字节
+ */
+static void reserveStream(TokenStream *stream, size_t extra) {
+	if (stream->length + extra <= stream->capacity) {
+		return;
+	}
+	size_t capacity = stream->capacity < 4096 ? 4096 : stream->capacity;
+	while (stream->length + extra > capacity) {
+		capacity *= 2;
+	}
+	stream->data = realloc(stream->data, capacity);
+	if (stream->data == NULL) {
+		fprintf(stderr, "内存不足，无法编码 Token 流.\n");
+		exit(1);
+	}
+	stream->capacity = capacity;
+}
+
+/**
+ * @brief 以 LEB128 变长编码写入一个整数，调用前需要保证至少有 10 个字节的空间
+ * @return 下一个写入位置
+ */
+static unsigned char *putVarint(unsigned char *p, uint64_t value) {
+	while (value >= 0x80) {
+		*p++ = (unsigned char)(value | 0x80);
+		value >>= 7;
+	}
+	*p++ = (unsigned char)value;
+	return p;
+}
+
+/**
+ * @brief 以小端序写入一个 64 位整数
+ */
+static void putUint64(unsigned char *p, uint64_t value) {
+	for (int i = 0; i < 8; i++) {
+		p[i] = (unsigned char)(value >> (8 * i));
+	}
+}
+
+/**
+ * @brief 以小端序读取一个 64 位整数
+ */
+static uint64_t getUint64(const unsigned char *p) {
+	uint64_t value = 0;
+	for (int i = 0; i < 8; i++) {
+		value |= (uint64_t)p[i] << (8 * i);
+	}
+	return value;
+}
+
+void encodeTokenStream(const char *source, size_t length, TokenStream *stream) {
+	TokenBuffer buffer;
+	initTokenBuffer(&buffer);
+	scanAll(source, length, SCAN_LINES | SCAN_COLUMNS | SCAN_KEYWORDS | SCAN_TRIVIA, &buffer);
+	const TriviaTable *trivia = scannerTrivia();
+	stream->length = 0;
+	stream->tokens = buffer.count - 1;
+	reserveStream(stream, TOKEN_STREAM_HEADER);
+	memcpy(stream->data, TOKEN_STREAM_MAGIC, 4);
+	memset(stream->data + 4, 0, 4);
+	putUint64(stream->data + 8, stream->tokens);
+	putUint64(stream->data + 16, length);
+	stream->length = TOKEN_STREAM_HEADER;
+	size_t cursor = 0, end = 0; // 当前位置和上一个 Token 的结尾
+	int line = 1;
+	for (size_t i = 0; i + 1 < buffer.count; i++) {
+		size_t last = i + 1 < trivia->tokenCount ? trivia->firstRun[i + 1] : trivia->runCount;
+		size_t skipped = 0;
+		for (size_t r = trivia->firstRun[i]; r < last; r++) {
+			if (TRIVIA_KIND(trivia->runs[r]) == TRIVIA_SKIPPED) {
+				skipped += TRIVIA_LENGTH(trivia->runs[r]);
+			} else {
+				cursor += TRIVIA_LENGTH(trivia->runs[r]);
+			}
+		}
+		const Token *token = &buffer.tokens[i];
+		size_t size = token->type == TOKEN_ERROR ? skipped : (size_t)token->length;
+		reserveStream(stream, 41); // 1 个类型字节和最多 4 个 10 字节的变长整数
+		unsigned char *p = stream->data + stream->length;
+		*p++ = (unsigned char)token->type;
+		p = putVarint(p, cursor - end);
+		p = putVarint(p, size);
+		p = putVarint(p, (uint64_t)(token->line - line));
+		p = putVarint(p, (uint64_t)token->column);
+		stream->length = (size_t)(p - stream->data);
+		line = token->line;
+		cursor += size;
+		end = cursor;
+	}
+	freeTokenBuffer(&buffer);
+}
+
+bool openStreamReader(StreamReader *reader, const void *data, size_t length) {
+	const unsigned char *bytes = data;
+	if (length < TOKEN_STREAM_HEADER || memcmp(bytes, TOKEN_STREAM_MAGIC, 4) != 0) {
+		return false;
+	}
+	reader->cursor = bytes + TOKEN_STREAM_HEADER;
+	reader->end = bytes + length;
+	reader->remaining = getUint64(bytes + 8);
+	reader->sourceLength = getUint64(bytes + 16);
+	reader->last = (StreamToken){0, 1, 0, 0, 0};
+	return true;
+}
+
+/**
+ * @brief 读取一个 LEB128 变长整数
+ * @return 成功返回 true，数据不完整时返回 false
+ */
+static bool getVarint(StreamReader *reader, uint64_t *value) {
+	uint64_t result = 0;
+	for (int shift = 0; shift < 64 && reader->cursor < reader->end; shift += 7) {
+		unsigned char byte = *reader->cursor++;
+		result |= (uint64_t)(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0) {
+			*value = result;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool nextStreamToken(StreamReader *reader, StreamToken *token) {
+	if (reader->remaining == 0 || reader->cursor >= reader->end) {
+		return false;
+	}
+	uint64_t type = *reader->cursor++, gap, length, lines, column;
+	if (!getVarint(reader, &gap) || !getVarint(reader, &length) || !getVarint(reader, &lines) ||
+	    !getVarint(reader, &column)) {
+		return false;
+	}
+	StreamToken *last = &reader->last;
+	token->offset = last->offset + last->length + gap;
+	token->line = last->line + (uint32_t)lines;
+	token->column = (uint32_t)column;
+	token->length = (uint32_t)length;
+	token->type = (uint32_t)type;
+	*last = *token;
+	reader->remaining--;
+	return true;
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief 二进制 Token 流的魔数
+ */
+#define TOKEN_STREAM_MAGIC "TKS1"
+
+/**
+ * @brief 二进制 Token 流文件头的字节数
+ */
+#define TOKEN_STREAM_HEADER 24
+
+/**
+ * @brief 二进制 Token 流
+ * @details 一个文件的全部 Token，与源码无关即可独立使用。格式（小端序）：\n
+ * 文件头：魔数 "TKS1"、4 字节保留、8 字节 Token 数量、8 字节源码字节数；\n
+ * 之后每个 Token 依次为：1 字节类型，以及 LEB128 编码的与上一个 Token 结尾的字节间隔、字节数、与上一个 Token 的行差和列号。\n
+ * 不包括 TOKEN_EOF，错误 Token 的字节数为其在源码中对应的字节数。
+ */
+typedef struct {
+	unsigned char *data; ///< 编码后的数据
+	size_t length;       ///< 数据的字节数
+	size_t capacity;     ///< data 的容量
+	size_t tokens;       ///< Token 数量
+} TokenStream;
+
+/**
+ * @brief 从 Token 流中解码出的 Token
+ */
+typedef struct {
+	uint64_t offset; ///< 起始字节偏移
+	uint32_t line;   ///< 所在的行，从 1 开始
+	uint32_t column; ///< 所在行的第几个字节，从 1 开始
+	uint32_t length; ///< 字节数
+	uint32_t type;   ///< TokenType
+} StreamToken;
+
+/**
+ * @brief 顺序解码 Token 流的读取器
+ */
+typedef struct {
+	const unsigned char *cursor; ///< 下一个 Token 的位置
+	const unsigned char *end;    ///< 数据的结尾
+	uint64_t remaining;          ///< 剩余的 Token 数量
+	uint64_t sourceLength;       ///< 源码的字节数
+	StreamToken last;            ///< 上一个 Token，解码相对位置时使用
+} StreamReader;
+
+/**
+ * @brief 初始化一个空的 Token 流
+ * @param stream Token 流
+ */
+void initTokenStream(TokenStream *stream);
+
+/**
+ * @brief 释放 Token 流占用的内存，并重新初始化为空
+ * @param stream Token 流
+ */
+void freeTokenStream(TokenStream *stream);
+
+/**
+ * @brief 分析源码并编码为 Token 流
+ * @details 在当前线程上以 SCAN_LINES | SCAN_COLUMNS | SCAN_KEYWORDS | SCAN_TRIVIA 扫描，
+ * 借助 Trivia 表定位每个 Token 在源码中的位置。Token 流原有的内容会被清空。
+ * @param source 源代码，必须以空字符结尾
+ * @param length 源代码的字节数
+ * @param stream 保存结果的 Token 流
+ */
+void encodeTokenStream(const char *source, size_t length, TokenStream *stream);
+
+/**
+ * @brief 开始读取 Token 流
+ * @param reader 读取器
+ * @param data Token 流的数据
+ * @param length 数据的字节数
+ * @return 文件头有效时返回 true，否则返回 false
+ */
+bool openStreamReader(StreamReader *reader, const void *data, size_t length);
+
+/**
+ * @brief 读取下一个 Token
+ * @param reader 读取器
+ * @param token 输出参数，返回解码出的 Token
+ * @return 成功返回 true；已经读完或数据损坏时返回 false
+ */
+bool nextStreamToken(StreamReader *reader, StreamToken *token);
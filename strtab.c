@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "kernels.h"
+#include "strtab.h"
+
+/**
+ * @brief 申请内存，失败时打印错误信息并退出程序
+ * @param memory 原内存，可以为 NULL
+ * @param size 需要的字节数
+ * @return 新内存
+ */
+static void *reallocOrDie(void *memory, size_t size) {
+	void *result = realloc(memory, size);
+	if (result == NULL && size > 0) {
+		fprintf(stderr, "内存不足，无法扩大字符串驻留表.\n");
+		exit(1);
+	}
+	return result;
+}
+
+void initStringTable(StringTable *table) {
+	memset(table, 0, sizeof(*table));
+}
+
+void freeStringTable(StringTable *table) {
+	free(table->slots);
+	free(table->hashes);
+	free(table->offsets);
+	free(table->lengths);
+	free(table->chars);
+	initStringTable(table);
+}
+
+/**
+ * @brief 查找字符串所在的哈希槽
+ * @param table 字符串驻留表
+ * @param text 字符串
+ * @param length 字符串的长度
+ * @param hash 字符串的哈希值
+ * @return 保存该字符串的槽，或者应该插入该字符串的空槽
+ */
+static size_t findSlot(const StringTable *table, const char *text, size_t length, uint64_t hash) {
+	size_t mask = table->slotCount - 1;
+	for (size_t slot = (size_t)hash & mask;; slot = (slot + 1) & mask) {
+		uint32_t entry = table->slots[slot];
+		if (entry == 0) {
+			return slot;
+		}
+		uint32_t id = entry - 1;
+		if (table->hashes[id] == hash && table->lengths[id] == length &&
+		    memcmp(table->chars + table->offsets[id], text, length) == 0) {
+			return slot;
+		}
+	}
+}
+
+/**
+ * @brief 把哈希槽的数量扩大一倍并重新插入所有字符串
+ * @param table 字符串驻留表
+ */
+static void growSlots(StringTable *table) {
+	size_t slotCount = table->slotCount < 1024 ? 1024 : table->slotCount * 2;
+	free(table->slots);
+	table->slots = calloc(slotCount, sizeof(uint32_t));
+	if (table->slots == NULL) {
+		fprintf(stderr, "内存不足，无法扩大字符串驻留表.\n");
+		exit(1);
+	}
+	table->slotCount = slotCount;
+	for (uint32_t id = 0; id < table->count; id++) {
+		size_t slot = (size_t)table->hashes[id] & (slotCount - 1);
+		while (table->slots[slot] != 0) {
+			slot = (slot + 1) & (slotCount - 1);
+		}
+		table->slots[slot] = id + 1;
+	}
+}
+
+uint32_t internString(StringTable *table, const char *text, size_t length) {
+	// 装载因子超过 1/2 时扩容
+	if ((size_t)table->count * 2 >= table->slotCount) {
+		growSlots(table);
+	}
+	uint64_t hash = hashBytes(text, length);
+	size_t slot = findSlot(table, text, length, hash);
+	if (table->slots[slot] != 0) {
+		return table->slots[slot] - 1;
+	}
+	if (table->count == table->capacity) {
+		table->capacity = table->capacity < 256 ? 256 : table->capacity * 2;
+		table->hashes = reallocOrDie(table->hashes, table->capacity * sizeof(uint64_t));
+		table->offsets = reallocOrDie(table->offsets, table->capacity * sizeof(size_t));
+		table->lengths = reallocOrDie(table->lengths, table->capacity * sizeof(uint32_t));
+	}
+	if (table->charCount + length > table->charCapacity) {
+		while (table->charCount + length > table->charCapacity) {
+			table->charCapacity = table->charCapacity < 4096 ? 4096 : table->charCapacity * 2;
+		}
+		table->chars = reallocOrDie(table->chars, table->charCapacity);
+	}
+	uint32_t id = table->count++;
+	memcpy(table->chars + table->charCount, text, length);
+	table->hashes[id] = hash;
+	table->offsets[id] = table->charCount;
+	table->lengths[id] = (uint32_t)length;
+	table->charCount += length;
+	table->slots[slot] = id + 1;
+	return id;
+}
+
+uint32_t findString(const StringTable *table, const char *text, size_t length) {
+	if (table->slotCount == 0) {
+		return UINT32_MAX;
+	}
+	size_t slot = findSlot(table, text, length, hashBytes(text, length));
+	return table->slots[slot] != 0 ? table->slots[slot] - 1 : UINT32_MAX;
+}
+
+const char *stringAt(const StringTable *table, uint32_t id, size_t *length) {
+	*length = table->lengths[id];
+	return table->chars + table->offsets[id];
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief 字符串驻留表
+ * @details 把相同的字符串映射到同一个编号，编号从 0 开始连续分配。\n
+ * 字符串内容复制到表内部的字符池中，调用者的源码缓冲区释放后编号依然有效。
+ */
+typedef struct {
+	uint32_t *slots;     ///< 开放寻址的哈希槽，保存编号加一，0 表示空槽
+	size_t slotCount;    ///< 哈希槽的数量，总是 2 的幂
+	uint64_t *hashes;    ///< 每个字符串的哈希值，下标为编号
+	size_t *offsets;     ///< 每个字符串在字符池中的起始位置，下标为编号
+	uint32_t *lengths;   ///< 每个字符串的长度，下标为编号
+	uint32_t count;      ///< 字符串数量
+	uint32_t capacity;   ///< 编号数组的容量
+	char *chars;         ///< 字符池
+	size_t charCount;    ///< 字符池已使用的字节数
+	size_t charCapacity; ///< 字符池的容量
+} StringTable;
+
+/**
+ * @brief 初始化一个空的字符串驻留表
+ * @param table 字符串驻留表
+ */
+void initStringTable(StringTable *table);
+
+/**
+ * @brief 释放字符串驻留表
+ * @param table 字符串驻留表
+ */
+void freeStringTable(StringTable *table);
+
+/**
+ * @brief 驻留一个字符串
+ * @param table 字符串驻留表
+ * @param text 字符串，不要求以空字符结尾
+ * @param length 字符串的长度
+ * @return 字符串的编号，相同的字符串总是得到相同的编号
+ */
+uint32_t internString(StringTable *table, const char *text, size_t length);
+
+/**
+ * @brief 查找一个字符串，不存在时不插入
+ * @param table 字符串驻留表
+ * @param text 字符串
+ * @param length 字符串的长度
+ * @return 字符串的编号，不存在时返回 UINT32_MAX
+ */
+uint32_t findString(const StringTable *table, const char *text, size_t length);
+
+/**
+ * @brief 取得编号对应的字符串
+ * @param table 字符串驻留表
+ * @param id 字符串编号
+ * @param length 输出参数，返回字符串的长度
+ * @return 字符串，不以空字符结尾，表扩容后失效
+ */
+const char *stringAt(const StringTable *table, uint32_t id, size_t *length);
@@ -0,0 +1,450 @@
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "archive.h"
+#include "files.h"
+#include "kernels.h"
+#include "parallel.h"
+#include "stream.h"
+#include "tar.h"
+
+/**
+ * @brief tar 包的块大小，成员头和成员数据都按块对齐
+ */
+#define TAR_BLOCK 512
+
+/**
+ * @brief 流式读取时每批成员的总字节数上限，达到后交给工作线程分析
+ */
+#define TAR_BATCH_BYTES (64u << 20)
+
+/**
+ * @brief 流式读取时每批成员的数量上限
+ */
+#define TAR_BATCH_MEMBERS 4096
+
+/**
+ * @brief 流式读取时需要保存数据的成员的字节数上限，更大的成员视为无效
+ */
+#define TAR_MAX_MEMBER ((uint64_t)1 << 30)
+
+/**
+ * @brief tar 包中的一个待分析成员
+ */
+typedef struct {
+	char *path;       ///< 成员路径
+	const char *data; ///< 成员数据，流式读取时单独分配并以空字符结尾
+	uint64_t size;    ///< 成员的字节数
+	bool terminated;  ///< data[size] 是否可以读取并且是空字符
+	bool owned;       ///< data 是否需要释放
+} TarMember;
+
+/**
+ * @brief tar 包的读取状态
+ */
+typedef struct {
+	int fd;                         ///< 输入的文件描述符
+	const unsigned char *map;       ///< mmap 的内容，流式读取时为 NULL
+	uint64_t size;                  ///< mmap 的字节数
+	uint64_t offset;                ///< 已经读取的字节数
+	unsigned char block[TAR_BLOCK]; ///< 流式读取时的当前块
+	bool truncated;                 ///< 是否遇到了不完整的数据
+} TarInput;
+
+/**
+ * @brief 一批成员的并行分析状态
+ */
+typedef struct {
+	TarMember *members;    ///< 成员
+	size_t count;          ///< 成员数量
+	size_t capacity;       ///< members 的容量
+	uint64_t bytes;        ///< 成员的总字节数
+	size_t *copied;        ///< 每个工作线程因为没有结尾空字符而复制的成员数量
+	ArchiveWriter *writer; ///< 写入器
+} TarBatch;
+
+/**
+ * @brief 重新分配内存，失败时打印错误信息并退出程序
+ */
+static void *reallocOrDie(void *memory, size_t size) {
+	void *result = realloc(memory, size > 0 ? size : 1);
+	if (result == NULL) {
+		fprintf(stderr, "内存不足，无法读取 tar 包.\n");
+		exit(1);
+	}
+	return result;
+}
+
+/**
+ * @brief 从描述符读取恰好 length 个字节
+ * @return 读满返回 true，遇到文件结尾或错误返回 false
+ */
+static bool readFully(int fd, void *buffer, size_t length) {
+	char *p = buffer;
+	while (length > 0) {
+		ssize_t n = read(fd, p, length);
+		if (n <= 0) {
+			return false;
+		}
+		p += n;
+		length -= (size_t)n;
+	}
+	return true;
+}
+
+/**
+ * @brief 读取下一个块
+ * @return 块的内容，已经没有完整的块时返回 NULL
+ */
+static const unsigned char *readBlock(TarInput *in) {
+	if (in->map != NULL) {
+		if (in->size - in->offset < TAR_BLOCK) {
+			return NULL;
+		}
+		in->offset += TAR_BLOCK;
+		return in->map + in->offset - TAR_BLOCK;
+	}
+	if (!readFully(in->fd, in->block, TAR_BLOCK)) {
+		return NULL;
+	}
+	in->offset += TAR_BLOCK;
+	return in->block;
+}
+
+/**
+ * @brief 读取成员数据并跳过其后的填充
+ * @details mmap 时直接返回映射中的位置；流式读取时分配 size + 1 字节并以空字符结尾。
+ * keep 为 false 时流式读取只跳过数据，返回 NULL。调用者负责保证 size 不会使对齐计算溢出，
+ * 并且需要保存的数据不超过 TAR_MAX_MEMBER。
+ * @param in 读取状态
+ * @param size 成员的字节数
+ * @param keep 是否需要数据
+ * @param owned 输出参数，返回的数据是否需要释放
+ * @return 成员数据，数据不完整时返回 NULL 并设置 truncated
+ */
+static const char *readData(TarInput *in, uint64_t size, bool keep, bool *owned) {
+	*owned = false;
+	if (in->map != NULL) {
+		// 先比较未对齐的大小，避免取整时溢出；填充不完整时读到映射结尾为止
+		if (size > in->size - in->offset) {
+			in->truncated = true;
+			return NULL;
+		}
+		uint64_t padded = (size + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK;
+		const char *data = (const char *)in->map + in->offset;
+		in->offset += padded < in->size - in->offset ? padded : in->size - in->offset;
+		return data;
+	}
+	uint64_t padded = (size + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK;
+	char *data = NULL;
+	if (keep) {
+		data = reallocOrDie(NULL, (size_t)size + 1);
+		if (!readFully(in->fd, data, (size_t)size)) {
+			free(data);
+			in->truncated = true;
+			return NULL;
+		}
+		data[size] = '\0';
+		*owned = true;
+	}
+	// 剩余部分（或者不需要的整个成员）逐块读取后丢弃
+	uint64_t skip = keep ? padded - size : padded;
+	while (skip > 0) {
+		size_t n = skip < TAR_BLOCK ? (size_t)skip : TAR_BLOCK;
+		if (!readFully(in->fd, in->block, n)) {
+			free(data);
+			*owned = false;
+			in->truncated = true;
+			return NULL;
+		}
+		skip -= n;
+	}
+	in->offset += padded;
+	return data;
+}
+
+/**
+ * @brief 解析成员头中的数字字段
+ * @details 通常为八进制文本；GNU 格式中首字节最高位为 1 时，其余部分为大端序的二进制整数。
+ */
+static uint64_t parseNumber(const unsigned char *field, size_t length) {
+	uint64_t value = 0;
+	if (field[0] & 0x80) {
+		for (size_t i = 1; i < length; i++) {
+			value = value << 8 | field[i];
+		}
+		return value;
+	}
+	size_t i = 0;
+	while (i < length && field[i] == ' ') {
+		i++;
+	}
+	for (; i < length && field[i] >= '0' && field[i] <= '7'; i++) {
+		value = value << 3 | (uint64_t)(field[i] - '0');
+	}
+	return value;
+}
+
+/**
+ * @brief 校验成员头的校验和，计算时校验和字段本身按 8 个空格计
+ */
+static bool validHeader(const unsigned char *header) {
+	uint64_t sum = 0;
+	for (size_t i = 0; i < TAR_BLOCK; i++) {
+		sum += i >= 148 && i < 156 ? ' ' : header[i];
+	}
+	return sum == parseNumber(header + 148, 8);
+}
+
+/**
+ * @brief 复制最多 length 个字节的字段，遇到空字符提前结束
+ */
+static char *copyField(const char *field, size_t length) {
+	size_t n = strnlen(field, length);
+	char *text = reallocOrDie(NULL, n + 1);
+	memcpy(text, field, n);
+	text[n] = '\0';
+	return text;
+}
+
+/**
+ * @brief 从 pax 扩展头中取出 path 和 size
+ * @details 每条记录的格式为 "长度 键=值\n"，长度包括记录本身的全部字节。
+ * @param data 扩展头的数据
+ * @param length 数据的字节数
+ * @param path 输入输出参数，存在 path 记录时替换为新分配的路径
+ * @param size 输入输出参数，存在 size 记录时替换
+ */
+static void parsePax(const char *data, uint64_t length, char **path, uint64_t *size) {
+	const char *p = data, *end = data + length;
+	while (p < end) {
+		uint64_t recordLength = 0;
+		const char *q = p;
+		while (q < end && *q >= '0' && *q <= '9') {
+			recordLength = recordLength * 10 + (uint64_t)(*q++ - '0');
+		}
+		if (q == p || q >= end || *q != ' ' || recordLength > (uint64_t)(end - p) || p + recordLength <= q + 1) {
+			return;
+		}
+		const char *key = q + 1, *recordEnd = p + recordLength;
+		const char *equal = memchr(key, '=', (size_t)(recordEnd - key));
+		if (equal != NULL && recordEnd[-1] == '\n') {
+			size_t keyLength = (size_t)(equal - key), valueLength = (size_t)(recordEnd - 1 - (equal + 1));
+			if (keyLength == 4 && memcmp(key, "path", 4) == 0) {
+				free(*path);
+				*path = copyField(equal + 1, valueLength);
+			} else if (keyLength == 4 && memcmp(key, "size", 4) == 0) {
+				*size = strtoull(equal + 1, NULL, 10);
+			}
+		}
+		p = recordEnd;
+	}
+}
+
+/**
+ * @brief 分析一个成员，预留区域后写入归档
+ * @param index 成员编号
+ * @param worker 工作线程编号
+ * @param context TarBatch
+ */
+static void memberTask(size_t index, int worker, void *context) {
+	TarBatch *batch = context;
+	const TarMember *member = &batch->members[index];
+	const char *source = member->data;
+	char *copy = NULL;
+	// 扫描器要求源码以空字符结尾，只有数据恰好填满最后一块时才需要复制
+	if (!member->terminated) {
+		copy = reallocOrDie(NULL, (size_t)member->size + 1);
+		memcpy(copy, member->data, (size_t)member->size);
+		copy[member->size] = '\0';
+		source = copy;
+		batch->copied[worker]++;
+	}
+	TokenStream stream;
+	initTokenStream(&stream);
+	encodeTokenStream(source, (size_t)member->size, &stream);
+	uint64_t offset = reserveArchiveRegion(batch->writer, member->path, stream.length, 0,
+	                                       hashBytes(source, (size_t)member->size));
+	writeArchiveRegion(batch->writer, offset, stream.data, stream.length);
+	freeTokenStream(&stream);
+	free(copy);
+}
+
+/**
+ * @brief 并行分析当前一批成员，然后清空这一批
+ */
+static void flushBatch(TarBatch *batch) {
+	parallelFor(batch->count, memberTask, batch);
+	for (size_t i = 0; i < batch->count; i++) {
+		free(batch->members[i].path);
+		if (batch->members[i].owned) {
+			free((char *)batch->members[i].data);
+		}
+	}
+	batch->count = 0;
+	batch->bytes = 0;
+}
+
+int lexTar(const char *archivePath, const char *tarPath) {
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	TarInput in;
+	memset(&in, 0, sizeof(in));
+	in.fd = strcmp(tarPath, "-") == 0 ? STDIN_FILENO : open(tarPath, O_RDONLY | O_CLOEXEC);
+	if (in.fd < 0) {
+		fprintf(stderr, "无法打开 tar 包 \"%s\".\n", tarPath);
+		return 1;
+	}
+	// 普通文件（包括重定向到标准输入的文件）整体映射，管道只能流式读取
+	struct stat st;
+	if (fstat(in.fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+		void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, in.fd, 0);
+		if (map != MAP_FAILED) {
+			in.map = map;
+			in.size = (uint64_t)st.st_size;
+			madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+		}
+	}
+	ArchiveWriter writer;
+	if (!createArchive(&writer, archivePath)) {
+		if (in.map != NULL) {
+			munmap((void *)in.map, (size_t)in.size);
+		}
+		if (in.fd != STDIN_FILENO) {
+			close(in.fd);
+		}
+		return 1;
+	}
+	TarBatch batch = {NULL, 0, 0, 0, reallocOrDie(NULL, (size_t)workerCount() * sizeof(size_t)), &writer};
+	memset(batch.copied, 0, (size_t)workerCount() * sizeof(size_t));
+	size_t members = 0;
+	uint64_t bytes = 0;
+	const char *problem = NULL;
+	char *longName = NULL, *paxPath = NULL;
+	uint64_t paxSize = UINT64_MAX;
+	const unsigned char *header;
+	while ((header = readBlock(&in)) != NULL) {
+		if (header[0] == '\0') {
+			break; // 全零块表示 tar 包结束
+		}
+		if (!validHeader(header)) {
+			problem = "出现无效的成员头";
+			break;
+		}
+		char type = (char)header[156];
+		uint64_t size = parseNumber(header + 124, 12);
+		bool extension = type == 'x' || type == 'g' || type == 'L' || type == 'K';
+		if (!extension && paxSize != UINT64_MAX) {
+			size = paxSize;
+		}
+		bool regular = type == '0' || type == '\0' || type == '7';
+		char *path = NULL;
+		if (regular) {
+			if (paxPath != NULL) {
+				path = paxPath;
+				paxPath = NULL;
+			} else if (longName != NULL) {
+				path = longName;
+				longName = NULL;
+			} else {
+				const char *name = (const char *)header, *prefix = (const char *)header + 345;
+				// ustar 把超过 100 字节的路径拆成前缀和名称两部分
+				if (memcmp(header + 257, "ustar\0", 6) == 0 && prefix[0] != '\0') {
+					size_t prefixLength = strnlen(prefix, 155), nameLength = strnlen(name, 100);
+					path = reallocOrDie(NULL, prefixLength + nameLength + 2);
+					memcpy(path, prefix, prefixLength);
+					path[prefixLength] = '/';
+					memcpy(path + prefixLength + 1, name, nameLength);
+					path[prefixLength + nameLength + 1] = '\0';
+				} else {
+					path = copyField(name, 100);
+				}
+			}
+		}
+		bool lex = regular && isSourceName(path);
+		bool keep = lex || type == 'L' || type == 'x';
+		// 成员头和 pax 扩展头中的大小都不可信，对齐和分配之前先检查
+		if (size > UINT64_MAX - TAR_BLOCK || size > SIZE_MAX - TAR_BLOCK ||
+		    (in.map == NULL && keep && size > TAR_MAX_MEMBER)) {
+			problem = "出现无效的成员大小";
+			free(path);
+			break;
+		}
+		uint64_t dataOffset = in.offset;
+		bool owned;
+		const char *data = readData(&in, size, keep, &owned);
+		if (in.truncated) {
+			problem = "意外结束";
+			free(path);
+			break;
+		}
+		if (type == 'L') {
+			free(longName);
+			longName = copyField(data, (size_t)size);
+		} else if (type == 'x') {
+			paxSize = UINT64_MAX;
+			parsePax(data, size, &paxPath, &paxSize);
+		}
+		if (!extension) {
+			// 扩展头只作用于紧随其后的一个成员
+			free(longName);
+			free(paxPath);
+			longName = paxPath = NULL;
+			paxSize = UINT64_MAX;
+		}
+		if (!lex) {
+			if (owned) {
+				free((char *)data);
+			}
+			free(path);
+			continue;
+		}
+		if (batch.count == batch.capacity) {
+			batch.capacity = batch.capacity > 0 ? batch.capacity * 2 : 256;
+			batch.members = reallocOrDie(batch.members, batch.capacity * sizeof(TarMember));
+		}
+		// 数据之后的填充字节已经是空字符时，扫描器可以直接在映射上工作
+		bool terminated = owned || (dataOffset + size < in.size && in.map[dataOffset + size] == '\0');
+		batch.members[batch.count++] = (TarMember){path, data, size, terminated, owned};
+		batch.bytes += size;
+		members++;
+		bytes += size;
+		if (in.map == NULL && (batch.bytes >= TAR_BATCH_BYTES || batch.count >= TAR_BATCH_MEMBERS)) {
+			flushBatch(&batch);
+		}
+	}
+	flushBatch(&batch);
+	free(longName);
+	free(paxPath);
+	if (problem != NULL) {
+		fprintf(stderr, "tar 包 \"%s\" 在第 %" PRIu64 " 字节处%s.\n", tarPath, in.offset, problem);
+	}
+	bool ok = finishArchive(&writer) && problem == NULL;
+	size_t copied = 0;
+	for (int worker = 0; worker < workerCount(); worker++) {
+		copied += batch.copied[worker];
+	}
+	free(batch.copied);
+	free(batch.members);
+	if (in.map != NULL) {
+		munmap((void *)in.map, (size_t)in.size);
+	}
+	if (in.fd != STDIN_FILENO) {
+		close(in.fd);
+	}
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double elapsed = (double)(end.tv_sec - start.tv_sec) * 1e3 + (double)(end.tv_nsec - start.tv_nsec) / 1e6;
+	fprintf(stderr, "共 %zu 个成员，%" PRIu64 " 字节，%s，复制 %zu 个，耗时 %.1f ms.\n", members, bytes,
+	        in.map != NULL ? "mmap" : "流式读取", copied, elapsed);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+/**
+ * @brief 直接分析 tar 包中的源文件，写入语料归档
+ * @details 支持 ustar、GNU 长文件名和 pax 扩展头。输入是普通文件时通过 mmap 读取，
+ * 成员数据之后的填充字节正好是空字符时直接在映射上分析，不复制数据；否则按顺序流式读取，
+ * 每积累一批成员就分给工作线程分析。\n
+ * 只分析扩展名为 .c 或 .h 的普通文件成员，结果以成员路径为键写入归档。
+ * @param archivePath 归档路径
+ * @param tarPath tar 包路径，"-" 表示标准输入
+ * @return 成功返回 0，失败返回 1
+ */
+int lexTar(const char *archivePath, const char *tarPath);
@@ -1,3 +1,11 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "arena.h"
 #include "tools.h"
 
 char *convert_to_str(Token token) {
@@ -79,3 +87,55 @@ char *convert_to_str(Token token) {
 		default: return "未知";
 	}
 }
+
+char *tryReadFile(const char *path, size_t *length) {
+	// O_NONBLOCK 避免在 FIFO 上阻塞，打开后只接受普通文件
+	int fd = open(path, O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+	if (fd < 0) {
+		fprintf(stderr, "无法打开文件 \"%s\".\n", path);
+		return NULL;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+		fprintf(stderr, "\"%s\" 不是普通文件.\n", path);
+		close(fd);
+		return NULL;
+	}
+
+	size_t size = (size_t)st.st_size, done = 0;
+	char *buffer = acquireBuffer(size + 1, NULL); // 从缓冲池取得缓冲区，多文件时复用
+	while (done < size) {
+		ssize_t n = read(fd, buffer + done, size - done);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			break;
+		}
+		done += (size_t)n;
+	}
+	close(fd);
+	if (done < size) {
+		// 读取期间文件被截断或读取出错
+		fprintf(stderr, "无法读取文件 \"%s\" 的全部内容.\n", path);
+		releaseBuffer(buffer, size + 1);
+		return NULL;
+	}
+	buffer[size] = '\0';
+	if (length != NULL) {
+		*length = size;
+	}
+	return buffer;
+}
+
+char *readFile(const char *path, size_t *length) {
+	char *buffer = tryReadFile(path, length);
+	if (buffer == NULL) {
+		exit(1);
+	}
+	return buffer;
+}
+
+void releaseFile(char *source, size_t length) {
+	releaseBuffer(source, length + 1);
+}
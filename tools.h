@@ -1,4 +1,6 @@
 #pragma once
+#include <stddef.h>
+
 #include "scanner.h"
 /**
  * @brief 将 Token 转换为其字符串表示形式。
@@ -7,4 +9,32 @@
  * @return 返回一个指向描述 Token 的字符串的指针。
  * @note 返回的字符串是静态分配的，因此调用者不需要释放内存。
  */
-char *convert_to_str(Token token);
\ No newline at end of file
+char *convert_to_str(Token token);
+
+/**
+ * @brief 从文件读取内容到内存。
+ * @param path 文件路径。
+ * @param length 输出参数，返回文件的字节数，可以为 NULL。
+ * @return 从当前线程缓冲池取得的字符串，包含文件的全部字符信息，末尾有一个空字符。
+ * @note 使用者负责调用 releaseFile 归还返回的内存。读取失败时打印错误信息并退出程序。
+ */
+char *readFile(const char *path, size_t *length);
+
+/**
+ * @brief 从文件读取内容到内存，失败时不退出程序。
+ * @details 与 readFile 相同，但文件无法打开、不是普通文件或读取期间被截断时打印错误信息并返回 NULL，
+ * 适合在工作线程中使用。
+ * @param path 文件路径。
+ * @param length 输出参数，返回文件的字节数，可以为 NULL。
+ * @return 从当前线程缓冲池取得的字符串，失败时返回 NULL。
+ * @note 使用者负责调用 releaseFile 归还返回的内存。
+ */
+char *tryReadFile(const char *path, size_t *length);
+
+/**
+ * @brief 归还 readFile 返回的内存。
+ * @details 内存回到当前线程的缓冲池，读取下一个文件时复用。
+ * @param source readFile 返回的字符串。
+ * @param length readFile 返回的文件字节数。
+ */
+void releaseFile(char *source, size_t length);
\ No newline at end of file
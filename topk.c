@@ -0,0 +1,305 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "files.h"
+#include "kernels.h"
+#include "parallel.h"
+#include "scanner.h"
+#include "tools.h"
+#include "topk.h"
+
+/**
+ * @brief 每批扫描的 Token 数量
+ */
+#define TOPK_BATCH 1024
+
+/**
+ * @brief 申请内存，失败时打印错误信息并退出程序
+ */
+static void *allocateOrDie(size_t size) {
+	void *result = calloc(size > 0 ? size : 1, 1);
+	if (result == NULL) {
+		fprintf(stderr, "内存不足，无法统计 Token 频率.\n");
+		exit(1);
+	}
+	return result;
+}
+
+void initHeavyHitters(HeavyHitters *hitters, uint32_t capacity) {
+	uint32_t slots = 16;
+	while (slots < capacity * 2) {
+		slots *= 2;
+	}
+	hitters->counters = allocateOrDie(capacity * sizeof(HeavyCounter));
+	hitters->heap = allocateOrDie(capacity * sizeof(uint32_t));
+	hitters->position = allocateOrDie(capacity * sizeof(uint32_t));
+	hitters->slots = allocateOrDie(slots * sizeof(uint32_t));
+	hitters->slotMask = slots - 1;
+	hitters->count = 0;
+	hitters->capacity = capacity;
+	hitters->total = 0;
+}
+
+void freeHeavyHitters(HeavyHitters *hitters) {
+	free(hitters->counters);
+	free(hitters->heap);
+	free(hitters->position);
+	free(hitters->slots);
+	memset(hitters, 0, sizeof(HeavyHitters));
+}
+
+/**
+ * @brief 计数器的次数增加后，把它在最小堆中向下移动到正确的位置
+ * @param hitters 统计结构
+ * @param index 计数器在堆中的位置
+ */
+static void siftDown(HeavyHitters *hitters, uint32_t index) {
+	uint32_t *heap = hitters->heap;
+	uint32_t moving = heap[index];
+	uint64_t count = hitters->counters[moving].count;
+	for (;;) {
+		uint32_t child = index * 2 + 1;
+		if (child >= hitters->count) {
+			break;
+		}
+		if (child + 1 < hitters->count && hitters->counters[heap[child + 1]].count < hitters->counters[heap[child]].count) {
+			child++;
+		}
+		if (hitters->counters[heap[child]].count >= count) {
+			break;
+		}
+		heap[index] = heap[child];
+		hitters->position[heap[index]] = index;
+		index = child;
+	}
+	heap[index] = moving;
+	hitters->position[moving] = index;
+}
+
+/**
+ * @brief 查找哈希值对应的哈希槽
+ * @return 保存该哈希值的槽，不存在时为应当插入的空槽
+ */
+static uint32_t findSlot(const HeavyHitters *hitters, uint64_t hash) {
+	uint32_t slot = (uint32_t)hash & hitters->slotMask;
+	while (hitters->slots[slot] != 0 && hitters->counters[hitters->slots[slot] - 1].hash != hash) {
+		slot = (slot + 1) & hitters->slotMask;
+	}
+	return slot;
+}
+
+/**
+ * @brief 从哈希表中删除一个槽，把后面同一探测序列上的槽前移，避免留下墓碑
+ */
+static void removeSlot(HeavyHitters *hitters, uint32_t slot) {
+	uint32_t mask = hitters->slotMask;
+	uint32_t next = (slot + 1) & mask;
+	while (hitters->slots[next] != 0) {
+		uint32_t home = (uint32_t)hitters->counters[hitters->slots[next] - 1].hash & mask;
+		// home 不在 (slot, next] 范围内时，该元素可以移到 slot
+		if (((next - home) & mask) >= ((next - slot) & mask)) {
+			hitters->slots[slot] = hitters->slots[next];
+			slot = next;
+		}
+		next = (next + 1) & mask;
+	}
+	hitters->slots[slot] = 0;
+}
+
+void addHeavyHitter(HeavyHitters *hitters, const char *text, size_t length) {
+	uint64_t hash = hashBytes(text, length);
+	hitters->total++;
+	uint32_t slot = findSlot(hitters, hash);
+	uint32_t index;
+	if (hitters->slots[slot] != 0) {
+		index = hitters->slots[slot] - 1;
+		hitters->counters[index].count++;
+		siftDown(hitters, hitters->position[index]);
+		return;
+	}
+	if (hitters->count < hitters->capacity) {
+		// 新计数器的次数为 1，不大于堆中任何计数器，从堆尾上移到根
+		index = hitters->count++;
+		hitters->counters[index] = (HeavyCounter){hash, 1, 0, 0, {0}};
+		for (uint32_t i = index; i > 0; i = (i - 1) / 2) {
+			hitters->heap[i] = hitters->heap[(i - 1) / 2];
+			hitters->position[hitters->heap[i]] = i;
+		}
+		hitters->heap[0] = index;
+		hitters->position[index] = 0;
+	} else {
+		// 替换次数最少的计数器，继承其次数作为误差
+		index = hitters->heap[0];
+		removeSlot(hitters, findSlot(hitters, hitters->counters[index].hash));
+		slot = findSlot(hitters, hash);
+		uint64_t minimum = hitters->counters[index].count;
+		hitters->counters[index] = (HeavyCounter){hash, minimum + 1, minimum, 0, {0}};
+	}
+	HeavyCounter *counter = &hitters->counters[index];
+	counter->length = (uint32_t)length;
+	memcpy(counter->text, text, length < HEAVY_TEXT_MAX ? length : HEAVY_TEXT_MAX);
+	hitters->slots[slot] = index + 1;
+	siftDown(hitters, 0);
+}
+
+/**
+ * @brief 按哈希值比较两个计数器
+ */
+static int compareHashes(const void *a, const void *b) {
+	const HeavyCounter *x = a, *y = b;
+	return x->hash < y->hash ? -1 : x->hash > y->hash;
+}
+
+/**
+ * @brief 按次数从高到低比较两个计数器，次数相同时按哈希值排序以保证结果稳定
+ */
+static int compareCounts(const void *a, const void *b) {
+	const HeavyCounter *x = a, *y = b;
+	if (x->count != y->count) {
+		return x->count > y->count ? -1 : 1;
+	}
+	return compareHashes(a, b);
+}
+
+size_t mergeHeavyHitters(const HeavyHitters *parts, size_t count, HeavyCounter *top, size_t limit) {
+	// 计数器已满的结构中，没有保存的元素的次数不超过该结构的最小次数；未满的结构则一定没有出现过该元素
+	size_t total = 0;
+	uint64_t missing = 0; // 所有已满结构的最小次数之和
+	for (size_t i = 0; i < count; i++) {
+		total += parts[i].count;
+		if (parts[i].count == parts[i].capacity && parts[i].count > 0) {
+			missing += parts[i].counters[parts[i].heap[0]].count;
+		}
+	}
+	HeavyCounter *all = allocateOrDie(total * sizeof(HeavyCounter));
+	size_t n = 0;
+	for (size_t i = 0; i < count; i++) {
+		// 先按出现在所有结构中补上最小次数，合并同一元素时再减去其实际出现过的结构的部分
+		uint64_t floor = parts[i].count == parts[i].capacity && parts[i].count > 0
+		                     ? parts[i].counters[parts[i].heap[0]].count
+		                     : 0;
+		for (uint32_t j = 0; j < parts[i].count; j++) {
+			all[n] = parts[i].counters[j];
+			all[n].count += missing - floor;
+			all[n].error += missing - floor;
+			n++;
+		}
+	}
+	qsort(all, n, sizeof(HeavyCounter), compareHashes);
+	size_t merged = 0;
+	for (size_t start = 0; start < n;) {
+		// 同一结构中的哈希值互不相同，因此同组的计数器来自不同的结构
+		HeavyCounter sum = all[start];
+		size_t end = start + 1;
+		while (end < n && all[end].hash == all[start].hash) {
+			sum.count += all[end].count - missing;
+			sum.error += all[end].error - missing;
+			end++;
+		}
+		all[merged++] = sum;
+		start = end;
+	}
+	qsort(all, merged, sizeof(HeavyCounter), compareCounts);
+	size_t result = merged < limit ? merged : limit;
+	memcpy(top, all, result * sizeof(HeavyCounter));
+	free(all);
+	return result;
+}
+
+/**
+ * @brief 并行统计时的共享状态
+ */
+typedef struct {
+	const FileList *files;     ///< 文件列表
+	HeavyHitters *identifiers; ///< 每个工作线程的标识符统计
+	HeavyHitters *strings;     ///< 每个工作线程的字符串字面量统计
+} TopJob;
+
+/**
+ * @brief 扫描一个文件，把标识符和字符串字面量加入当前工作线程的统计结构
+ * @param index 文件编号
+ * @param worker 工作线程编号
+ * @param context TopJob
+ */
+static void topTask(size_t index, int worker, void *context) {
+	TopJob *job = context;
+	size_t length;
+	char *source = tryReadFile(job->files->paths[index], &length);
+	if (source == NULL) {
+		return; // 错误信息已由 tryReadFile 输出，跳过该文件
+	}
+	if (looksBinary(source, length)) {
+		releaseFile(source, length);
+		return;
+	}
+	HeavyHitters *identifiers = &job->identifiers[worker], *strings = &job->strings[worker];
+	Token tokens[TOPK_BATCH];
+	initScannerWithFeatures(source, SCAN_KEYWORDS);
+	for (bool done = false; !done;) {
+		size_t count = scanTokens(tokens, TOPK_BATCH);
+		for (size_t i = 0; i < count; i++) {
+			if (tokens[i].type == TOKEN_IDENTIFIER) {
+				addHeavyHitter(identifiers, tokens[i].start, (size_t)tokens[i].length);
+			} else if (tokens[i].type == TOKEN_STRING) {
+				addHeavyHitter(strings, tokens[i].start, (size_t)tokens[i].length);
+			}
+		}
+		done = count == 0 || tokens[count - 1].type == TOKEN_EOF;
+	}
+	releaseFile(source, length);
+}
+
+/**
+ * @brief 合并并输出一类元素的统计结果
+ * @param title 标题
+ * @param parts 每个工作线程的统计结构
+ * @param count 统计结构的数量
+ * @param limit 输出的元素数量
+ * @param out 输出目标
+ */
+static void printTop(const char *title, const HeavyHitters *parts, size_t count, size_t limit, FILE *out) {
+	uint64_t total = 0, bound = 0;
+	size_t stored = 0;
+	for (size_t i = 0; i < count; i++) {
+		total += parts[i].total;
+		bound += parts[i].total / parts[i].capacity;
+		stored += parts[i].count;
+	}
+	// 合并后的元素不会多于各结构保存的计数器总数，limit 来自命令行，不能直接按它申请内存
+	if (limit > stored) {
+		limit = stored;
+	}
+	HeavyCounter *top = allocateOrDie(limit * sizeof(HeavyCounter));
+	size_t found = mergeHeavyHitters(parts, count, top, limit);
+	fprintf(out, "%s：共 %llu 次，估计值的误差不超过 %llu\n", title, (unsigned long long)total,
+	        (unsigned long long)bound);
+	for (size_t i = 0; i < found; i++) {
+		const HeavyCounter *counter = &top[i];
+		int shown = counter->length < HEAVY_TEXT_MAX ? (int)counter->length : HEAVY_TEXT_MAX;
+		fprintf(out, "%12llu  ±%-8llu %.*s%s\n", (unsigned long long)counter->count, (unsigned long long)counter->error,
+		        shown, counter->text, counter->length > HEAVY_TEXT_MAX ? "..." : "");
+	}
+	free(top);
+}
+
+void reportTopTokens(size_t limit, uint32_t capacity, int count, const char *paths[], FILE *out) {
+	FileList files;
+	collectFiles(&files, count, paths);
+	size_t workers = (size_t)workerCount();
+	TopJob job = {&files, allocateOrDie(workers * sizeof(HeavyHitters)), allocateOrDie(workers * sizeof(HeavyHitters))};
+	for (size_t i = 0; i < workers; i++) {
+		initHeavyHitters(&job.identifiers[i], capacity);
+		initHeavyHitters(&job.strings[i], capacity);
+	}
+	parallelFor((size_t)files.count, topTask, &job);
+	printTop("标识符", job.identifiers, workers, limit, out);
+	printTop("字符串字面量", job.strings, workers, limit, out);
+	for (size_t i = 0; i < workers; i++) {
+		freeHeavyHitters(&job.identifiers[i]);
+		freeHeavyHitters(&job.strings[i]);
+	}
+	free(job.identifiers);
+	free(job.strings);
+	freeFileList(&files);
+}
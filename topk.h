@@ -0,0 +1,80 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @brief 计数器中保存的字符序列的最大长度，更长的内容只保存前缀，但仍按完整内容的哈希值区分
+ */
+#define HEAVY_TEXT_MAX 60
+
+/**
+ * @brief SpaceSaving 算法的一个计数器
+ */
+typedef struct {
+	uint64_t hash;             ///< 完整字符序列的哈希值，用于区分不同的元素
+	uint64_t count;            ///< 估计的出现次数，不小于真实次数
+	uint64_t error;            ///< 估计值的最大误差，真实次数不小于 count - error
+	uint32_t length;           ///< 完整字符序列的长度
+	char text[HEAVY_TEXT_MAX]; ///< 字符序列的前缀
+} HeavyCounter;
+
+/**
+ * @brief 用固定内存近似统计出现最频繁的元素
+ * @details SpaceSaving 算法：保存 capacity 个计数器，新元素在计数器用完时替换次数最少的一个，
+ * 并继承其次数作为误差。任何出现次数超过 总数 / capacity 的元素都一定被保存，且每个估计值的误差不超过 总数 / capacity。\n
+ * 计数器按次数组织为最小堆，用开放寻址的哈希表按哈希值查找计数器，每次更新的代价为 O(log capacity)。
+ */
+typedef struct {
+	HeavyCounter *counters; ///< 计数器数组
+	uint32_t *heap;         ///< 按次数排列的最小堆，保存计数器下标
+	uint32_t *position;     ///< 每个计数器在堆中的位置
+	uint32_t *slots;        ///< 哈希槽，保存计数器下标加一，0 表示空槽
+	uint32_t slotMask;      ///< 哈希槽数量减一，槽数量为不小于 2 * capacity 的 2 的幂
+	uint32_t count;         ///< 已使用的计数器数量
+	uint32_t capacity;      ///< 计数器数量上限
+	uint64_t total;         ///< 已统计的元素总数
+} HeavyHitters;
+
+/**
+ * @brief 初始化统计结构
+ * @param hitters 统计结构
+ * @param capacity 计数器数量，决定内存占用和误差上限
+ */
+void initHeavyHitters(HeavyHitters *hitters, uint32_t capacity);
+
+/**
+ * @brief 释放统计结构
+ * @param hitters 统计结构
+ */
+void freeHeavyHitters(HeavyHitters *hitters);
+
+/**
+ * @brief 统计一次出现
+ * @param hitters 统计结构
+ * @param text 字符序列
+ * @param length 字符序列的长度
+ */
+void addHeavyHitter(HeavyHitters *hitters, const char *text, size_t length);
+
+/**
+ * @brief 合并多个统计结构，得到出现最频繁的元素
+ * @details 按照可合并摘要的方法，某个统计结构中没有的元素，其次数和误差按该结构的最小次数补上，因此合并后的估计值仍不小于真实次数
+ * @param parts 统计结构数组
+ * @param count 统计结构的数量
+ * @param top 输出数组，按估计次数从高到低排列
+ * @param limit 输出数组的容量
+ * @return 写入 top 的元素数量
+ */
+size_t mergeHeavyHitters(const HeavyHitters *parts, size_t count, HeavyCounter *top, size_t limit);
+
+/**
+ * @brief 统计一组文件中出现最频繁的标识符和字符串字面量
+ * @details 各文件并行扫描，每个工作线程有各自的统计结构，最后合并并输出前 limit 个元素及其误差上限
+ * @param limit 输出的元素数量
+ * @param capacity 每个统计结构的计数器数量
+ * @param count 路径数量
+ * @param paths 路径数组，目录会被递归展开
+ * @param out 输出目标
+ */
+void reportTopTokens(size_t limit, uint32_t capacity, int count, const char *paths[], FILE *out);
@@ -0,0 +1,402 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "files.h"
+#include "kernels.h"
+#include "parallel.h"
+#include "stream.h"
+#include "strtab.h"
+#include "tools.h"
+#include "tree.h"
+
+/**
+ * @brief 清单文件第一行的前缀，其后为写入清单的时间
+ */
+#define MANIFEST_HEADER "# tokenizer manifest 1 "
+
+/**
+ * @brief 文件在清单中的记录
+ */
+typedef struct {
+	uint64_t hash;  ///< 内容哈希
+	uint64_t inode; ///< inode 编号
+	uint64_t size;  ///< 字节数
+	int64_t mtime;  ///< 修改时间，单位为纳秒
+} ManifestEntry;
+
+/**
+ * @brief 清单
+ */
+typedef struct {
+	StringTable paths;      ///< 文件路径，编号即 entries 的下标
+	ManifestEntry *entries; ///< 每个文件的记录
+	size_t capacity;        ///< entries 的容量
+	int64_t written;        ///< 写入清单的时间，单位为纳秒
+} Manifest;
+
+/**
+ * @brief 文件的处理结果
+ */
+typedef enum {
+	TREE_MISSING,   ///< 无法访问，不写入清单
+	TREE_UNCHANGED, ///< 与清单一致，沿用原来的对象
+	TREE_CHANGED,   ///< 需要重新计算内容哈希
+	TREE_LEXED,     ///< 内容变化，已经分析并写入对象
+	TREE_REUSED,    ///< 内容变化，但与其他文件内容相同或对象已经存在
+	TREE_FAILED,    ///< 对象写入失败
+} TreeStatus;
+
+/**
+ * @brief 内容哈希的集合，工作线程在其中认领需要写入的对象
+ */
+typedef struct {
+	uint64_t *slots;       ///< 开放寻址的哈希表，0 表示空槽
+	size_t capacity;       ///< 槽的数量，总是 2 的幂
+	size_t count;          ///< 已有的哈希数量
+	pthread_mutex_t mutex; ///< 保护并发认领
+} HashSet;
+
+/**
+ * @brief 并行处理时的共享状态
+ */
+typedef struct {
+	const FileList *files;  ///< 全部文件
+	const Manifest *old;    ///< 上一次的清单
+	const char *objects;    ///< 对象目录
+	ManifestEntry *entries; ///< 每个文件新的记录
+	TreeStatus *status;     ///< 每个文件的处理结果
+	HashSet claimed;        ///< 本次已经被认领的内容哈希
+} TreeJob;
+
+/**
+ * @brief 重新分配内存，失败时打印错误信息并退出程序
+ */
+static void *reallocOrDie(void *memory, size_t size) {
+	void *result = realloc(memory, size > 0 ? size : 1);
+	if (result == NULL) {
+		fprintf(stderr, "内存不足，无法分析源码树.\n");
+		exit(1);
+	}
+	return result;
+}
+
+/**
+ * @brief 内容哈希不能为 0，0 在哈希集合中表示空槽
+ */
+static uint64_t contentHash(const char *data, size_t length) {
+	uint64_t hash = hashBytes(data, length);
+	return hash != 0 ? hash : 1;
+}
+
+/**
+ * @brief 在哈希集合中加入一个哈希值，不加锁
+ * @return 新加入时返回 true，已经存在时返回 false
+ */
+static bool insertHash(HashSet *set, uint64_t hash) {
+	if ((set->count + 1) * 2 > set->capacity) {
+		size_t capacity = set->capacity > 0 ? set->capacity * 2 : 1024;
+		uint64_t *slots = calloc(capacity, sizeof(uint64_t));
+		if (slots == NULL) {
+			fprintf(stderr, "内存不足，无法分析源码树.\n");
+			exit(1);
+		}
+		for (size_t i = 0; i < set->capacity; i++) {
+			if (set->slots[i] != 0) {
+				size_t slot = (size_t)set->slots[i] & (capacity - 1);
+				while (slots[slot] != 0) {
+					slot = (slot + 1) & (capacity - 1);
+				}
+				slots[slot] = set->slots[i];
+			}
+		}
+		free(set->slots);
+		set->slots = slots;
+		set->capacity = capacity;
+	}
+	size_t slot = (size_t)hash & (set->capacity - 1);
+	for (; set->slots[slot] != 0; slot = (slot + 1) & (set->capacity - 1)) {
+		if (set->slots[slot] == hash) {
+			return false;
+		}
+	}
+	set->slots[slot] = hash;
+	set->count++;
+	return true;
+}
+
+/**
+ * @brief 判断哈希集合中是否有某个哈希值，不加锁
+ */
+static bool containsHash(const HashSet *set, uint64_t hash) {
+	if (set->capacity == 0) {
+		return false;
+	}
+	for (size_t slot = (size_t)hash & (set->capacity - 1); set->slots[slot] != 0;
+	     slot = (slot + 1) & (set->capacity - 1)) {
+		if (set->slots[slot] == hash) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief 取得对象的路径，必要时创建其所在的子目录
+ * @param objects 对象目录
+ * @param hash 内容哈希
+ * @param create 是否创建子目录
+ * @return 对象路径，由调用者释放
+ */
+static char *objectPath(const char *objects, uint64_t hash, bool create) {
+	size_t length = strlen(objects) + 24;
+	char *path = reallocOrDie(NULL, length);
+	snprintf(path, length, "%s/%02x", objects, (unsigned)(hash >> 56));
+	if (create) {
+		mkdir(path, 0777); // 已经存在时失败，不影响之后的写入
+	}
+	snprintf(path, length, "%s/%02x/%014" PRIx64 ".tks", objects, (unsigned)(hash >> 56),
+	         (uint64_t)(hash & 0x00FFFFFFFFFFFFFFULL));
+	return path;
+}
+
+/**
+ * @brief 读取清单，文件不存在或格式不对时得到空清单
+ * @param path 清单文件路径
+ * @param manifest 输出的清单
+ */
+static void readManifest(const char *path, Manifest *manifest) {
+	initStringTable(&manifest->paths);
+	manifest->entries = NULL;
+	manifest->capacity = 0;
+	manifest->written = 0;
+	FILE *file = fopen(path, "r");
+	if (file == NULL) {
+		return;
+	}
+	char *line = NULL;
+	size_t capacity = 0;
+	ssize_t length = getline(&line, &capacity, file);
+	size_t prefix = strlen(MANIFEST_HEADER);
+	if (length > 0 && strncmp(line, MANIFEST_HEADER, prefix) == 0) {
+		manifest->written = strtoll(line + prefix, NULL, 10);
+		while ((length = getline(&line, &capacity, file)) > 0) {
+			if (line[length - 1] == '\n') {
+				line[--length] = '\0';
+			}
+			ManifestEntry entry;
+			int pathStart = 0;
+			if (sscanf(line, "%" SCNx64 "\t%" SCNu64 "\t%" SCNu64 "\t%" SCNd64 "\t%n", &entry.hash, &entry.inode,
+			           &entry.size, &entry.mtime, &pathStart) != 4 || pathStart == 0) {
+				continue;
+			}
+			uint32_t id = internString(&manifest->paths, line + pathStart, (size_t)length - (size_t)pathStart);
+			if (id >= manifest->capacity) {
+				manifest->capacity = manifest->capacity > 0 ? manifest->capacity * 2 : 1024;
+				manifest->entries = reallocOrDie(manifest->entries, manifest->capacity * sizeof(ManifestEntry));
+			}
+			manifest->entries[id] = entry;
+		}
+	}
+	free(line);
+	fclose(file);
+}
+
+/**
+ * @brief 写入清单
+ * @details 先写入临时文件再重命名，中途失败时原来的清单保持不变
+ * @param path 清单文件路径
+ * @param job 全部文件的处理结果
+ * @param written 写入清单的时间，单位为纳秒
+ * @return 成功返回 true，否则返回 false
+ */
+static bool writeManifest(const char *path, const TreeJob *job, int64_t written) {
+	size_t tmpLength = strlen(path) + 5;
+	char *tmpPath = reallocOrDie(NULL, tmpLength);
+	snprintf(tmpPath, tmpLength, "%s.tmp", path);
+	FILE *file = fopen(tmpPath, "w");
+	bool ok = file != NULL;
+	if (ok) {
+		fprintf(file, "%s%" PRId64 "\n", MANIFEST_HEADER, written);
+		for (int i = 0; i < job->files->count; i++) {
+			const ManifestEntry *entry = &job->entries[i];
+			if (job->status[i] != TREE_MISSING) {
+				fprintf(file, "%016" PRIx64 "\t%" PRIu64 "\t%" PRIu64 "\t%" PRId64 "\t%s\n", entry->hash, entry->inode,
+				        entry->size, entry->mtime, job->files->paths[i]);
+			}
+		}
+		ok = !ferror(file);
+		ok = fclose(file) == 0 && ok;
+		ok = ok && rename(tmpPath, path) == 0;
+	}
+	free(tmpPath);
+	return ok;
+}
+
+/**
+ * @brief 并行任务：stat 一个文件，与清单比较
+ * @param context TreeJob
+ */
+static void statTask(size_t index, int worker, void *context) {
+	(void)worker;
+	TreeJob *job = context;
+	const char *path = job->files->paths[index];
+	struct stat st;
+	if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+		job->status[index] = TREE_MISSING;
+		return;
+	}
+	ManifestEntry *entry = &job->entries[index];
+	entry->inode = (uint64_t)st.st_ino;
+	entry->size = (uint64_t)st.st_size;
+	entry->mtime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+	job->status[index] = TREE_CHANGED;
+	uint32_t id = findString(&job->old->paths, path, strlen(path));
+	if (id == UINT32_MAX) {
+		return;
+	}
+	const ManifestEntry *old = &job->old->entries[id];
+	// 修改时间不早于上次写入清单的文件可能在同一时间刻度内又被修改过，不能只凭元数据判断
+	if (old->inode == entry->inode && old->size == entry->size && old->mtime == entry->mtime &&
+	    entry->mtime < job->old->written) {
+		entry->hash = old->hash;
+		job->status[index] = TREE_UNCHANGED;
+	}
+}
+
+/**
+ * @brief 并行任务：读取变化的文件，计算内容哈希，需要时分析并写入对象
+ * @details 内容相同的文件只有第一个认领到哈希值的线程写入对象；对象已经存在时也不再写入
+ * @param context TreeJob
+ */
+static void lexTask(size_t index, int worker, void *context) {
+	(void)worker;
+	TreeJob *job = context;
+	if (job->status[index] != TREE_CHANGED) {
+		return;
+	}
+	size_t length;
+	char *source = tryReadFile(job->files->paths[index], &length);
+	if (source == NULL) {
+		job->status[index] = TREE_MISSING; // stat 之后被删除或无法读取，跳过并且不写入清单
+		return;
+	}
+	uint64_t hash = contentHash(source, length);
+	job->entries[index].hash = hash;
+	pthread_mutex_lock(&job->claimed.mutex);
+	bool first = insertHash(&job->claimed, hash);
+	pthread_mutex_unlock(&job->claimed.mutex);
+	char *path = objectPath(job->objects, hash, first);
+	struct stat st;
+	if (!first || stat(path, &st) == 0) {
+		job->status[index] = TREE_REUSED;
+	} else {
+		TokenStream stream;
+		initTokenStream(&stream);
+		encodeTokenStream(source, length, &stream);
+		size_t tmpLength = strlen(path) + 32;
+		char *tmpPath = reallocOrDie(NULL, tmpLength);
+		snprintf(tmpPath, tmpLength, "%s.%d.tmp", path, worker);
+		FILE *file = fopen(tmpPath, "wb");
+		bool ok = file != NULL;
+		if (ok) {
+			ok = fwrite(stream.data, 1, stream.length, file) == stream.length;
+			ok = fclose(file) == 0 && ok;
+			ok = ok && rename(tmpPath, path) == 0;
+		}
+		job->status[index] = ok ? TREE_LEXED : TREE_FAILED;
+		if (!ok) {
+			fprintf(stderr, "无法写入对象 \"%s\".\n", path);
+			unlink(tmpPath);
+		}
+		free(tmpPath);
+		freeTokenStream(&stream);
+	}
+	free(path);
+	releaseFile(source, length);
+}
+
+/**
+ * @brief 读取文件系统时间戳使用的粗粒度实时时钟
+ * @details CLOCK_REALTIME 可能比文件的时间戳领先一个时钟周期，之后修改的文件的修改时间反而更早
+ * @return 当前时间，单位为纳秒
+ */
+static int64_t fileClock(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int lexTree(const char *outputDirectory, int count, const char *paths[]) {
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	size_t length = strlen(outputDirectory) + 16;
+	char *manifestPath = reallocOrDie(NULL, length);
+	char *objects = reallocOrDie(NULL, length);
+	snprintf(manifestPath, length, "%s/manifest", outputDirectory);
+	snprintf(objects, length, "%s/objects", outputDirectory);
+	if ((mkdir(outputDirectory, 0777) != 0 && errno != EEXIST) || (mkdir(objects, 0777) != 0 && errno != EEXIST)) {
+		fprintf(stderr, "无法创建输出目录 \"%s\".\n", outputDirectory);
+		free(manifestPath);
+		free(objects);
+		return 1;
+	}
+	FileList files;
+	collectFiles(&files, count, paths);
+	Manifest old;
+	readManifest(manifestPath, &old);
+	// 在 stat 之前取得时间，之后修改的文件的修改时间一定不早于它
+	int64_t written = fileClock();
+	TreeJob job = {&files, &old, objects, NULL, NULL, {NULL, 0, 0, PTHREAD_MUTEX_INITIALIZER}};
+	job.entries = reallocOrDie(NULL, ((size_t)files.count + 1) * sizeof(ManifestEntry));
+	job.status = reallocOrDie(NULL, ((size_t)files.count + 1) * sizeof(TreeStatus));
+	parallelFor((size_t)files.count, statTask, &job);
+	parallelFor((size_t)files.count, lexTask, &job);
+	size_t counts[TREE_FAILED + 1] = {0};
+	HashSet live = {NULL, 0, 0, PTHREAD_MUTEX_INITIALIZER};
+	for (int i = 0; i < files.count; i++) {
+		counts[job.status[i]]++;
+		if (job.status[i] != TREE_MISSING) {
+			insertHash(&live, job.entries[i].hash);
+		}
+	}
+	bool ok = counts[TREE_FAILED] == 0 && writeManifest(manifestPath, &job, written);
+	if (!ok) {
+		fprintf(stderr, "无法写入清单 \"%s\".\n", manifestPath);
+	}
+
+	// 清单写入之后才删除不再被引用的对象，中途失败时旧清单引用的对象仍然完整
+	size_t removed = 0;
+	for (uint32_t id = 0; ok && id < old.paths.count; id++) {
+		uint64_t hash = old.entries[id].hash;
+		if (!containsHash(&live, hash)) {
+			insertHash(&live, hash); // 同一个对象只删除一次
+			char *path = objectPath(objects, hash, false);
+			removed += unlink(path) == 0;
+			free(path);
+		}
+	}
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double elapsed = (double)(end.tv_sec - start.tv_sec) * 1e3 + (double)(end.tv_nsec - start.tv_nsec) / 1e6;
+	fprintf(stderr, "共 %d 个文件：未变化 %zu 个，重新分析 %zu 个，复用已有对象 %zu 个，删除 %zu 个对象，耗时 %.1f ms.\n",
+	        files.count, counts[TREE_UNCHANGED], counts[TREE_LEXED], counts[TREE_REUSED], removed, elapsed);
+	free(live.slots);
+	free(job.claimed.slots);
+	free(job.entries);
+	free(job.status);
+	free(old.entries);
+	freeStringTable(&old.paths);
+	freeFileList(&files);
+	free(manifestPath);
+	free(objects);
+	return ok ? 0 : 1;
+}
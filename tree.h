@@ -0,0 +1,15 @@
+#pragma once
+
+/**
+ * @brief 增量分析整棵源码树，输出每个文件的二进制 Token 流
+ * @details 输出目录中保存清单文件 manifest 和以内容哈希命名的对象 objects/xx/yyyyyyyyyyyyyy.tks。\n
+ * 清单记录每个文件的路径、inode、大小、修改时间和内容哈希。再次运行时并行 stat 全部文件，
+ * 这些信息与清单一致的文件直接沿用原来的对象；其余文件读取后计算内容哈希，
+ * 内容相同的文件只分析一次并共享同一个对象，对象已经存在时也不再分析。\n
+ * 清单写入之后删除不再被引用的对象。
+ * @param outputDirectory 输出目录，不存在时创建
+ * @param count 路径数量
+ * @param paths 路径数组，目录会被递归展开
+ * @return 成功返回 0，失败返回 1
+ */
+int lexTree(const char *outputDirectory, int count, const char *paths[]);
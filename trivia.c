@@ -0,0 +1,47 @@
+#include <string.h>
+
+#include "arena.h"
+#include "trivia.h"
+
+void initTriviaTable(TriviaTable *table) {
+	table->runs = NULL;
+	table->runCount = 0;
+	table->runCapacity = 0;
+	table->firstRun = NULL;
+	table->tokenCount = 0;
+	table->tokenCapacity = 0;
+}
+
+void freeTriviaTable(TriviaTable *table) {
+	releaseBuffer(table->runs, table->runCapacity * sizeof(TriviaRun));
+	releaseBuffer(table->firstRun, table->tokenCapacity * sizeof(uint32_t));
+	initTriviaTable(table);
+}
+
+/**
+ * @brief 把数组扩大一倍，新数组从缓冲池取得
+ * @param array 原数组，可以为 NULL
+ * @param count 原数组中有效元素的数量
+ * @param capacity 输入原容量，输出新容量，单位为元素个数
+ * @param size 单个元素的字节数
+ * @return 新数组
+ */
+static void *growArray(void *array, size_t count, size_t *capacity, size_t size) {
+	size_t bytes;
+	size_t wanted = *capacity < 256 ? 256 : *capacity * 2;
+	void *grown = acquireBuffer(wanted * size, &bytes);
+	if (count > 0) {
+		memcpy(grown, array, count * size);
+	}
+	releaseBuffer(array, *capacity * size);
+	*capacity = bytes / size;
+	return grown;
+}
+
+void growTriviaRuns(TriviaTable *table) {
+	table->runs = growArray(table->runs, table->runCount, &table->runCapacity, sizeof(TriviaRun));
+}
+
+void growTriviaTokens(TriviaTable *table) {
+	table->firstRun = growArray(table->firstRun, table->tokenCount, &table->tokenCapacity, sizeof(uint32_t));
+}
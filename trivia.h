@@ -0,0 +1,114 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief TriviaKind 枚举
+ * @details Trivia 指 Token 之间不影响语法的内容，即空白、注释，以及错误 Token 对应的源码
+ */
+typedef enum {
+	TRIVIA_SPACE,           ///< 连续的空格
+	TRIVIA_TAB,             ///< 连续的制表符
+	TRIVIA_NEWLINE,         ///< 连续的换行符
+	TRIVIA_CARRIAGE_RETURN, ///< 连续的回车符
+	TRIVIA_COMMENT,         ///< 一条单行注释，不包括行尾的换行符
+	TRIVIA_SKIPPED,         ///< 错误 Token 在源码中对应的字节，错误 Token 的 start 指向错误信息，需要借此还原源码
+} TriviaKind;
+
+/**
+ * @brief 一段 Trivia
+ * @details 低 3 位保存 TriviaKind，高 29 位保存字节数，每段只占 4 个字节。\n
+ * 空白按种类做游程编码，注释和错误只保存长度，其字节范围由前一个 Token 的结尾依次累加得到。
+ */
+typedef uint32_t TriviaRun;
+
+/**
+ * @brief 单段 Trivia 能保存的最大字节数，更长的内容拆成多段
+ */
+#define TRIVIA_MAX_LENGTH ((uint32_t)(UINT32_MAX >> 3))
+
+/**
+ * @brief 取得一段 Trivia 的种类
+ */
+#define TRIVIA_KIND(run) ((TriviaKind)((run) & 7))
+
+/**
+ * @brief 取得一段 Trivia 的字节数
+ */
+#define TRIVIA_LENGTH(run) ((size_t)((run) >> 3))
+
+/**
+ * @brief Trivia 表
+ * @details 以副表的形式保存每个 Token 的前置 Trivia，而不是插入额外的 Token。\n
+ * 第 i 个 Token 的前置 Trivia 为 runs[firstRun[i]] 到 runs[firstRun[i + 1]] (不包含)，
+ * 最后一个 Token 的范围到 runs[runCount] 为止。错误 Token 的 TRIVIA_SKIPPED 位于其前置 Trivia 之后。
+ */
+typedef struct {
+	TriviaRun *runs;      ///< 所有 Trivia 段
+	size_t runCount;      ///< Trivia 段的数量
+	size_t runCapacity;   ///< runs 的容量
+	uint32_t *firstRun;   ///< 每个 Token 的第一段 Trivia 在 runs 中的下标
+	size_t tokenCount;    ///< 已记录的 Token 数量
+	size_t tokenCapacity; ///< firstRun 的容量
+} TriviaTable;
+
+/**
+ * @brief 初始化一个空的 Trivia 表
+ * @param table 待初始化的 Trivia 表
+ */
+void initTriviaTable(TriviaTable *table);
+
+/**
+ * @brief 释放 Trivia 表占用的内存，并重新初始化为空
+ * @param table 待释放的 Trivia 表
+ */
+void freeTriviaTable(TriviaTable *table);
+
+/**
+ * @brief 扩大 runs 的容量，由 addTriviaRun 在容量不足时调用
+ * @param table Trivia 表
+ */
+void growTriviaRuns(TriviaTable *table);
+
+/**
+ * @brief 扩大 firstRun 的容量，由 beginTokenTrivia 在容量不足时调用
+ * @param table Trivia 表
+ */
+void growTriviaTokens(TriviaTable *table);
+
+/**
+ * @brief 开始记录下一个 Token 的前置 Trivia
+ * @param table Trivia 表
+ */
+static inline void beginTokenTrivia(TriviaTable *table) {
+	if (table->tokenCount == table->tokenCapacity) {
+		growTriviaTokens(table);
+	}
+	table->firstRun[table->tokenCount++] = (uint32_t)table->runCount;
+}
+
+/**
+ * @brief 为当前 Token 追加一段 Trivia
+ * @details 与当前 Token 的上一段同种类的空白会合并到同一段中
+ * @param table Trivia 表
+ * @param kind Trivia 的种类
+ * @param length 字节数
+ */
+static inline void addTriviaRun(TriviaTable *table, TriviaKind kind, size_t length) {
+	size_t first = table->firstRun[table->tokenCount - 1];
+	if (kind < TRIVIA_COMMENT && table->runCount > first) {
+		TriviaRun *last = &table->runs[table->runCount - 1];
+		if (TRIVIA_KIND(*last) == kind && TRIVIA_LENGTH(*last) + length <= TRIVIA_MAX_LENGTH) {
+			*last += (TriviaRun)(length << 3);
+			return;
+		}
+	}
+	while (length > 0) {
+		size_t part = length < TRIVIA_MAX_LENGTH ? length : TRIVIA_MAX_LENGTH;
+		if (table->runCount == table->runCapacity) {
+			growTriviaRuns(table);
+		}
+		table->runs[table->runCount++] = (TriviaRun)(part << 3) | (TriviaRun)kind;
+		length -= part;
+	}
+}
@@ -0,0 +1,111 @@
+#include <string.h>
+
+#include "kernels.h"
+#include "validate.h"
+
+/**
+ * @brief 判断字符是否为字母、数字或下划线
+ * @details 标识符和数字的剩余部分都由这类字符组成，校验时不需要区分两者
+ * @param c 待判断的字符
+ * @return 如果 c 是字母、数字或下划线，返回 true，否则返回 false
+ */
+static bool isWordChar(char c) {
+	return (c >= 'a' && c <= 'z') ||
+			(c >= 'A' && c <= 'Z') ||
+			(c >= '0' && c <= '9') ||
+			c == '_';
+}
+
+/**
+ * @brief 记录错误位置
+ * @param error 输出参数，可以为 NULL
+ * @param message 错误信息
+ * @param source 源代码的起始位置
+ * @param at 错误 Token 的起始位置
+ * @param line 错误所在的行
+ * @param lineStart 错误所在行的起始位置
+ * @return 总是返回 false，方便调用者直接返回
+ */
+static bool fail(LexError *error, const char *message, const char *source, const char *at,
+                 int line, const char *lineStart) {
+	if (error != NULL) {
+		error->message = message;
+		error->offset = (long)(at - source);
+		error->line = line;
+		error->column = (int)(at - lineStart) + 1;
+	}
+	return false;
+}
+
+bool validateSource(const char *source, size_t length, LexError *error) {
+	const char *p = source;
+	const char *end = source + length;
+	const char *lineStart = source;
+	int line = 1;
+	while (p < end) {
+		char c = *p;
+		if (isWordChar(c)) {
+			// 标识符、关键字和数字：跳过整段单词字符，小数点作为普通符号处理
+			do {
+				p++;
+			} while (p < end && isWordChar(*p));
+			continue;
+		}
+		switch (c) {
+			case '\0':
+				return true; // 与 scanToken 一致，空字符视为源码结束
+			case '\n':
+				line++;
+				lineStart = ++p;
+				break;
+			case ' ':
+			case '\r':
+			case '\t':
+				p++;
+				break;
+			case '/':
+				if (p + 1 < end && p[1] == '/') {
+					// 单行注释，直接跳到行尾
+					const char *newline = memchr(p, '\n', (size_t)(end - p));
+					p = newline != NULL ? newline : end;
+				} else {
+					p++;
+				}
+				break;
+			case '(': case ')': case '[': case ']': case '{': case '}':
+			case ',': case '.': case ';': case '~':
+			case '+': case '-': case '*': case '%': case '&': case '|':
+			case '^': case '=': case '!': case '<': case '>':
+				p++; // 运算符的双字符组合同样合法，逐个跳过即可
+				break;
+			case '"': {
+				const char *close = findQuoteOrNewline(p + 1, end, '"');
+				if (close == end || *close == '\0') {
+					return fail(error, "未终止的字符串字面量！", source, p, line, lineStart);
+				}
+				if (*close == '\n') {
+					return fail(error, "不支持多行字符串!", source, p, line, lineStart);
+				}
+				p = close + 1;
+				break;
+			}
+			case '\'': {
+				const char *close = findQuoteOrNewline(p + 1, end, '\'');
+				if (close == end || *close == '\0') {
+					return fail(error, "此字符不完整,缺少右单引号!", source, p, line, lineStart);
+				}
+				if (*close == '\n') {
+					return fail(error, "不支持多行字符!", source, p, line, lineStart);
+				}
+				if (close - p - 1 > 1) {
+					return fail(error, "非单字符Token", source, p, line, lineStart);
+				}
+				p = close + 1;
+				break;
+			}
+			default:
+				return fail(error, "意外字符", source, p, line, lineStart);
+		}
+	}
+	return true;
+}
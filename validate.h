@@ -0,0 +1,26 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief 词法错误的位置信息
+ * @details 由 validateSource 填写，描述源码中第一个词法错误
+ */
+typedef struct {
+	const char *message; ///< 错误信息，与 scanToken 产生的错误 Token 信息一致，静态分配
+	long offset;         ///< 错误 Token 起始位置相对源码开头的字节偏移
+	int line;            ///< 错误所在的行，从 1 开始
+	int column;          ///< 错误所在的列，从 1 开始，按字节计算
+} LexError;
+
+/**
+ * @brief 只校验源码能否完成词法分析
+ * @details 不构造任何 Token，只按照与 scanToken 相同的规则跳过源码，
+ * 遇到第一个未终止的字符串、字符字面量或无法识别的字符时立即停止。\n
+ * 与 scanToken 一致，遇到空字符视为源码结束。
+ * @param source 源代码
+ * @param length 源代码的字节数
+ * @param error 输出参数，发现错误时写入错误位置，可以为 NULL
+ * @return 源码没有词法错误返回 true，否则返回 false
+ */
+bool validateSource(const char *source, size_t length, LexError *error);
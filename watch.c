@@ -0,0 +1,708 @@
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "batch.h"
+#include "chunk.h"
+#include "files.h"
+#include "kernels.h"
+#include "parallel.h"
+#include "strtab.h"
+#include "tools.h"
+#include "watch.h"
+
+/**
+ * @brief 最后一个事件之后等待的时间，期间没有新的事件才开始重新分析，单位为毫秒
+ */
+#define WATCH_QUIET_MS 10
+
+/**
+ * @brief 第一个事件之后最多等待的时间，持续有事件时也会在此之后重新分析，单位为毫秒
+ */
+#define WATCH_MAX_DELAY_MS 50
+
+/**
+ * @brief 分块缓存的 Token 占用内存的上限
+ */
+#define WATCH_CACHE_BUDGET ((size_t)256 << 20)
+
+/**
+ * @brief 请求的最大长度
+ */
+#define WATCH_REQUEST_MAX 4096
+
+/**
+ * @brief 等待客户端发送请求的最长时间，单位为毫秒
+ */
+#define WATCH_REQUEST_TIMEOUT_MS 100
+
+/**
+ * @brief 等待客户端取走响应的最长时间，单位为毫秒，超时后放弃这个客户端
+ */
+#define WATCH_RESPONSE_TIMEOUT_MS 1000
+
+/**
+ * @brief 标识符的一次出现
+ */
+typedef struct {
+	uint64_t hash;   ///< 标识符的哈希值，查询时只比较哈希值
+	uint32_t line;   ///< 所在的行
+	uint32_t offset; ///< 在文件中的字节偏移
+} Occurrence;
+
+/**
+ * @brief 一个文件的分析结果
+ */
+typedef struct {
+	char *path;              ///< 文件路径
+	bool present;            ///< 文件当前是否存在
+	bool queued;             ///< 是否已经在等待重新分析
+	size_t bytes;            ///< 字节数
+	size_t tokens;           ///< Token 数量，不包括 TOKEN_EOF
+	size_t lines;            ///< 行数
+	size_t identifiers;      ///< 标识符的数量
+	size_t errors;           ///< 错误 Token 的数量
+	Occurrence *occurrences; ///< 标识符的出现位置，按哈希值和偏移排序
+} WatchedFile;
+
+/**
+ * @brief 全部文件的汇总
+ */
+typedef struct {
+	size_t files;       ///< 文件数量
+	size_t bytes;       ///< 字节数
+	size_t tokens;      ///< Token 数量
+	size_t lines;       ///< 行数
+	size_t identifiers; ///< 标识符的数量
+	size_t errors;      ///< 错误 Token 的数量
+} WatchTotals;
+
+/**
+ * @brief 监视模式的全部状态
+ */
+typedef struct {
+	int inotify;              ///< inotify 文件描述符
+	int listener;             ///< 监听的套接字
+	char **directories;       ///< 以监视描述符为下标的目录路径
+	size_t directoryCapacity; ///< directories 的容量
+	StringTable paths;        ///< 文件路径到文件编号的映射
+	WatchedFile *files;       ///< 以文件编号为下标的分析结果
+	size_t fileCapacity;      ///< files 的容量
+	uint32_t *pending;        ///< 等待重新分析的文件编号
+	size_t pendingCount;      ///< 等待重新分析的文件数量
+	size_t pendingCapacity;   ///< pending 的容量
+	double firstEvent;        ///< 当前批次第一个事件的时间
+	double lastEvent;         ///< 当前批次最后一个事件的时间
+	ChunkCache cache;         ///< 重新分析时使用的分块缓存
+	TokenBuffer buffer;       ///< 重新分析时使用的 Token 缓冲区
+	WatchTotals totals;       ///< 当前存在的文件的汇总
+	unsigned long updates;    ///< 已经完成的更新批次
+	double latency;           ///< 最近一个批次从第一个事件到更新完成的时间，单位为秒
+} Watcher;
+
+/**
+ * @brief 收到退出信号时置为 1
+ */
+static volatile sig_atomic_t stopRequested = 0;
+
+/**
+ * @brief SIGINT 和 SIGTERM 的处理函数
+ */
+static void requestStop(int signal) {
+	(void)signal;
+	stopRequested = 1;
+}
+
+/**
+ * @brief 读取单调时钟
+ * @return 当前时间，单位为秒
+ */
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief 重新分配内存，失败时打印错误信息并退出程序
+ */
+static void *reallocOrDie(void *memory, size_t size) {
+	void *result = realloc(memory, size > 0 ? size : 1);
+	if (result == NULL) {
+		fprintf(stderr, "内存不足，无法继续监视.\n");
+		exit(1);
+	}
+	return result;
+}
+
+/**
+ * @brief 按哈希值和偏移比较两个出现位置，用于 qsort
+ */
+static int compareOccurrences(const void *a, const void *b) {
+	const Occurrence *x = a, *y = b;
+	if (x->hash != y->hash) {
+		return x->hash < y->hash ? -1 : 1;
+	}
+	return x->offset < y->offset ? -1 : x->offset > y->offset;
+}
+
+/**
+ * @brief 根据 Token 计算文件的统计和标识符出现位置
+ * @param file 文件，原有的结果被替换
+ * @param source 源代码
+ * @param length 源代码的字节数
+ * @param buffer 源代码的全部 Token，需要启用 SCAN_LINES
+ */
+static void analyzeTokens(WatchedFile *file, const char *source, size_t length, const TokenBuffer *buffer) {
+	size_t identifiers = 0, errors = 0;
+	for (size_t i = 0; i < buffer->count; i++) {
+		identifiers += buffer->tokens[i].type == TOKEN_IDENTIFIER;
+		errors += buffer->tokens[i].type == TOKEN_ERROR;
+	}
+	free(file->occurrences);
+	file->occurrences = reallocOrDie(NULL, identifiers * sizeof(Occurrence));
+	size_t count = 0;
+	for (size_t i = 0; i < buffer->count; i++) {
+		const Token *token = &buffer->tokens[i];
+		if (token->type == TOKEN_IDENTIFIER) {
+			file->occurrences[count++] = (Occurrence){hashBytes(token->start, (size_t)token->length),
+			                                          (uint32_t)token->line, (uint32_t)(token->start - source)};
+		}
+	}
+	qsort(file->occurrences, count, sizeof(Occurrence), compareOccurrences);
+	const Token *eof = &buffer->tokens[buffer->count - 1];
+	file->present = true;
+	file->bytes = length;
+	file->tokens = buffer->count - 1;
+	file->lines = (size_t)eof->line - 1 + (length > 0 && source[length - 1] != '\n');
+	file->identifiers = identifiers;
+	file->errors = errors;
+}
+
+/**
+ * @brief 把文件的统计加入或移出汇总
+ * @param totals 汇总
+ * @param file 文件
+ * @param sign 1 表示加入，-1 表示移出
+ */
+static void applyTotals(WatchTotals *totals, const WatchedFile *file, int sign) {
+	if (!file->present) {
+		return;
+	}
+	totals->files += (size_t)sign;
+	totals->bytes += (size_t)sign * file->bytes;
+	totals->tokens += (size_t)sign * file->tokens;
+	totals->lines += (size_t)sign * file->lines;
+	totals->identifiers += (size_t)sign * file->identifiers;
+	totals->errors += (size_t)sign * file->errors;
+}
+
+/**
+ * @brief 取得路径对应的文件编号，第一次出现时登记一个不存在的文件
+ */
+static uint32_t fileId(Watcher *watcher, const char *path) {
+	uint32_t id = internString(&watcher->paths, path, strlen(path));
+	if (id >= watcher->fileCapacity) {
+		size_t capacity = watcher->fileCapacity > 0 ? watcher->fileCapacity * 2 : 256;
+		while (capacity <= id) {
+			capacity *= 2;
+		}
+		watcher->files = reallocOrDie(watcher->files, capacity * sizeof(WatchedFile));
+		memset(watcher->files + watcher->fileCapacity, 0, (capacity - watcher->fileCapacity) * sizeof(WatchedFile));
+		watcher->fileCapacity = capacity;
+	}
+	if (watcher->files[id].path == NULL) {
+		watcher->files[id].path = strdup(path);
+	}
+	return id;
+}
+
+/**
+ * @brief 把文件加入等待重新分析的批次
+ */
+static void queueFile(Watcher *watcher, const char *path) {
+	uint32_t id = fileId(watcher, path);
+	if (watcher->files[id].queued) {
+		return;
+	}
+	watcher->files[id].queued = true;
+	if (watcher->pendingCount == watcher->pendingCapacity) {
+		watcher->pendingCapacity = watcher->pendingCapacity > 0 ? watcher->pendingCapacity * 2 : 64;
+		watcher->pending = reallocOrDie(watcher->pending, watcher->pendingCapacity * sizeof(uint32_t));
+	}
+	watcher->pending[watcher->pendingCount++] = id;
+}
+
+/**
+ * @brief 递归监视目录
+ * @param watcher 监视状态
+ * @param directory 目录路径
+ * @param queueFiles 是否把目录中的源文件加入等待重新分析的批次，用于运行期间新建或移入的目录
+ */
+static void watchDirectory(Watcher *watcher, const char *directory, bool queueFiles) {
+	uint32_t mask = IN_CLOSE_WRITE | IN_MODIFY | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+	int wd = inotify_add_watch(watcher->inotify, directory, mask);
+	if (wd < 0) {
+		fprintf(stderr, "无法监视目录 \"%s\".\n", directory);
+		return;
+	}
+	if ((size_t)wd >= watcher->directoryCapacity) {
+		size_t capacity = watcher->directoryCapacity > 0 ? watcher->directoryCapacity * 2 : 64;
+		while (capacity <= (size_t)wd) {
+			capacity *= 2;
+		}
+		watcher->directories = reallocOrDie(watcher->directories, capacity * sizeof(char *));
+		memset(watcher->directories + watcher->directoryCapacity, 0,
+		       (capacity - watcher->directoryCapacity) * sizeof(char *));
+		watcher->directoryCapacity = capacity;
+	}
+	free(watcher->directories[wd]);
+	watcher->directories[wd] = strdup(directory);
+	DIR *dir = opendir(directory);
+	if (dir == NULL) {
+		return;
+	}
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL) {
+		if (entry->d_name[0] == '.') {
+			continue; // 与 collectFiles 一致，跳过隐藏文件和目录
+		}
+		size_t length = strlen(directory) + strlen(entry->d_name) + 2;
+		char *path = malloc(length);
+		snprintf(path, length, "%s/%s", directory, entry->d_name);
+		struct stat st;
+		if (lstat(path, &st) == 0) {
+			if (S_ISDIR(st.st_mode)) {
+				watchDirectory(watcher, path, queueFiles);
+			} else if (queueFiles && S_ISREG(st.st_mode) && isSourceName(entry->d_name)) {
+				queueFile(watcher, path);
+			}
+		}
+		free(path);
+	}
+	closedir(dir);
+}
+
+/**
+ * @brief 启动时并行分析的上下文
+ */
+typedef struct {
+	Watcher *watcher;    ///< 监视状态
+	const uint32_t *ids; ///< 需要分析的文件编号
+} LoadJob;
+
+/**
+ * @brief 并行任务：启动时分析一个文件
+ * @param context LoadJob
+ */
+static void loadTask(size_t index, int worker, void *context) {
+	(void)worker;
+	LoadJob *job = context;
+	WatchedFile *file = &job->watcher->files[job->ids[index]];
+	size_t length;
+	char *source = tryReadFile(file->path, &length);
+	if (source == NULL) {
+		return;
+	}
+	TokenBuffer buffer;
+	initTokenBuffer(&buffer);
+	scanAll(source, length, SCAN_LINES | SCAN_KEYWORDS, &buffer);
+	analyzeTokens(file, source, length, &buffer);
+	freeTokenBuffer(&buffer);
+	releaseFile(source, length);
+}
+
+/**
+ * @brief 重新分析等待中的全部文件，更新汇总
+ * @details 文件仍然存在时使用分块缓存重新分析，否则移除其结果
+ * @param watcher 监视状态
+ */
+static void processPending(Watcher *watcher) {
+	size_t changed = watcher->pendingCount;
+	for (size_t i = 0; i < watcher->pendingCount; i++) {
+		WatchedFile *file = &watcher->files[watcher->pending[i]];
+		file->queued = false;
+		applyTotals(&watcher->totals, file, -1);
+		size_t length;
+		char *source = tryReadFile(file->path, &length);
+		if (source == NULL) {
+			file->present = false;
+			free(file->occurrences);
+			file->occurrences = NULL;
+			continue;
+		}
+		lexChunked(&watcher->cache, source, length, &watcher->buffer);
+		analyzeTokens(file, source, length, &watcher->buffer);
+		applyTotals(&watcher->totals, file, 1);
+		releaseFile(source, length);
+	}
+	watcher->pendingCount = 0;
+	watcher->updates++;
+	watcher->latency = now() - watcher->firstEvent;
+	fprintf(stderr, "已更新 %zu 个文件，延迟 %.1f ms.\n", changed, watcher->latency * 1e3);
+}
+
+/**
+ * @brief 处理目录被删除或移走：停止监视其中的全部目录，并把其中已知的文件加入等待重新分析的批次
+ */
+static void forgetDirectory(Watcher *watcher, const char *directory) {
+	size_t length = strlen(directory);
+	for (size_t wd = 0; wd < watcher->directoryCapacity; wd++) {
+		const char *path = watcher->directories[wd];
+		if (path != NULL && strncmp(path, directory, length) == 0 && (path[length] == '/' || path[length] == '\0')) {
+			inotify_rm_watch(watcher->inotify, (int)wd); // 之后收到的 IN_IGNORED 释放路径
+		}
+	}
+	for (uint32_t id = 0; id < watcher->fileCapacity; id++) {
+		const char *path = watcher->files[id].path;
+		if (path != NULL && watcher->files[id].present && strncmp(path, directory, length) == 0 &&
+		    path[length] == '/') {
+			queueFile(watcher, path);
+		}
+	}
+}
+
+/**
+ * @brief 读取并处理 inotify 事件
+ * @param watcher 监视状态
+ */
+static void readEvents(Watcher *watcher) {
+	char events[64 * 1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+	ssize_t length = read(watcher->inotify, events, sizeof(events));
+	if (length <= 0) {
+		return;
+	}
+	double time = now();
+	if (watcher->pendingCount == 0) {
+		watcher->firstEvent = time;
+	}
+	watcher->lastEvent = time;
+	for (char *p = events; p < events + length;) {
+		const struct inotify_event *event = (const struct inotify_event *)p;
+		p += sizeof(struct inotify_event) + event->len;
+		if (event->mask & IN_Q_OVERFLOW) {
+			// 事件队列溢出，丢失的事件无法恢复，重新检查全部目录和文件
+			for (size_t wd = 0; wd < watcher->directoryCapacity; wd++) {
+				if (watcher->directories[wd] != NULL) {
+					char *directory = strdup(watcher->directories[wd]);
+					watchDirectory(watcher, directory, true);
+					free(directory);
+				}
+			}
+			for (uint32_t id = 0; id < watcher->fileCapacity; id++) {
+				if (watcher->files[id].present) {
+					queueFile(watcher, watcher->files[id].path);
+				}
+			}
+			continue;
+		}
+		if (event->mask & IN_IGNORED) {
+			if ((size_t)event->wd < watcher->directoryCapacity) {
+				free(watcher->directories[event->wd]);
+				watcher->directories[event->wd] = NULL;
+			}
+			continue;
+		}
+		if (event->len == 0 || event->name[0] == '.' || (size_t)event->wd >= watcher->directoryCapacity ||
+		    watcher->directories[event->wd] == NULL) {
+			continue;
+		}
+		size_t size = strlen(watcher->directories[event->wd]) + strlen(event->name) + 2;
+		char *path = malloc(size);
+		snprintf(path, size, "%s/%s", watcher->directories[event->wd], event->name);
+		if (event->mask & IN_ISDIR) {
+			if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+				watchDirectory(watcher, path, true);
+			} else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+				forgetDirectory(watcher, path);
+			}
+		} else if (isSourceName(event->name)) {
+			queueFile(watcher, path);
+		}
+		free(path);
+	}
+}
+
+/**
+ * @brief 处理 query 请求，输出标识符的全部出现位置
+ */
+static void answerQuery(const Watcher *watcher, const char *name, FILE *out) {
+	uint64_t hash = hashBytes(name, strlen(name));
+	for (uint32_t id = 0; id < watcher->fileCapacity; id++) {
+		const WatchedFile *file = &watcher->files[id];
+		if (!file->present) {
+			continue;
+		}
+		size_t low = 0, high = file->identifiers;
+		while (low < high) {
+			size_t middle = low + (high - low) / 2;
+			if (file->occurrences[middle].hash < hash) {
+				low = middle + 1;
+			} else {
+				high = middle;
+			}
+		}
+		for (size_t i = low; i < file->identifiers && file->occurrences[i].hash == hash; i++) {
+			fprintf(out, "%s:%u: %u\n", file->path, file->occurrences[i].line, file->occurrences[i].offset);
+		}
+	}
+}
+
+/**
+ * @brief 计算距离截止时间还剩多少毫秒
+ * @param deadline 截止时间，单位为秒
+ * @return 剩余的毫秒数，已经超时返回 0
+ */
+static int remainingMs(double deadline) {
+	double remaining = (deadline - now()) * 1e3;
+	return remaining > 0 ? (int)remaining + 1 : 0;
+}
+
+/**
+ * @brief 在截止时间之前把响应写给非阻塞的客户端套接字
+ * @param client 客户端套接字
+ * @param data 响应
+ * @param length 响应的字节数
+ */
+static void sendResponse(int client, const char *data, size_t length) {
+	double deadline = now() + WATCH_RESPONSE_TIMEOUT_MS / 1e3;
+	struct pollfd wait = {client, POLLOUT, 0};
+	while (length > 0) {
+		ssize_t n = write(client, data, length);
+		if (n > 0) {
+			data += n;
+			length -= (size_t)n;
+		} else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+			return;
+		} else if (poll(&wait, 1, remainingMs(deadline)) <= 0) {
+			return; // 客户端迟迟不读取，放弃剩余的响应，不能拖住事件循环
+		}
+	}
+}
+
+/**
+ * @brief 接受一个客户端连接，读取一行请求并返回结果
+ * @details 客户端套接字是非阻塞的，读取请求和写出响应都有总的时限，慢速客户端不会阻塞重新分析。
+ * @param watcher 监视状态
+ */
+static void serveClient(Watcher *watcher) {
+	int client = accept(watcher->listener, NULL, NULL);
+	if (client < 0) {
+		return;
+	}
+	fcntl(client, F_SETFL, fcntl(client, F_GETFL) | O_NONBLOCK);
+	fcntl(client, F_SETFD, FD_CLOEXEC);
+	char request[WATCH_REQUEST_MAX];
+	size_t length = 0;
+	double deadline = now() + WATCH_REQUEST_TIMEOUT_MS / 1e3;
+	struct pollfd wait = {client, POLLIN, 0};
+	while (length < sizeof(request) - 1 && memchr(request, '\n', length) == NULL &&
+	       poll(&wait, 1, remainingMs(deadline)) > 0) {
+		ssize_t n = read(client, request + length, sizeof(request) - 1 - length);
+		if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+			continue;
+		}
+		if (n <= 0) {
+			break;
+		}
+		length += (size_t)n;
+	}
+	request[length] = '\0';
+	request[strcspn(request, "\r\n")] = '\0';
+	// 先在内存中生成完整的响应，再按时限写出
+	char *response = NULL;
+	size_t responseLength = 0;
+	FILE *out = open_memstream(&response, &responseLength);
+	if (out == NULL) {
+		close(client);
+		return;
+	}
+	const WatchTotals *totals = &watcher->totals;
+	if (strcmp(request, "stats") == 0) {
+		fprintf(out, "files %zu\nbytes %zu\ntokens %zu\nlines %zu\nidentifiers %zu\nerrors %zu\n", totals->files,
+		        totals->bytes, totals->tokens, totals->lines, totals->identifiers, totals->errors);
+		fprintf(out, "updates %lu\npending %zu\nlatency %.3f\n", watcher->updates, watcher->pendingCount,
+		        watcher->latency * 1e3);
+	} else if (strcmp(request, "files") == 0) {
+		for (uint32_t id = 0; id < watcher->fileCapacity; id++) {
+			const WatchedFile *file = &watcher->files[id];
+			if (file->present) {
+				fprintf(out, "%s\t%zu\t%zu\t%zu\t%zu\n", file->path, file->bytes, file->tokens, file->lines,
+				        file->errors);
+			}
+		}
+	} else if (strncmp(request, "query ", 6) == 0) {
+		answerQuery(watcher, request + 6, out);
+	} else {
+		fprintf(out, "error 无法识别的请求 \"%s\"\n", request);
+	}
+	fclose(out);
+	sendResponse(client, response, responseLength);
+	free(response);
+	close(client);
+}
+
+/**
+ * @brief 创建并监听 Unix 域套接字
+ * @details 路径上已经有文件时，只有它是没有进程在监听的套接字才会被删除；
+ * 普通文件或者仍在使用的套接字都视为错误。
+ * @param path 套接字文件路径
+ * @return 监听的套接字，失败时返回 -1
+ */
+static int listenSocket(const char *path) {
+	struct sockaddr_un address = {.sun_family = AF_UNIX};
+	if (strlen(path) >= sizeof(address.sun_path)) {
+		fprintf(stderr, "套接字路径 \"%s\" 过长.\n", path);
+		return -1;
+	}
+	strcpy(address.sun_path, path);
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		fprintf(stderr, "无法创建套接字.\n");
+		return -1;
+	}
+	struct stat st;
+	if (lstat(path, &st) == 0) {
+		if (!S_ISSOCK(st.st_mode)) {
+			fprintf(stderr, "\"%s\" 已经存在并且不是套接字.\n", path);
+			close(fd);
+			return -1;
+		}
+		// 能连上说明另一个进程正在监听，连不上才是残留的套接字
+		int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		bool live = probe >= 0 && connect(probe, (struct sockaddr *)&address, sizeof(address)) == 0;
+		if (probe >= 0) {
+			close(probe);
+		}
+		if (live) {
+			fprintf(stderr, "套接字 \"%s\" 正在被其他进程使用.\n", path);
+			close(fd);
+			return -1;
+		}
+		unlink(path);
+	}
+	if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(fd, 16) != 0) {
+		fprintf(stderr, "无法监听套接字 \"%s\".\n", path);
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/**
+ * @brief 释放监视状态占用的全部资源
+ */
+static void freeWatcher(Watcher *watcher) {
+	for (size_t wd = 0; wd < watcher->directoryCapacity; wd++) {
+		free(watcher->directories[wd]);
+	}
+	free(watcher->directories);
+	for (size_t id = 0; id < watcher->fileCapacity; id++) {
+		free(watcher->files[id].path);
+		free(watcher->files[id].occurrences);
+	}
+	free(watcher->files);
+	free(watcher->pending);
+	freeStringTable(&watcher->paths);
+	freeChunkCache(&watcher->cache);
+	freeTokenBuffer(&watcher->buffer);
+	close(watcher->inotify);
+}
+
+int watchTree(const char *socketPath, int count, const char *paths[]) {
+	Watcher watcher;
+	memset(&watcher, 0, sizeof(watcher));
+	watcher.inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (watcher.inotify < 0) {
+		fprintf(stderr, "无法初始化 inotify.\n");
+		return 1;
+	}
+	initStringTable(&watcher.paths);
+	initChunkCache(&watcher.cache, WATCH_CACHE_BUDGET);
+	initTokenBuffer(&watcher.buffer);
+	// 先监视目录再分析文件，分析期间发生的修改会在之后重新分析
+	for (int i = 0; i < count; i++) {
+		struct stat st;
+		if (stat(paths[i], &st) != 0 || !S_ISDIR(st.st_mode)) {
+			fprintf(stderr, "\"%s\" 不是目录.\n", paths[i]);
+			freeWatcher(&watcher);
+			return 1;
+		}
+		watchDirectory(&watcher, paths[i], false);
+	}
+	double start = now();
+	FileList files;
+	collectFiles(&files, count, paths);
+	uint32_t *ids = reallocOrDie(NULL, (size_t)files.count * sizeof(uint32_t));
+	for (int i = 0; i < files.count; i++) {
+		ids[i] = fileId(&watcher, files.paths[i]);
+	}
+	LoadJob job = {&watcher, ids};
+	parallelFor((size_t)files.count, loadTask, &job);
+	for (int i = 0; i < files.count; i++) {
+		applyTotals(&watcher.totals, &watcher.files[ids[i]], 1);
+	}
+	free(ids);
+	freeFileList(&files);
+	fprintf(stderr, "已分析 %zu 个文件，耗时 %.1f ms，监听 \"%s\".\n", watcher.totals.files, (now() - start) * 1e3,
+	        socketPath);
+	watcher.listener = listenSocket(socketPath);
+	if (watcher.listener < 0) {
+		freeWatcher(&watcher);
+		return 1;
+	}
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = requestStop;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	signal(SIGPIPE, SIG_IGN);
+	while (!stopRequested) {
+		int timeout = -1;
+		if (watcher.pendingCount > 0) {
+			double time = now();
+			double deadline = watcher.lastEvent + WATCH_QUIET_MS / 1e3;
+			if (deadline > watcher.firstEvent + WATCH_MAX_DELAY_MS / 1e3) {
+				deadline = watcher.firstEvent + WATCH_MAX_DELAY_MS / 1e3;
+			}
+			timeout = deadline > time ? (int)((deadline - time) * 1e3) + 1 : 0;
+		}
+		struct pollfd fds[2] = {{watcher.inotify, POLLIN, 0}, {watcher.listener, POLLIN, 0}};
+		int ready = poll(fds, 2, timeout);
+		if (ready < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			fprintf(stderr, "等待事件失败.\n");
+			break;
+		}
+		if (fds[0].revents & POLLIN) {
+			readEvents(&watcher);
+		}
+		double time = now();
+		if (watcher.pendingCount > 0 && (time >= watcher.lastEvent + WATCH_QUIET_MS / 1e3 ||
+		                                 time >= watcher.firstEvent + WATCH_MAX_DELAY_MS / 1e3)) {
+			processPending(&watcher);
+		}
+		if (fds[1].revents & POLLIN) {
+			serveClient(&watcher);
+		}
+	}
+	close(watcher.listener);
+	unlink(socketPath);
+	freeWatcher(&watcher);
+	return 0;
+}
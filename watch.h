@@ -0,0 +1,16 @@
+#pragma once
+
+/**
+ * @brief 监视目录树，在文件变化时增量重新分析，并通过本地套接字提供最新结果
+ * @details 启动时并行分析目录中的全部源文件，之后用 inotify 监视这些目录及新建的子目录。\n
+ * 文件变化后等待一小段时间合并连续的事件，再批量重新分析变化的文件：
+ * 分析使用分块缓存，只重新扫描内容变化的块。内存中保存每个文件的统计和标识符出现位置。\n
+ * 客户端连接 Unix 域套接字后发送一行请求，服务端返回结果后关闭连接：\n
+ * stats 返回全部文件的汇总；files 返回每个文件的统计；query 标识符 返回标识符的全部出现位置。\n
+ * 收到 SIGINT 或 SIGTERM 时删除套接字文件并返回。
+ * @param socketPath 套接字文件路径
+ * @param count 目录数量
+ * @param paths 目录路径数组
+ * @return 正常退出返回 0，无法监视或无法创建套接字时返回 1
+ */
+int watchTree(const char *socketPath, int count, const char *paths[]);